@@ -100,8 +100,8 @@
 #define configMINIMAL_STACK_SIZE		( 4096 )
 #define configISR_STACK_SIZE			configMINIMAL_STACK_SIZE
 #define configTOTAL_HEAP_SIZE			( ( size_t ) 512000 )
-#define configMAX_TASK_NAME_LEN			( 8 )
-#define configUSE_TRACE_FACILITY		0
+#define configMAX_TASK_NAME_LEN			( 16 )
+#define configUSE_TRACE_FACILITY		1
 #define configUSE_16_BIT_TICKS			0
 #define configIDLE_SHOULD_YIELD			0
 #define configUSE_MUTEXES				1
@@ -110,6 +110,19 @@
 #define configCHECK_FOR_STACK_OVERFLOW	2 
 #define configQUEUE_REGISTRY_SIZE		0
 
+/* Define LCFR_STATIC_ALLOCATION to build without a heap.  Every task, queue,
+semaphore and timer then lives in a static pool in main.c and the
+configTOTAL_HEAP_SIZE bytes of ucHeap are not linked in. */
+#ifdef LCFR_STATIC_ALLOCATION
+	#define configSUPPORT_STATIC_ALLOCATION		1
+	#define configSUPPORT_DYNAMIC_ALLOCATION	0
+#endif
+
+/* Define LCFR_TLSF_HEAP to take the heap from heap_tlsf.c instead of heap.c. */
+#ifdef LCFR_TLSF_HEAP
+	#define configUSE_TLSF_HEAP					1
+#endif
+
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES 			0
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
@@ -118,13 +131,15 @@
 to exclude the API function. */
 
 #define INCLUDE_vTaskPrioritySet			0
-#define INCLUDE_uxTaskPriorityGet			0
+#define INCLUDE_uxTaskPriorityGet			1
 #define INCLUDE_vTaskDelete					1
 #define INCLUDE_vTaskCleanUpResources		1
 #define INCLUDE_vTaskSuspend				0
-#define INCLUDE_vTaskDelayUntil				0
+#define INCLUDE_vTaskDelayUntil				1
 #define INCLUDE_vTaskDelay					1
 #define INCLUDE_uxTaskGetStackHighWaterMark	1
+#define INCLUDE_xTaskGetIdleTaskHandle		1
+#define INCLUDE_pcTaskGetTaskName			1
 
 /* The priority at which the tick interrupt runs.  This should probably be
 kept at 1. */
@@ -135,4 +150,108 @@ be called.  Only API functions that end in ...FromISR() can be used within
 interrupts. */
 #define configMAX_SYSCALL_INTERRUPT_PRIORITY	0x03
 
+/* CPU utilisation counters, see cpu_load.h. */
+void cpuLoadTaskSwitchedIn( void *pvTask );
+void cpuLoadTaskSwitchedOut( void *pvTask );
+void cpuLoadTick( void );
+#define traceTASK_SWITCHED_IN()				cpuLoadTaskSwitchedIn( pxCurrentTCB )
+#define traceTASK_SWITCHED_OUT()			cpuLoadTaskSwitchedOut( pxCurrentTCB )
+#define traceTASK_INCREMENT_TICK( xTickCount )	cpuLoadTick()
+
+/* Per-task run time, see task_stats.h.  The counter is the alt_timestamp()
+clock, which latencyInit() starts before the scheduler does. */
+#include "sys/alt_timestamp.h"
+#define configGENERATE_RUN_TIME_STATS				1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()			( ( uint32_t ) alt_timestamp() )
+
+/* Define LCFR_TICKLESS_IDLE to stop the tick while every task is blocked, see
+vPortSuppressTicksAndSleep() in port.c.  The kernel needs vTaskSuspend() for
+it. */
+#ifdef LCFR_TICKLESS_IDLE
+	#define configUSE_TICKLESS_IDLE				1
+	#undef INCLUDE_vTaskSuspend
+	#define INCLUDE_vTaskSuspend				1
+#endif
+
+/* Define LCFR_TRACE_RECORDER to log task switches, queue traffic, task
+notifications, timer commands and interrupts to a RAM ring, see
+trace_recorder.h.  The same define works for the Nios II build. */
+#ifdef LCFR_TRACE_RECORDER
+	#define configUSE_TRACE_RECORDER			1
+
+	uint8_t traceRecorderTaskCreated( const char *pcName, uint32_t ulPriority );
+	uint8_t traceRecorderQueueCreated( uint8_t ucType );
+	void traceRecorderRecord( uint8_t ucEvent, uint32_t ulObject, uint32_t ulValue );
+
+	/* trace_recorder.h's TraceEvent numbers. */
+	#define traceRECORD_TASK_SWITCHED_IN		0
+	#define traceRECORD_TASK_READY				1
+	#define traceRECORD_TASK_DELAY				2
+	#define traceRECORD_QUEUE_SEND				5
+	#define traceRECORD_QUEUE_SEND_FROM_ISR		6
+	#define traceRECORD_QUEUE_SEND_FAILED		7
+	#define traceRECORD_QUEUE_RECEIVE			8
+	#define traceRECORD_QUEUE_RECEIVE_FROM_ISR	9
+	#define traceRECORD_QUEUE_BLOCK_SEND		10
+	#define traceRECORD_QUEUE_BLOCK_RECEIVE		11
+	#define traceRECORD_NOTIFY					12
+	#define traceRECORD_NOTIFY_FROM_ISR			13
+	#define traceRECORD_NOTIFY_BLOCK			14
+	#define traceRECORD_NOTIFY_RECEIVE			15
+	#define traceRECORD_TIMER_COMMAND_SEND		16
+	#define traceRECORD_TIMER_COMMAND_RECEIVED	17
+	#define traceRECORD_TIMER_EXPIRED			18
+
+	#define traceRECORD_TASK( ucEvent, pxTask )		traceRecorderRecord( ( ucEvent ), ( pxTask )->uxTaskNumber, 0 )
+	#define traceRECORD_QUEUE( ucEvent, pxQueue )	traceRecorderRecord( ( ucEvent ), ( pxQueue )->uxQueueNumber, ( pxQueue )->uxMessagesWaiting )
+
+	#undef traceTASK_SWITCHED_IN
+	#define traceTASK_SWITCHED_IN()					do { cpuLoadTaskSwitchedIn( pxCurrentTCB ); traceRECORD_TASK( traceRECORD_TASK_SWITCHED_IN, pxCurrentTCB ); } while( 0 )
+	#define traceTASK_CREATE( pxNewTCB )			( pxNewTCB )->uxTaskNumber = traceRecorderTaskCreated( ( pxNewTCB )->pcTaskName, ( pxNewTCB )->uxPriority )
+	/* tasks.c puts no semicolon after this one. */
+	#define traceMOVED_TASK_TO_READY_STATE( pxTCB )	traceRECORD_TASK( traceRECORD_TASK_READY, pxTCB );
+	#define traceTASK_DELAY()						traceRECORD_TASK( traceRECORD_TASK_DELAY, pxCurrentTCB )
+	#define traceTASK_DELAY_UNTIL()					traceRECORD_TASK( traceRECORD_TASK_DELAY, pxCurrentTCB )
+
+	#define traceQUEUE_CREATE( pxNewQueue )			( pxNewQueue )->uxQueueNumber = traceRecorderQueueCreated( ( pxNewQueue )->ucQueueType )
+	#define traceCREATE_MUTEX( pxNewQueue )			traceQUEUE_CREATE( pxNewQueue )
+	#define traceQUEUE_SEND( pxQueue )				traceRECORD_QUEUE( traceRECORD_QUEUE_SEND, pxQueue )
+	#define traceQUEUE_SEND_FAILED( pxQueue )		traceRECORD_QUEUE( traceRECORD_QUEUE_SEND_FAILED, pxQueue )
+	#define traceQUEUE_SEND_FROM_ISR( pxQueue )		traceRECORD_QUEUE( traceRECORD_QUEUE_SEND_FROM_ISR, pxQueue )
+	#define traceQUEUE_SEND_FROM_ISR_FAILED( pxQueue )	traceRECORD_QUEUE( traceRECORD_QUEUE_SEND_FAILED, pxQueue )
+	#define traceQUEUE_RECEIVE( pxQueue )			traceRECORD_QUEUE( traceRECORD_QUEUE_RECEIVE, pxQueue )
+	#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )	traceRECORD_QUEUE( traceRECORD_QUEUE_RECEIVE_FROM_ISR, pxQueue )
+	#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )	traceRECORD_QUEUE( traceRECORD_QUEUE_BLOCK_SEND, pxQueue )
+	#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )	traceRECORD_QUEUE( traceRECORD_QUEUE_BLOCK_RECEIVE, pxQueue )
+
+	#define traceTASK_NOTIFY()						traceRECORD_TASK( traceRECORD_NOTIFY, pxTCB )
+	#define traceTASK_NOTIFY_FROM_ISR()				traceRECORD_TASK( traceRECORD_NOTIFY_FROM_ISR, pxTCB )
+	#define traceTASK_NOTIFY_GIVE_FROM_ISR()		traceRECORD_TASK( traceRECORD_NOTIFY_FROM_ISR, pxTCB )
+	#define traceTASK_NOTIFY_TAKE_BLOCK()			traceRECORD_TASK( traceRECORD_NOTIFY_BLOCK, pxCurrentTCB )
+	#define traceTASK_NOTIFY_WAIT_BLOCK()			traceRECORD_TASK( traceRECORD_NOTIFY_BLOCK, pxCurrentTCB )
+	#define traceTASK_NOTIFY_TAKE()					traceRECORD_TASK( traceRECORD_NOTIFY_RECEIVE, pxCurrentTCB )
+	#define traceTASK_NOTIFY_WAIT()					traceRECORD_TASK( traceRECORD_NOTIFY_RECEIVE, pxCurrentTCB )
+
+	#define traceTIMER_COMMAND_SEND( xTimer, xMessageID, xMessageValue, xReturn )	traceRecorderRecord( traceRECORD_TIMER_COMMAND_SEND, ( xMessageID ), ( xReturn ) )
+	#define traceTIMER_COMMAND_RECEIVED( pxTimer, xMessageID, xMessageValue )	traceRecorderRecord( traceRECORD_TIMER_COMMAND_RECEIVED, ( xMessageID ), 0 )
+	#define traceTIMER_EXPIRED( pxTimer )			traceRecorderRecord( traceRECORD_TIMER_EXPIRED, 0, 0 )
+#endif
+
+/* Define LCFR_HW_LOAD_TIMER to time load management with the load_timer
+interval timer instead of a software timer, see load_timer.h.  Nothing else
+uses software timers, so the timer service task is left out. */
+#ifdef LCFR_HW_LOAD_TIMER
+	#define configUSE_HW_LOAD_TIMER				1
+	#undef configUSE_TIMERS
+	#define configUSE_TIMERS					0
+#endif
+
+/* The host simulation port parks the idle task in the idle hook until an
+interrupt makes another task ready, see host/port.c. */
+#ifdef LCFR_POSIX_GCC
+	#undef configUSE_IDLE_HOOK
+	#define configUSE_IDLE_HOOK					1
+#endif
+
 #endif /* FREERTOS_CONFIG_H */
@@ -80,6 +80,11 @@
 	#define static
 #endif
 
+/* Co-routines can only be created from the heap, so with
+configSUPPORT_DYNAMIC_ALLOCATION set to 0 there is nothing for the rest of this
+file to do. */
+#if( configSUPPORT_DYNAMIC_ALLOCATION == 1 )
+
 
 /* Lists for ready and blocked co-routines. --------------------*/
 static List_t pxReadyCoRoutineLists[ configMAX_CO_ROUTINE_PRIORITIES ];	/*< Prioritised ready co-routines. */
@@ -389,3 +394,4 @@ BaseType_t xReturn;
 	return xReturn;
 }
 
+#endif /* configSUPPORT_DYNAMIC_ALLOCATION */
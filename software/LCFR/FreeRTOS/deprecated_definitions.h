@@ -317,5 +317,10 @@ projects should not use them. */
 	#include "../../Source/portable/IAR/78K0R/portmacro.h"
 #endif
 
+#ifdef LCFR_POSIX_GCC
+	/* Host simulation build of the LCFR, see host/readme.txt. */
+	#include "../host/portmacro.h"
+#endif
+
 #endif /* DEPRECATED_DEFINITIONS_H */
 
@@ -84,6 +84,11 @@ task.h is included from an application file. */
 #include "FreeRTOSConfig.h"
 
 #undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* With configSUPPORT_DYNAMIC_ALLOCATION set to 0 every kernel object lives in
+application provided storage, so the heap array is not compiled at all.  With
+configUSE_TLSF_HEAP set to 1 the heap comes from heap_tlsf.c instead. */
+#if( ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_TLSF_HEAP == 0 ) )
 //#define size_t long unsigned int
 /* Block sizes must not get too small. */
 #define heapMINIMUM_BLOCK_SIZE  ( ( size_t ) ( heapSTRUCT_SIZE * 2 ) )
@@ -140,6 +145,11 @@ static xBlockLink xStart, *pxEnd = NULL;
 fragmentation. */
 static size_t xFreeBytesRemaining = ( ( size_t ) configTOTAL_HEAP_SIZE ) & ( ( size_t ) ~portBYTE_ALIGNMENT_MASK );
 
+/* Fragmentation statistics for vPortGetHeapStats(). */
+static size_t xMinimumEverFreeBytesRemaining = ( ( size_t ) configTOTAL_HEAP_SIZE ) & ( ( size_t ) ~portBYTE_ALIGNMENT_MASK );
+static size_t xNumberOfSuccessfulAllocations = 0;
+static size_t xNumberOfSuccessfulFrees = 0;
+
 /* STATIC FUNCTIONS ARE DEFINED AS MACROS TO MINIMIZE THE FUNCTION CALL DEPTH. */
 
 /*-----------------------------------------------------------*/
@@ -215,6 +225,11 @@ void *pvReturn = NULL;
                                 }
 
                                 xFreeBytesRemaining -= pxBlock->xBlockSize;
+                                if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+                                {
+                                        xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+                                }
+                                xNumberOfSuccessfulAllocations++;
                         }
                 }
         }
@@ -252,6 +267,7 @@ xBlockLink *pxLink;
                 {
                         /* Add this block to the list of free blocks. */
                         xFreeBytesRemaining += pxLink->xBlockSize;
+                        xNumberOfSuccessfulFrees++;
                         prvInsertBlockIntoFreeList( ( ( xBlockLink * ) pxLink ) );
                 }
                 xTaskResumeAll();
@@ -265,6 +281,50 @@ size_t xPortGetFreeHeapSize( void )
 }
 /*-----------------------------------------------------------*/
 
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+        return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t *pxHeapStats )
+{
+xBlockLink *pxBlock;
+size_t xBlocks = 0, xMaxSize = 0, xMinSize = 0;
+
+        vTaskSuspendAll();
+        {
+                if( pxEnd == NULL )
+                {
+                        prvHeapInit();
+                }
+
+                /* Walk the free list between the start and end markers. */
+                for( pxBlock = xStart.pxNextFreeBlock; pxBlock != pxEnd; pxBlock = pxBlock->pxNextFreeBlock )
+                {
+                        if( ( xBlocks == 0 ) || ( pxBlock->xBlockSize < xMinSize ) )
+                        {
+                                xMinSize = pxBlock->xBlockSize;
+                        }
+                        if( pxBlock->xBlockSize > xMaxSize )
+                        {
+                                xMaxSize = pxBlock->xBlockSize;
+                        }
+                        xBlocks++;
+                }
+
+                pxHeapStats->xAvailableHeapSpaceInBytes = xFreeBytesRemaining;
+                pxHeapStats->xSizeOfLargestFreeBlockInBytes = xMaxSize;
+                pxHeapStats->xSizeOfSmallestFreeBlockInBytes = xMinSize;
+                pxHeapStats->xNumberOfFreeBlocks = xBlocks;
+                pxHeapStats->xMinimumEverFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+                pxHeapStats->xNumberOfSuccessfulAllocations = xNumberOfSuccessfulAllocations;
+                pxHeapStats->xNumberOfSuccessfulFrees = xNumberOfSuccessfulFrees;
+        }
+        xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
 void vPortInitialiseBlocks( void )
 {
         /* This just exists to keep the linker quiet. */
@@ -301,6 +361,7 @@ unsigned char *pucHeapEnd;
 
         /* The heap now contains pxEnd. */
         xFreeBytesRemaining -= heapSTRUCT_SIZE;
+        xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
 }
 /*-----------------------------------------------------------*/
 
@@ -355,3 +416,5 @@ unsigned char *puc;
                 pxIterator->pxNextFreeBlock = pxBlockToInsert;
         }
 }
+
+#endif /* ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_TLSF_HEAP == 0 ) */
@@ -0,0 +1,504 @@
+/*
+ * Two-level segregated fit (TLSF) implementation of pvPortMalloc() and
+ * vPortFree(), selected instead of heap.c by setting configUSE_TLSF_HEAP to 1.
+ *
+ * Free blocks are kept in one list per size class.  The first level splits
+ * sizes by powers of two and the second level splits each power of two into
+ * 2^heapSL_INDEX_COUNT_LOG2 equal ranges.  A bitmap per level records which
+ * lists are non-empty, so finding a block, splitting it, and merging a freed
+ * block with its physical neighbours each take a fixed number of steps however
+ * fragmented the heap is.  heap.c instead walks its address-ordered free list
+ * on every call, with the scheduler suspended for the whole walk.
+ *
+ * Any block found is at least as large as the request, because the request
+ * is rounded up to the next class boundary before the search.  The price is
+ * up to 1/2^heapSL_INDEX_COUNT_LOG2 of a block lost to rounding.
+ *
+ * Every block starts with a two word header: the physically previous block
+ * and the size of this one, with the low bit set while the block is free.  A
+ * free block keeps its list links in what would be its payload.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#if( ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_TLSF_HEAP == 1 ) )
+
+/* Second level lists per power of two, as a power of two. */
+#define heapSL_INDEX_COUNT_LOG2		4
+#define heapSL_INDEX_COUNT			( 1 << heapSL_INDEX_COUNT_LOG2 )
+
+#if portBYTE_ALIGNMENT == 8
+	#define heapALIGNMENT_LOG2		3
+#elif portBYTE_ALIGNMENT == 4
+	#define heapALIGNMENT_LOG2		2
+#else
+	#error heap_tlsf.c needs a portBYTE_ALIGNMENT of 4 or 8.
+#endif
+
+/* Blocks smaller than heapSMALL_BLOCK_SIZE all share first level list 0, and
+its second level lists are one alignment unit apart. */
+#define heapFL_INDEX_SHIFT			( heapSL_INDEX_COUNT_LOG2 + heapALIGNMENT_LOG2 )
+#define heapSMALL_BLOCK_SIZE		( ( size_t ) 1 << heapFL_INDEX_SHIFT )
+
+/* Every block is smaller than 1 << heapFL_INDEX_MAX bytes. */
+#define heapFL_INDEX_MAX			20
+#define heapFL_INDEX_COUNT			( heapFL_INDEX_MAX - heapFL_INDEX_SHIFT + 1 )
+
+#define heapBLOCK_FREE				( ( size_t ) 1 )
+
+typedef struct TLSF_BLOCK
+{
+	struct TLSF_BLOCK *pxPrevPhysBlock;	/*<< The block just below this one in memory, NULL for the first. */
+	size_t xSizeAndFlags;				/*<< Size of the block including this header, with heapBLOCK_FREE set while it is free. */
+	struct TLSF_BLOCK *pxNextFree;		/*<< Free list links, only valid while the block is free. */
+	struct TLSF_BLOCK *pxPrevFree;
+} TlsfBlock_t;
+
+/* The part of the header a used block keeps. */
+#define heapHEADER_SIZE				( ( size_t ) offsetof( TlsfBlock_t, pxNextFree ) )
+
+/* A block must be able to hold its free list links once it is freed. */
+#define heapMINIMUM_BLOCK_SIZE		( ( size_t ) sizeof( TlsfBlock_t ) )
+
+/* A negative array size fails the build if the heap cannot be indexed, or if
+the header would leave payloads misaligned. */
+typedef char heapHEAP_SIZE_CHECK[ ( configTOTAL_HEAP_SIZE < ( ( size_t ) 1 << heapFL_INDEX_MAX ) ) ? 1 : -1 ];
+typedef char heapHEADER_ALIGNMENT_CHECK[ ( ( heapHEADER_SIZE & portBYTE_ALIGNMENT_MASK ) == 0 ) ? 1 : -1 ];
+typedef char heapFIRST_LEVEL_MAP_CHECK[ ( heapFL_INDEX_COUNT < 32 ) ? 1 : -1 ];
+
+/* Allocate the memory for the heap.  The struct is used to force byte
+alignment without using any non-portable code. */
+static union xRTOS_HEAP
+{
+	#if portBYTE_ALIGNMENT == 8
+		volatile portDOUBLE dDummy;
+	#else
+		volatile unsigned long ulDummy;
+	#endif
+	unsigned char ucHeap[ configTOTAL_HEAP_SIZE ];
+} xHeap;
+
+/* Ensure the end marker will end up on the correct byte alignment. */
+static const size_t xTotalHeapSize = ( ( size_t ) configTOTAL_HEAP_SIZE ) & ( ( size_t ) ~portBYTE_ALIGNMENT_MASK );
+
+/* Bit n of ulFirstLevelMap is set while ulSecondLevelMap[ n ] is not 0, and
+bit m of ulSecondLevelMap[ n ] while pxFreeLists[ n ][ m ] is not empty. */
+static uint32_t ulFirstLevelMap = 0;
+static uint32_t ulSecondLevelMap[ heapFL_INDEX_COUNT ];
+static TlsfBlock_t *pxFreeLists[ heapFL_INDEX_COUNT ][ heapSL_INDEX_COUNT ];
+
+/* A used block of size 0 at the top of the heap, so every real block has a
+physical successor.  NULL until the heap is initialised. */
+static TlsfBlock_t *pxEnd = NULL;
+
+static size_t xFreeBytesRemaining = 0;
+static size_t xMinimumEverFreeBytesRemaining = 0;
+static size_t xNumberOfFreeBlocks = 0;
+static size_t xNumberOfSuccessfulAllocations = 0;
+static size_t xNumberOfSuccessfulFrees = 0;
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Called automatically to set up the single free block the first time
+ * pvPortMalloc() is called.
+ */
+static void prvHeapInit( void );
+
+/*
+ * The first and second level lists a free block of xBlockSize belongs in.
+ */
+static void prvMappingInsert( size_t xBlockSize, UBaseType_t *puxFirstLevel, UBaseType_t *puxSecondLevel );
+
+/*
+ * Adds a free block to, or takes it off, the list for its size.
+ */
+static void prvInsertFreeBlock( TlsfBlock_t *pxBlock );
+static void prvRemoveFreeBlock( TlsfBlock_t *pxBlock );
+
+/*
+ * A free block of at least xBlockSize bytes, or NULL if there is none.
+ */
+static TlsfBlock_t *prvFindSuitableBlock( size_t xBlockSize );
+
+/*-----------------------------------------------------------*/
+
+/* Index of the highest set bit.  Block sizes are below 1 << heapFL_INDEX_MAX,
+so 32 bits are enough on either target.  The Nios II has no count leading
+zeros instruction, so __builtin_clz() is a libgcc call there; it halves the
+word down to a nibble and looks that up instead, as loads.h does with a byte. */
+#ifdef __nios2__
+static const uint8_t ucHighestBitOfNibble[ 16 ] = { 0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3 };
+
+static inline UBaseType_t prvHighestBit( uint32_t ulValue )
+{
+UBaseType_t uxBit = 0;
+
+	if( ( ulValue >> 16 ) != 0 )
+	{
+		ulValue >>= 16;
+		uxBit += 16;
+	}
+	if( ( ulValue >> 8 ) != 0 )
+	{
+		ulValue >>= 8;
+		uxBit += 8;
+	}
+	if( ( ulValue >> 4 ) != 0 )
+	{
+		ulValue >>= 4;
+		uxBit += 4;
+	}
+	return uxBit + ucHighestBitOfNibble[ ulValue ];
+}
+
+#define heapFLS( x )		prvHighestBit( ( uint32_t ) ( x ) )
+
+/* Index of the lowest set bit, the only one left by x & -x. */
+#define heapFFS( x )		prvHighestBit( ( uint32_t ) ( x ) & ( 0U - ( uint32_t ) ( x ) ) )
+#else
+#define heapFLS( x )		( 31 - __builtin_clz( ( unsigned int ) ( x ) ) )
+
+/* Index of the lowest set bit. */
+#define heapFFS( x )		( __builtin_ctz( ( unsigned int ) ( x ) ) )
+#endif
+
+#define heapBLOCK_SIZE( pxBlock )		( ( pxBlock )->xSizeAndFlags & ~heapBLOCK_FREE )
+#define heapNEXT_PHYS_BLOCK( pxBlock )	( ( TlsfBlock_t * ) ( ( ( unsigned char * ) ( pxBlock ) ) + heapBLOCK_SIZE( pxBlock ) ) )
+
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+TlsfBlock_t *pxBlock, *pxNewBlock;
+size_t xBlockSize;
+void *pvReturn = NULL;
+
+	vTaskSuspendAll();
+	{
+		/* If this is the first call to malloc then the heap will require
+		initialisation to set up the free lists. */
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+
+		if( ( xWantedSize > 0 ) && ( xWantedSize < xTotalHeapSize ) )
+		{
+			/* Make room for the header and keep the next block aligned. */
+			xBlockSize = ( xWantedSize + heapHEADER_SIZE + portBYTE_ALIGNMENT_MASK ) & ~( ( size_t ) portBYTE_ALIGNMENT_MASK );
+			if( xBlockSize < heapMINIMUM_BLOCK_SIZE )
+			{
+				xBlockSize = heapMINIMUM_BLOCK_SIZE;
+			}
+
+			pxBlock = prvFindSuitableBlock( xBlockSize );
+			if( pxBlock != NULL )
+			{
+				prvRemoveFreeBlock( pxBlock );
+
+				/* If the block is larger than required it can be split into
+				two. */
+				if( ( heapBLOCK_SIZE( pxBlock ) - xBlockSize ) >= heapMINIMUM_BLOCK_SIZE )
+				{
+					pxNewBlock = ( TlsfBlock_t * ) ( ( ( unsigned char * ) pxBlock ) + xBlockSize );
+					pxNewBlock->xSizeAndFlags = ( heapBLOCK_SIZE( pxBlock ) - xBlockSize ) | heapBLOCK_FREE;
+					pxNewBlock->pxPrevPhysBlock = pxBlock;
+					heapNEXT_PHYS_BLOCK( pxNewBlock )->pxPrevPhysBlock = pxNewBlock;
+					prvInsertFreeBlock( pxNewBlock );
+
+					pxBlock->xSizeAndFlags = xBlockSize;
+				}
+				else
+				{
+					pxBlock->xSizeAndFlags &= ~heapBLOCK_FREE;
+				}
+
+				xFreeBytesRemaining -= heapBLOCK_SIZE( pxBlock );
+				if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				{
+					xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+				}
+				xNumberOfSuccessfulAllocations++;
+
+				pvReturn = ( void * ) ( ( ( unsigned char * ) pxBlock ) + heapHEADER_SIZE );
+			}
+		}
+
+		traceMALLOC( pvReturn, xWantedSize );
+	}
+	( void ) xTaskResumeAll();
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+TlsfBlock_t *pxBlock, *pxNeighbour;
+
+	if( pv != NULL )
+	{
+		/* The memory being freed will have a header immediately before it. */
+		pxBlock = ( TlsfBlock_t * ) ( ( ( unsigned char * ) pv ) - heapHEADER_SIZE );
+		configASSERT( ( pxBlock->xSizeAndFlags & heapBLOCK_FREE ) == 0 );
+
+		vTaskSuspendAll();
+		{
+			xFreeBytesRemaining += heapBLOCK_SIZE( pxBlock );
+			xNumberOfSuccessfulFrees++;
+			traceFREE( pv, heapBLOCK_SIZE( pxBlock ) );
+
+			pxBlock->xSizeAndFlags |= heapBLOCK_FREE;
+
+			/* Merge with the block above if it is free.  pxEnd is never free,
+			so there is always a block above. */
+			pxNeighbour = heapNEXT_PHYS_BLOCK( pxBlock );
+			if( ( pxNeighbour->xSizeAndFlags & heapBLOCK_FREE ) != 0 )
+			{
+				prvRemoveFreeBlock( pxNeighbour );
+				pxBlock->xSizeAndFlags += heapBLOCK_SIZE( pxNeighbour );
+			}
+
+			/* Merge with the block below if it is free. */
+			pxNeighbour = pxBlock->pxPrevPhysBlock;
+			if( ( pxNeighbour != NULL ) && ( ( pxNeighbour->xSizeAndFlags & heapBLOCK_FREE ) != 0 ) )
+			{
+				prvRemoveFreeBlock( pxNeighbour );
+				pxNeighbour->xSizeAndFlags += heapBLOCK_SIZE( pxBlock );
+				pxBlock = pxNeighbour;
+			}
+
+			heapNEXT_PHYS_BLOCK( pxBlock )->pxPrevPhysBlock = pxBlock;
+			prvInsertFreeBlock( pxBlock );
+		}
+		( void ) xTaskResumeAll();
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( HeapStats_t *pxHeapStats )
+{
+TlsfBlock_t *pxBlock;
+UBaseType_t uxFirstLevel, uxSecondLevel;
+size_t xLargest = 0, xSmallest = 0;
+
+	vTaskSuspendAll();
+	{
+		if( pxEnd == NULL )
+		{
+			prvHeapInit();
+		}
+
+		if( ulFirstLevelMap != 0 )
+		{
+			/* The largest free block is in the highest non-empty list and the
+			smallest in the lowest, but the lists are not sorted. */
+			uxFirstLevel = heapFLS( ulFirstLevelMap );
+			uxSecondLevel = heapFLS( ulSecondLevelMap[ uxFirstLevel ] );
+			for( pxBlock = pxFreeLists[ uxFirstLevel ][ uxSecondLevel ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFree )
+			{
+				if( heapBLOCK_SIZE( pxBlock ) > xLargest )
+				{
+					xLargest = heapBLOCK_SIZE( pxBlock );
+				}
+			}
+
+			xSmallest = xLargest;
+			uxFirstLevel = heapFFS( ulFirstLevelMap );
+			uxSecondLevel = heapFFS( ulSecondLevelMap[ uxFirstLevel ] );
+			for( pxBlock = pxFreeLists[ uxFirstLevel ][ uxSecondLevel ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFree )
+			{
+				if( heapBLOCK_SIZE( pxBlock ) < xSmallest )
+				{
+					xSmallest = heapBLOCK_SIZE( pxBlock );
+				}
+			}
+		}
+
+		pxHeapStats->xAvailableHeapSpaceInBytes = xFreeBytesRemaining;
+		pxHeapStats->xSizeOfLargestFreeBlockInBytes = xLargest;
+		pxHeapStats->xSizeOfSmallestFreeBlockInBytes = xSmallest;
+		pxHeapStats->xNumberOfFreeBlocks = xNumberOfFreeBlocks;
+		pxHeapStats->xMinimumEverFreeBytesRemaining = xMinimumEverFreeBytesRemaining;
+		pxHeapStats->xNumberOfSuccessfulAllocations = xNumberOfSuccessfulAllocations;
+		pxHeapStats->xNumberOfSuccessfulFrees = xNumberOfSuccessfulFrees;
+	}
+	( void ) xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+TlsfBlock_t *pxFirstFreeBlock;
+
+	/* Ensure the start of the heap is aligned. */
+	configASSERT( ( ( ( unsigned long ) xHeap.ucHeap ) & ( ( unsigned long ) portBYTE_ALIGNMENT_MASK ) ) == 0UL );
+
+	/* pxEnd marks the top of the heap.  Only its header is ever touched, but
+	it is given a whole minimum block so that it lies inside the array. */
+	pxEnd = ( TlsfBlock_t * ) ( xHeap.ucHeap + xTotalHeapSize - heapMINIMUM_BLOCK_SIZE );
+	pxEnd->xSizeAndFlags = 0;
+
+	/* To start with there is a single free block that is sized to take up the
+	entire heap space, minus the space taken by pxEnd. */
+	pxFirstFreeBlock = ( TlsfBlock_t * ) xHeap.ucHeap;
+	pxFirstFreeBlock->pxPrevPhysBlock = NULL;
+	pxFirstFreeBlock->xSizeAndFlags = ( xTotalHeapSize - heapMINIMUM_BLOCK_SIZE ) | heapBLOCK_FREE;
+	pxEnd->pxPrevPhysBlock = pxFirstFreeBlock;
+	prvInsertFreeBlock( pxFirstFreeBlock );
+
+	xFreeBytesRemaining = heapBLOCK_SIZE( pxFirstFreeBlock );
+	xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
+static void prvMappingInsert( size_t xBlockSize, UBaseType_t *puxFirstLevel, UBaseType_t *puxSecondLevel )
+{
+UBaseType_t uxBit;
+
+	if( xBlockSize < heapSMALL_BLOCK_SIZE )
+	{
+		*puxFirstLevel = 0;
+		*puxSecondLevel = ( UBaseType_t ) ( xBlockSize >> heapALIGNMENT_LOG2 );
+	}
+	else
+	{
+		uxBit = heapFLS( xBlockSize );
+		*puxFirstLevel = uxBit - heapFL_INDEX_SHIFT + 1;
+		*puxSecondLevel = ( UBaseType_t ) ( xBlockSize >> ( uxBit - heapSL_INDEX_COUNT_LOG2 ) ) - heapSL_INDEX_COUNT;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFreeBlock( TlsfBlock_t *pxBlock )
+{
+UBaseType_t uxFirstLevel, uxSecondLevel;
+TlsfBlock_t *pxHead;
+
+	prvMappingInsert( heapBLOCK_SIZE( pxBlock ), &uxFirstLevel, &uxSecondLevel );
+
+	pxHead = pxFreeLists[ uxFirstLevel ][ uxSecondLevel ];
+	pxBlock->pxNextFree = pxHead;
+	pxBlock->pxPrevFree = NULL;
+	if( pxHead != NULL )
+	{
+		pxHead->pxPrevFree = pxBlock;
+	}
+	pxFreeLists[ uxFirstLevel ][ uxSecondLevel ] = pxBlock;
+
+	ulFirstLevelMap |= ( uint32_t ) 1 << uxFirstLevel;
+	ulSecondLevelMap[ uxFirstLevel ] |= ( uint32_t ) 1 << uxSecondLevel;
+	xNumberOfFreeBlocks++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveFreeBlock( TlsfBlock_t *pxBlock )
+{
+UBaseType_t uxFirstLevel, uxSecondLevel;
+
+	prvMappingInsert( heapBLOCK_SIZE( pxBlock ), &uxFirstLevel, &uxSecondLevel );
+
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPrevFree = pxBlock->pxPrevFree;
+	}
+
+	if( pxBlock->pxPrevFree != NULL )
+	{
+		pxBlock->pxPrevFree->pxNextFree = pxBlock->pxNextFree;
+	}
+	else
+	{
+		/* The block was at the head of its list. */
+		pxFreeLists[ uxFirstLevel ][ uxSecondLevel ] = pxBlock->pxNextFree;
+		if( pxBlock->pxNextFree == NULL )
+		{
+			ulSecondLevelMap[ uxFirstLevel ] &= ~( ( uint32_t ) 1 << uxSecondLevel );
+			if( ulSecondLevelMap[ uxFirstLevel ] == 0 )
+			{
+				ulFirstLevelMap &= ~( ( uint32_t ) 1 << uxFirstLevel );
+			}
+		}
+	}
+
+	xNumberOfFreeBlocks--;
+}
+/*-----------------------------------------------------------*/
+
+static TlsfBlock_t *prvFindSuitableBlock( size_t xBlockSize )
+{
+UBaseType_t uxFirstLevel, uxSecondLevel;
+uint32_t ulMap;
+
+	/* Round up to the next class boundary so that any block in the list
+	found is large enough. */
+	if( xBlockSize >= heapSMALL_BLOCK_SIZE )
+	{
+		xBlockSize += ( ( size_t ) 1 << ( heapFLS( xBlockSize ) - heapSL_INDEX_COUNT_LOG2 ) ) - 1;
+	}
+	prvMappingInsert( xBlockSize, &uxFirstLevel, &uxSecondLevel );
+
+	if( uxFirstLevel >= heapFL_INDEX_COUNT )
+	{
+		return NULL;
+	}
+
+	/* A list in this class at or above the second level index... */
+	ulMap = ulSecondLevelMap[ uxFirstLevel ] & ( ~( uint32_t ) 0 << uxSecondLevel );
+	if( ulMap == 0 )
+	{
+		/* ...or else the smallest non-empty class above it. */
+		ulMap = ulFirstLevelMap & ( ~( uint32_t ) 0 << ( uxFirstLevel + 1 ) );
+		if( ulMap == 0 )
+		{
+			return NULL;
+		}
+
+		uxFirstLevel = heapFFS( ulMap );
+		ulMap = ulSecondLevelMap[ uxFirstLevel ];
+	}
+
+	return pxFreeLists[ uxFirstLevel ][ heapFFS( ulMap ) ];
+}
+
+#endif /* ( configSUPPORT_DYNAMIC_ALLOCATION == 1 ) && ( configUSE_TLSF_HEAP == 1 ) */
@@ -77,6 +77,7 @@
 
 /* Altera includes. */
 #include "sys/alt_irq.h"
+#include "sys/alt_timestamp.h"
 #include "altera_avalon_timer_regs.h"
 #include "priv/alt_irq_table.h"
 
@@ -84,12 +85,52 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
+#if configUSE_TRACE_RECORDER == 1
+	#include "../trace_recorder.h"
+#endif
+
 /* Interrupts are enabled. */
 #define portINITIAL_ESTATUS     ( StackType_t ) 0x01 
 #define SYS_CLK_BASE TIMER1MS_BASE
 #define configTICK_RATE_HZ 1000
 #define configCPU_CLOCK_HZ TIMER1MS_FREQ
 #define SYS_CLK_IRQ TIMER1MS_IRQ
+
+/* Timer counts between two ticks.  The period registers hold one less. */
+#define portTIMER_COUNTS_PER_TICK ( configCPU_CLOCK_HZ / configTICK_RATE_HZ )
+
+#if configUSE_TICKLESS_IDLE == 1
+
+	/* Tick boundaries are kept on the alt_timestamp() clock, see
+	vPortSuppressTicksAndSleep(), so it has to be a timer of its own that
+	counts at the tick timer's rate.  The BSP names it in ALT_TIMESTAMP_CLK. */
+	#define portPASTE( x, y )			x ## y
+	#define portTIMESTAMP( x, y )		portPASTE( x, y )
+	#define portTIMESTAMP_BASE			portTIMESTAMP( ALT_TIMESTAMP_CLK, _BASE )
+	#define portTIMESTAMP_FREQ			portTIMESTAMP( ALT_TIMESTAMP_CLK, _FREQ )
+
+	#if portTIMESTAMP_BASE == SYS_CLK_BASE
+		#error The timestamp timer must not be the tick timer
+	#endif
+	#if portTIMESTAMP_FREQ != configCPU_CLOCK_HZ
+		#error The timestamp timer must run at the tick timer frequency
+	#endif
+
+	/* Longest sleep.  A whole sleep has to fit in half the 32-bit timestamp
+	range to be measured. */
+	#define portMAX_SUPPRESSED_TICKS ( 0x7FFFFFFFUL / portTIMER_COUNTS_PER_TICK )
+
+	/* A sleep is not started this close to the next tick, so that the tick
+	timer cannot time out while it is being reprogrammed.  Timeouts are never
+	this early either, so the tick interrupt takes a tick this close as
+	due. */
+	#define portTICKLESS_MARGIN_COUNTS ( portTIMER_COUNTS_PER_TICK / 10 )
+
+	/* The shortest period the tick timer is restarted with after a sleep. */
+	#define portTICKLESS_MIN_COUNTS ( portTIMER_COUNTS_PER_TICK / 100 )
+
+#endif /* configUSE_TICKLESS_IDLE */
+
 //stack overflow hook
 void vApplicationStackOverflowHook(TaskHandle_t *pxTask, signed char *pcTaskName )
 {
@@ -108,6 +149,30 @@ static void prvSetupTimerInterrupt( void );
  */
 void vPortSysTickHandler( void * context, alt_u32 id );
 
+/*
+ * Restart the tick timer with a first timeout ulCounts from now, then every
+ * ulCounts.
+ */
+static void prvStartTickTimer( uint32_t ulCounts );
+
+/*-----------------------------------------------------------*/
+
+#if configUSE_TICKLESS_IDLE == 1
+
+	/* alt_timestamp() at the boundary of the last tick counted.  The
+	timestamp timer is never stopped, so ticks stay on this grid however
+	often the tick timer is stopped and restarted. */
+	static uint32_t ulLastTickStamp;
+
+	/* Set while the tick timer runs the shortened period that realigns it
+	after a sleep.  The next tick interrupt restores the full period. */
+	static BaseType_t xTickPeriodAltered = pdFALSE;
+
+	/* Written with interrupts disabled and read without a lock. */
+	static TicklessStats_t xTicklessStats;
+
+#endif /* configUSE_TICKLESS_IDLE */
+
 /*-----------------------------------------------------------*/
 
 static void prvReadGp( uint32_t *ulValue )
@@ -196,9 +261,16 @@ void prvSetupTimerInterrupt( void )
 	{
 		/* Configure SysTick to interrupt at the requested rate. */
 		IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_STOP_MSK );
-		IOWR_ALTERA_AVALON_TIMER_PERIODL( SYS_CLK_BASE, ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) & 0xFFFF );
-		IOWR_ALTERA_AVALON_TIMER_PERIODH( SYS_CLK_BASE, ( configCPU_CLOCK_HZ / configTICK_RATE_HZ ) >> 16 );
-		IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_CONT_MSK | ALTERA_AVALON_TIMER_CONTROL_START_MSK | ALTERA_AVALON_TIMER_CONTROL_ITO_MSK );	
+
+		#if configUSE_TICKLESS_IDLE == 1
+		{
+			/* latencyInit() has the timestamp timer running already.  Read
+			before the start, so no tick times out before its boundary. */
+			ulLastTickStamp = alt_timestamp();
+		}
+		#endif
+
+		prvStartTickTimer( portTIMER_COUNTS_PER_TICK );
 	} 
 
 	/* Clear any already pending interrupts generated by the Timer. */
@@ -206,17 +278,167 @@ void prvSetupTimerInterrupt( void )
 }
 /*-----------------------------------------------------------*/
 
-void vPortSysTickHandler( void * context, alt_u32 id )
+static void prvStartTickTimer( uint32_t ulCounts )
 {
-	/* Increment the kernel tick. */
-	if( xTaskIncrementTick() != pdFALSE )
+	/* Writing the period stops the timer and reloads its counter. */
+	IOWR_ALTERA_AVALON_TIMER_PERIODL( SYS_CLK_BASE, ( ulCounts - 1UL ) & 0xFFFF );
+	IOWR_ALTERA_AVALON_TIMER_PERIODH( SYS_CLK_BASE, ( ulCounts - 1UL ) >> 16 );
+	IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_CONT_MSK | ALTERA_AVALON_TIMER_CONTROL_START_MSK | ALTERA_AVALON_TIMER_CONTROL_ITO_MSK );
+}
+/*-----------------------------------------------------------*/
+
+#if configUSE_TICKLESS_IDLE == 0
+
+	void vPortSysTickHandler( void * context, alt_u32 id )
 	{
-        vTaskSwitchContext();
+		/* Increment the kernel tick. */
+		if( xTaskIncrementTick() != pdFALSE )
+		{
+			vTaskSwitchContext();
+		}
+
+		/* Clear the interrupt. */
+		IOWR_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE, ~ALTERA_AVALON_TIMER_STATUS_TO_MSK );
 	}
-		
-	/* Clear the interrupt. */
-	IOWR_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE, ~ALTERA_AVALON_TIMER_STATUS_TO_MSK );
-}
+
+#else /* configUSE_TICKLESS_IDLE */
+
+	void vPortSysTickHandler( void * context, alt_u32 id )
+	{
+	BaseType_t xSwitchRequired = pdFALSE;
+
+		/* Count every tick that has come due on the timestamp clock.  That is
+		one, unless interrupts were held off for longer than a tick.  A tick
+		that has nearly come due is counted too, and the timeout for it then
+		counts none. */
+		while( ( int32_t ) ( alt_timestamp() - ulLastTickStamp ) >= ( int32_t ) ( portTIMER_COUNTS_PER_TICK - portTICKLESS_MARGIN_COUNTS ) )
+		{
+			ulLastTickStamp += portTIMER_COUNTS_PER_TICK;
+			if( xTaskIncrementTick() != pdFALSE )
+			{
+				xSwitchRequired = pdTRUE;
+			}
+		}
+
+		if( xTickPeriodAltered != pdFALSE )
+		{
+			xTickPeriodAltered = pdFALSE;
+			prvStartTickTimer( portTIMER_COUNTS_PER_TICK );
+		}
+
+		if( xSwitchRequired != pdFALSE )
+		{
+			vTaskSwitchContext();
+		}
+
+		/* Clear the interrupt. */
+		IOWR_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE, ~ALTERA_AVALON_TIMER_STATUS_TO_MSK );
+	}
+	/*-----------------------------------------------------------*/
+
+	/*
+	 * Called by the idle task, with the scheduler suspended, when no task
+	 * needs the CPU for xExpectedIdleTime ticks.  The tick timer is set to
+	 * time out at the tick the kernel next has work for, instead of every
+	 * tick, and the tick count is stepped over the ticks slept through on
+	 * wake.
+	 *
+	 * The Altera timer cannot take a new period without restarting its
+	 * count, so tick boundaries and the time slept are measured on the
+	 * alt_timestamp() clock instead.  After a sleep the tick timer is
+	 * restarted with what is left of the current tick, and the next tick
+	 * interrupt restores the full period, so ticks do not drift from the
+	 * timestamp however often the tick is suppressed.
+	 *
+	 * The Nios II has no instruction to wait for an interrupt, so the wait
+	 * polls ipending.  What this saves is the tick interrupts.  Clocks or
+	 * peripherals can be gated around the wait by defining
+	 * configPRE_SLEEP_PROCESSING() and configPOST_SLEEP_PROCESSING().
+	 */
+	void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+	{
+	uint32_t ulElapsed, ulCompleteTicks;
+	alt_u32 ulPending = 0;
+	TickType_t xModifiableIdleTime;
+
+		if( xExpectedIdleTime > portMAX_SUPPRESSED_TICKS )
+		{
+			xExpectedIdleTime = portMAX_SUPPRESSED_TICKS;
+		}
+
+		/* Nothing can make a task ready between confirming the sleep here
+		and stopping the tick. */
+		portDISABLE_INTERRUPTS();
+
+		ulElapsed = alt_timestamp() - ulLastTickStamp;
+		if( ( eTaskConfirmSleepModeStatus() == eAbortSleep ) || ( ulElapsed >= portTIMER_COUNTS_PER_TICK - portTICKLESS_MARGIN_COUNTS ) )
+		{
+			xTicklessStats.ulAborted++;
+			portENABLE_INTERRUPTS();
+			return;
+		}
+
+		/* Time out at the start of the tick the kernel next has work for. */
+		prvStartTickTimer( xExpectedIdleTime * portTIMER_COUNTS_PER_TICK - ( alt_timestamp() - ulLastTickStamp ) );
+
+		/* The application can do its own wait and clear xModifiableIdleTime
+		to skip this one. */
+		xModifiableIdleTime = xExpectedIdleTime;
+		configPRE_SLEEP_PROCESSING( xModifiableIdleTime );
+		if( xModifiableIdleTime > 0 )
+		{
+			/* ipending shows enabled interrupts even while the processor has
+			them disabled. */
+			while( ulPending == 0 )
+			{
+				NIOS2_READ_IPENDING( ulPending );
+			}
+		}
+		configPOST_SLEEP_PROCESSING( xExpectedIdleTime );
+
+		IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_STOP_MSK );
+		IOWR_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE, ~ALTERA_AVALON_TIMER_STATUS_TO_MSK );
+
+		/* The tick the sleep ends on is left to the tick interrupt, which
+		unblocks the tasks waiting for it. */
+		ulCompleteTicks = ( alt_timestamp() - ulLastTickStamp ) / portTIMER_COUNTS_PER_TICK;
+		if( ulCompleteTicks >= xExpectedIdleTime )
+		{
+			ulCompleteTicks = xExpectedIdleTime - 1UL;
+		}
+		vTaskStepTick( ulCompleteTicks );
+		ulLastTickStamp += ulCompleteTicks * portTIMER_COUNTS_PER_TICK;
+
+		/* Time out at the next tick boundary, or straight away if it has
+		passed, then restore the full period. */
+		ulElapsed = alt_timestamp() - ulLastTickStamp;
+		if( ulElapsed + portTICKLESS_MIN_COUNTS < portTIMER_COUNTS_PER_TICK )
+		{
+			prvStartTickTimer( portTIMER_COUNTS_PER_TICK - ulElapsed );
+		}
+		else
+		{
+			prvStartTickTimer( portTICKLESS_MIN_COUNTS );
+		}
+		xTickPeriodAltered = pdTRUE;
+
+		xTicklessStats.ulSleeps++;
+		xTicklessStats.ulTicksSuppressed += ulCompleteTicks;
+		if( ulCompleteTicks > xTicklessStats.ulLongestSleep )
+		{
+			xTicklessStats.ulLongestSleep = ulCompleteTicks;
+		}
+
+		portENABLE_INTERRUPTS();
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortGetTicklessStats( TicklessStats_t *pxStats )
+	{
+		*pxStats = xTicklessStats;
+	}
+
+#endif /* configUSE_TICKLESS_IDLE */
 /*-----------------------------------------------------------*/
 
 /** This function is a re-implementation of the Altera provided function.
@@ -238,6 +460,14 @@ int alt_irq_register( alt_u32 id, void* context, void (*handler)(void*, alt_u32)
 		 * state.
 		 */
 	
+		#if configUSE_TRACE_RECORDER == 1
+		{
+			/* Every interrupt is recorded on its way in and out. */
+			handler = traceRecorderWrapIsr( id, context, handler );
+			context = NULL;
+		}
+		#endif
+
 		status = alt_irq_disable_all ();
 	
 		alt_irq[id].handler = handler;
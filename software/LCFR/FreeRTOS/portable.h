@@ -166,6 +166,24 @@ void vPortInitialiseBlocks( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetMinimumEverFreeHeapSize( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * Fragmentation statistics, filled in by vPortGetHeapStats() in both heap.c
+ * and heap_tlsf.c.  The free block figures walk the free lists, so this is for
+ * reports rather than for hot paths.  Must not be called from an interrupt.
+ */
+typedef struct xHeapStats
+{
+	size_t xAvailableHeapSpaceInBytes;		/*<< The total heap size currently available - this is the sum of all the free blocks, not the largest block that can be allocated. */
+	size_t xSizeOfLargestFreeBlockInBytes;	/*<< The maximum size, in bytes, of all the free blocks within the heap at the time vPortGetHeapStats() is called. */
+	size_t xSizeOfSmallestFreeBlockInBytes;	/*<< The minimum size, in bytes, of all the free blocks within the heap at the time vPortGetHeapStats() is called. */
+	size_t xNumberOfFreeBlocks;				/*<< The number of free memory blocks within the heap at the time vPortGetHeapStats() is called. */
+	size_t xMinimumEverFreeBytesRemaining;	/*<< The minimum amount of total free memory (sum of all free blocks) there has been in the heap since the system booted, the high-water mark of its use. */
+	size_t xNumberOfSuccessfulAllocations;	/*<< The number of calls to pvPortMalloc() that have returned a valid memory block. */
+	size_t xNumberOfSuccessfulFrees;		/*<< The number of calls to vPortFree() that has successfully freed a block of memory. */
+} HeapStats_t;
+
+void vPortGetHeapStats( HeapStats_t *pxHeapStats ) PRIVILEGED_FUNCTION;
+
 /*
  * Setup the hardware ready for the scheduler to take control.  This generally
  * sets up a tick interrupt and sets timers for the correct tick frequency.
@@ -179,6 +197,23 @@ BaseType_t xPortStartScheduler( void ) PRIVILEGED_FUNCTION;
  */
 void vPortEndScheduler( void ) PRIVILEGED_FUNCTION;
 
+#if( configUSE_TICKLESS_IDLE == 1 )
+	/*
+	 * Tickless idle counters, filled in by vPortGetTicklessStats().  Ticks
+	 * suppressed were stepped over on wake instead of each taking a tick
+	 * interrupt.
+	 */
+	typedef struct xTicklessStats
+	{
+		uint32_t ulSleeps;			/*<< Times the idle task stopped the tick. */
+		uint32_t ulAborted;			/*<< Sleeps given up because a task became ready or a tick was due. */
+		uint32_t ulTicksSuppressed;	/*<< Tick interrupts the sleeps saved. */
+		uint32_t ulLongestSleep;	/*<< Most ticks suppressed by one sleep. */
+	} TicklessStats_t;
+
+	void vPortGetTicklessStats( TicklessStats_t *pxStats ) PRIVILEGED_FUNCTION;
+#endif
+
 /*
  * The structures and methods of manipulating the MPU are contained within the
  * port layer.
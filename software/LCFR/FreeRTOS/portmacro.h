@@ -124,6 +124,10 @@ extern void vTaskSwitchContext( void );
 #define portYIELD()									asm volatile ( "trap" );
 #define portEND_SWITCHING_ISR( xSwitchRequired ) 	if( xSwitchRequired ) 	vTaskSwitchContext()
 
+/* Tickless idle, see port.c. */
+extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+
 
 /* Include the port_asm.S file where the Context saving/restoring is defined. */
 __asm__( "\n\t.globl	save_context" );
@@ -101,6 +101,37 @@ typedef void * QueueSetHandle_t;
  */
 typedef void * QueueSetMemberHandle_t;
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+	#include "list.h"
+
+	/* Storage for a queue, semaphore or mutex created by one of the ...Static()
+	functions.  The members mirror the private Queue_t in queue.c, which checks
+	at compile time that the two are the same size; they are not to be
+	accessed directly. */
+	typedef struct xSTATIC_QUEUE
+	{
+		void *pvDummy1[ 3 ];
+		union
+		{
+			void *pvDummy2;
+			UBaseType_t uxDummy2;
+		} u;
+		List_t xDummy3[ 2 ];
+		UBaseType_t uxDummy4[ 3 ];
+		BaseType_t xDummy5[ 2 ];
+		#if ( configUSE_TRACE_FACILITY == 1 )
+			UBaseType_t uxDummy6;
+			uint8_t ucDummy7;
+		#endif
+		#if ( configUSE_QUEUE_SETS == 1 )
+			void *pvDummy8;
+		#endif
+		uint8_t ucDummy9;
+	} StaticQueue_t;
+
+#endif /* configSUPPORT_STATIC_ALLOCATION */
+
 /* For internal use only. */
 #define	queueSEND_TO_BACK		( ( BaseType_t ) 0 )
 #define	queueSEND_TO_FRONT		( ( BaseType_t ) 1 )
@@ -172,6 +203,35 @@ typedef void * QueueSetMemberHandle_t;
  */
 #define xQueueCreate( uxQueueLength, uxItemSize ) xQueueGenericCreate( uxQueueLength, uxItemSize, queueQUEUE_TYPE_BASE )
 
+/**
+ * queue. h
+ * <pre>
+ QueueHandle_t xQueueCreateStatic(
+							  UBaseType_t uxQueueLength,
+							  UBaseType_t uxItemSize,
+							  uint8_t *pucQueueStorageBuffer,
+							  StaticQueue_t *pxQueueBuffer
+						  );
+ * </pre>
+ *
+ * As xQueueCreate(), but the queue lives in storage the application provides
+ * instead of being allocated from the heap.  Only available when
+ * configSUPPORT_STATIC_ALLOCATION is set to 1.
+ *
+ * @param pucQueueStorageBuffer An array of at least uxQueueLength * uxItemSize
+ * bytes to hold the items, or NULL if uxItemSize is 0.
+ *
+ * @param pxQueueBuffer The variable that will hold the queue's data structure.
+ *
+ * @return The handle of the created queue.
+ *
+ * \defgroup xQueueCreateStatic xQueueCreateStatic
+ * \ingroup QueueManagement
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	#define xQueueCreateStatic( uxQueueLength, uxItemSize, pucQueueStorage, pxQueueBuffer ) xQueueGenericCreateStatic( ( uxQueueLength ), ( uxItemSize ), ( pucQueueStorage ), ( pxQueueBuffer ), queueQUEUE_TYPE_BASE )
+#endif
+
 /**
  * queue. h
  * <pre>
@@ -1479,6 +1539,9 @@ BaseType_t xQueueCRReceive( QueueHandle_t xQueue, void *pvBuffer, TickType_t xTi
  * these functions directly.
  */
 QueueHandle_t xQueueCreateMutex( const uint8_t ucQueueType ) PRIVILEGED_FUNCTION;
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	QueueHandle_t xQueueCreateMutexStatic( const uint8_t ucQueueType, StaticQueue_t *pxStaticQueue ) PRIVILEGED_FUNCTION;
+#endif
 QueueHandle_t xQueueCreateCountingSemaphore( const UBaseType_t uxMaxCount, const UBaseType_t uxInitialCount ) PRIVILEGED_FUNCTION;
 void* xQueueGetMutexHolder( QueueHandle_t xSemaphore ) PRIVILEGED_FUNCTION;
 
@@ -1543,6 +1606,13 @@ BaseType_t xQueueGiveMutexRecursive( QueueHandle_t pxMutex ) PRIVILEGED_FUNCTION
  */
 QueueHandle_t xQueueGenericCreate( const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType ) PRIVILEGED_FUNCTION;
 
+/*
+ * The same for queues, semaphores and mutexes in application provided storage.
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	QueueHandle_t xQueueGenericCreateStatic( const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, uint8_t *pucQueueStorage, StaticQueue_t *pxStaticQueue, const uint8_t ucQueueType ) PRIVILEGED_FUNCTION;
+#endif
+
 /*
  * Queue sets provide a mechanism to allow a task to block (pend) on a read
  * operation from multiple queues or semaphores simultaneously.
@@ -78,6 +78,12 @@
 
 typedef QueueHandle_t SemaphoreHandle_t;
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	/* Storage for a semaphore or mutex created by one of the ...Static()
+	macros below. */
+	typedef StaticQueue_t StaticSemaphore_t;
+#endif
+
 #define semBINARY_SEMAPHORE_QUEUE_LENGTH	( ( uint8_t ) 1U )
 #define semSEMAPHORE_QUEUE_ITEM_LENGTH		( ( uint8_t ) 0U )
 #define semGIVE_BLOCK_TIME					( ( TickType_t ) 0U )
@@ -184,6 +190,21 @@ typedef QueueHandle_t SemaphoreHandle_t;
  */
 #define xSemaphoreCreateBinary() xQueueGenericCreate( ( UBaseType_t ) 1, semSEMAPHORE_QUEUE_ITEM_LENGTH, queueQUEUE_TYPE_BINARY_SEMAPHORE )
 
+/**
+ * semphr. h
+ * <pre>SemaphoreHandle_t xSemaphoreCreateBinaryStatic( StaticSemaphore_t *pxSemaphoreBuffer )</pre>
+ *
+ * As xSemaphoreCreateBinary(), but the semaphore lives in pxSemaphoreBuffer
+ * instead of being allocated from the heap.  Only available when
+ * configSUPPORT_STATIC_ALLOCATION is set to 1.
+ *
+ * \defgroup xSemaphoreCreateBinaryStatic xSemaphoreCreateBinaryStatic
+ * \ingroup Semaphores
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	#define xSemaphoreCreateBinaryStatic( pxSemaphoreBuffer ) xQueueGenericCreateStatic( ( UBaseType_t ) 1, semSEMAPHORE_QUEUE_ITEM_LENGTH, NULL, ( pxSemaphoreBuffer ), queueQUEUE_TYPE_BINARY_SEMAPHORE )
+#endif
+
 /**
  * semphr. h
  * <pre>xSemaphoreTake(
@@ -692,6 +713,21 @@ typedef QueueHandle_t SemaphoreHandle_t;
  */
 #define xSemaphoreCreateMutex() xQueueCreateMutex( queueQUEUE_TYPE_MUTEX )
 
+/**
+ * semphr. h
+ * <pre>SemaphoreHandle_t xSemaphoreCreateMutexStatic( StaticSemaphore_t *pxMutexBuffer )</pre>
+ *
+ * As xSemaphoreCreateMutex(), but the mutex lives in pxMutexBuffer instead of
+ * being allocated from the heap.  Only available when
+ * configSUPPORT_STATIC_ALLOCATION is set to 1.
+ *
+ * \defgroup xSemaphoreCreateMutexStatic xSemaphoreCreateMutexStatic
+ * \ingroup Semaphores
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	#define xSemaphoreCreateMutexStatic( pxMutexBuffer ) xQueueCreateMutexStatic( queueQUEUE_TYPE_MUTEX, ( pxMutexBuffer ) )
+#endif
+
 
 /**
  * semphr. h
@@ -184,6 +184,52 @@ typedef enum
 } eSleepModeStatus;
 
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+
+	/* Storage for a task control block created by xTaskCreateStatic().  The
+	members mirror the private TCB_t in tasks.c, which checks at compile time
+	that the two are the same size; they are not to be accessed directly. */
+	typedef struct xSTATIC_TCB
+	{
+		void				*pxDummy1;
+		#if ( portUSING_MPU_WRAPPERS == 1 )
+			xMPU_SETTINGS	xDummy2;
+			BaseType_t		xDummy3;
+		#endif
+		ListItem_t			xDummy4[ 2 ];
+		UBaseType_t			uxDummy5;
+		void				*pxDummy6;
+		char				ucDummy7[ configMAX_TASK_NAME_LEN ];
+		#if ( portSTACK_GROWTH > 0 )
+			void			*pxDummy8;
+		#endif
+		#if ( portCRITICAL_NESTING_IN_TCB == 1 )
+			UBaseType_t		uxDummy9;
+		#endif
+		#if ( configUSE_TRACE_FACILITY == 1 )
+			UBaseType_t		uxDummy10[ 2 ];
+		#endif
+		#if ( configUSE_MUTEXES == 1 )
+			UBaseType_t		uxDummy12[ 2 ];
+		#endif
+		#if ( configUSE_APPLICATION_TASK_TAG == 1 )
+			TaskHookFunction_t pxDummy14;
+		#endif
+		#if ( configGENERATE_RUN_TIME_STATS == 1 )
+			uint32_t		ulDummy16;
+		#endif
+		#if ( configUSE_NEWLIB_REENTRANT == 1 )
+			struct _reent	xDummy17;
+		#endif
+		#if ( configUSE_TASK_NOTIFICATIONS == 1 )
+			uint32_t		ulDummy18;
+			eNotifyAction	eDummy19;
+		#endif
+		uint8_t				ucDummy20;
+	} StaticTask_t;
+
+#endif /* configSUPPORT_STATIC_ALLOCATION */
+
 /**
  * Defines the priority used by the idle task.  This must not be modified.
  *
@@ -412,6 +458,42 @@ TaskHandle_t xHandle;
  */
 #define xTaskCreateRestricted( x, pxCreatedTask ) xTaskGenericCreate( ((x)->pvTaskCode), ((x)->pcName), ((x)->usStackDepth), ((x)->pvParameters), ((x)->uxPriority), (pxCreatedTask), ((x)->puxStackBuffer), ((x)->xRegions) )
 
+/**
+ * task. h
+ *<pre>
+ TaskHandle_t xTaskCreateStatic(
+							  TaskFunction_t pvTaskCode,
+							  const char * const pcName,
+							  uint16_t usStackDepth,
+							  void *pvParameters,
+							  UBaseType_t uxPriority,
+							  StackType_t *puxStackBuffer,
+							  StaticTask_t *pxTaskBuffer
+						  );</pre>
+ *
+ * As xTaskCreate(), but the task's stack and control block are provided by
+ * the application instead of being allocated from the heap.  Both must remain
+ * valid for the lifetime of the task.  Only available when
+ * configSUPPORT_STATIC_ALLOCATION is set to 1.
+ *
+ * @param puxStackBuffer An array of at least usStackDepth StackType_t
+ * entries to use as the task's stack.
+ *
+ * @param pxTaskBuffer The variable that will hold the task's control block.
+ *
+ * @return The handle of the created task, or NULL if either buffer is NULL.
+ *
+ * \defgroup xTaskCreateStatic xTaskCreateStatic
+ * \ingroup Tasks
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	/* The idle task is created statically too, in storage the application
+	provides by defining this callback. */
+	void vApplicationGetIdleTaskMemory( StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer, uint16_t *pusIdleTaskStackSize );
+
+	TaskHandle_t xTaskCreateStatic( TaskFunction_t pxTaskCode, const char * const pcName, const uint16_t usStackDepth, void * const pvParameters, UBaseType_t uxPriority, StackType_t * const puxStackBuffer, StaticTask_t * const pxTaskBuffer ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+#endif
+
 /**
  * task. h
  *<pre>
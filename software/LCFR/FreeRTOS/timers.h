@@ -117,6 +117,24 @@ or interrupt version of the queue send function should be used. */
  */
 typedef void * TimerHandle_t;
 
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	/* Storage for a timer created by xTimerCreateStatic().  The members mirror
+	the private Timer_t in timers.c, which checks at compile time that the two
+	are the same size; they are not to be accessed directly. */
+	typedef struct xSTATIC_TIMER
+	{
+		void				*pvDummy1;
+		ListItem_t			xDummy2;
+		TickType_t			xDummy3;
+		UBaseType_t			uxDummy4;
+		void				*pvDummy5[ 2 ];
+		#if( configUSE_TRACE_FACILITY == 1 )
+			UBaseType_t		uxDummy6;
+		#endif
+		uint8_t				ucDummy7;
+	} StaticTimer_t;
+#endif
+
 /*
  * Defines the prototype to which timer callback functions must conform.
  */
@@ -259,6 +277,37 @@ typedef void (*PendedFunction_t)( void *, uint32_t );
  */
 TimerHandle_t xTimerCreate( const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
 
+/**
+ * TimerHandle_t xTimerCreateStatic(	const char * const pcTimerName,
+ * 										TickType_t xTimerPeriodInTicks,
+ * 										UBaseType_t uxAutoReload,
+ * 										void * pvTimerID,
+ * 										TimerCallbackFunction_t pxCallbackFunction,
+ * 										StaticTimer_t *pxTimerBuffer );
+ *
+ * As xTimerCreate(), but the timer lives in pxTimerBuffer instead of being
+ * allocated from the heap.  Only available when
+ * configSUPPORT_STATIC_ALLOCATION is set to 1.
+ *
+ * @param pxTimerBuffer The variable that will hold the timer's data structure.
+ * It must stay valid for as long as the timer exists.
+ *
+ * @return The handle of the created timer, or NULL if xTimerPeriodInTicks is
+ * 0 or pxTimerBuffer is NULL.
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	TimerHandle_t xTimerCreateStatic( const char * const pcTimerName, const TickType_t xTimerPeriodInTicks, const UBaseType_t uxAutoReload, void * const pvTimerID, TimerCallbackFunction_t pxCallbackFunction, StaticTimer_t *pxTimerBuffer ) PRIVILEGED_FUNCTION; /*lint !e971 Unqualified char types are allowed for strings and single characters only. */
+#endif
+
+/*
+ * When configSUPPORT_STATIC_ALLOCATION is 1 the application provides the
+ * timer service task's TCB and stack through this callback, which the kernel
+ * calls once as the scheduler starts.  *pusTimerTaskStackSize is in words.
+ */
+#if( configSUPPORT_STATIC_ALLOCATION == 1 )
+	void vApplicationGetTimerTaskMemory( StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer, uint16_t *pusTimerTaskStackSize );
+#endif
+
 /**
  * void *pvTimerGetTimerID( TimerHandle_t xTimer );
  *
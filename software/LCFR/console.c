@@ -0,0 +1,166 @@
+// fopencookie() is a GNU extension in both newlib and glibc
+#define _GNU_SOURCE
+
+#include "console.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "altera_avalon_jtag_uart_regs.h"
+#include "io.h"
+#include "sys/alt_irq.h"
+#include "system.h"
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+
+#include "spsc_ring.h"
+
+#define CONSOLE_STREAM_BUFFER 256
+#define CONSOLE_BURST 64 // bytes popped per ring access in the ISR
+
+struct consoleChannel_t {
+  SpscRing ring;
+  uint8_t buffer[CONSOLE_STAGING_SIZE];
+  ConsoleChannel id;
+  // written by the channel's task only and read without a lock
+  volatile uint32_t written;
+  volatile uint32_t dropped;
+  volatile uint32_t droppedWrites;
+};
+
+static struct consoleChannel_t channels[CONSOLE_NUM_CHANNELS];
+
+/*
+ * Written by consoleISR() only and read without a lock.
+ */
+struct consoleStats_t {
+  volatile uint32_t interrupts;
+  volatile uint32_t sent;
+  volatile uint32_t largestBurst;
+};
+
+static struct consoleStats_t consoleStats;
+
+// channel the next drain starts from
+static unsigned int nextChannel;
+
+static void consoleISR(void *context, alt_u32 id) {
+  uint8_t burst[CONSOLE_BURST];
+  uint32_t space = (IORD_ALTERA_AVALON_JTAG_UART_CONTROL(JTAG_UART_BASE) &
+                    ALTERA_AVALON_JTAG_UART_CONTROL_WSPACE_MSK) >>
+                   ALTERA_AVALON_JTAG_UART_CONTROL_WSPACE_OFST;
+  uint32_t sent = 0, pending = 0;
+  unsigned int i;
+
+  consoleStats.interrupts++;
+
+  for (i = 0; i < CONSOLE_NUM_CHANNELS && space > 0; i++) {
+    SpscRing *ring = &channels[(nextChannel + i) % CONSOLE_NUM_CHANNELS].ring;
+    uint32_t wanted, count, k;
+
+    // until the channel is empty or the FIFO full
+    do {
+      wanted = space < CONSOLE_BURST ? space : CONSOLE_BURST;
+      count = spscRingPopN(ring, burst, wanted);
+      for (k = 0; k < count; k++) {
+        IOWR_ALTERA_AVALON_JTAG_UART_DATA(JTAG_UART_BASE, burst[k]);
+      }
+      space -= count;
+      sent += count;
+    } while (count == wanted && space > 0);
+  }
+  nextChannel = (nextChannel + 1) % CONSOLE_NUM_CHANNELS;
+
+  consoleStats.sent += sent;
+  if (sent > consoleStats.largestBurst) {
+    consoleStats.largestBurst = sent;
+  }
+
+  for (i = 0; i < CONSOLE_NUM_CHANNELS; i++) {
+    pending += spscRingCount(&channels[i].ring);
+  }
+  if (pending == 0) {
+    IOWR_ALTERA_AVALON_JTAG_UART_CONTROL(JTAG_UART_BASE, 0);
+  }
+}
+
+void consoleInit(void) {
+  int i;
+
+  for (i = 0; i < CONSOLE_NUM_CHANNELS; i++) {
+    spscRingInit(&channels[i].ring, channels[i].buffer, CONSOLE_STAGING_SIZE,
+                 1);
+    channels[i].id = i;
+  }
+
+  IOWR_ALTERA_AVALON_JTAG_UART_CONTROL(JTAG_UART_BASE, 0);
+  alt_irq_register(JTAG_UART_IRQ, NULL, consoleISR);
+}
+
+bool consoleWrite(ConsoleChannel channel, const void *data, size_t size) {
+  struct consoleChannel_t *c = &channels[channel];
+
+  if (size > CONSOLE_STAGING_SIZE ||
+      !spscRingPushNFromISR(&c->ring, data, size, NULL)) {
+    c->dropped += size;
+    c->droppedWrites++;
+    return false;
+  }
+  c->written += size;
+
+  /*
+   * The ISR disables the write interrupt when it finds every channel empty.
+   * Masking interrupts keeps this enable from landing between that check and
+   * the ISR's disable on the host build, where the ISR runs on another
+   * thread. On the Nios II the ISR cannot be split anyway.
+   */
+  taskENTER_CRITICAL();
+  IOWR_ALTERA_AVALON_JTAG_UART_CONTROL(JTAG_UART_BASE,
+                                       ALTERA_AVALON_JTAG_UART_CONTROL_WE_MSK);
+  taskEXIT_CRITICAL();
+  return true;
+}
+
+static ssize_t streamWrite(void *cookie, const char *data, size_t size) {
+  const struct consoleChannel_t *c = cookie;
+
+  // a dropped buffer still counts as written, or stdio would stop writing
+  consoleWrite(c->id, data, size);
+  return (ssize_t)size;
+}
+
+FILE *consoleOpen(ConsoleChannel channel) {
+  cookie_io_functions_t functions = {.write = streamWrite};
+  FILE *stream = fopencookie(&channels[channel], "w", functions);
+
+  if (stream != NULL) {
+    setvbuf(stream, NULL, _IOFBF, CONSOLE_STREAM_BUFFER);
+  }
+  return stream;
+}
+
+void consoleDump(FILE *out) {
+  static const char *const channelNames[CONSOLE_NUM_CHANNELS] = {
+      "report", "telemetry", "display",
+#ifdef LCFR_TRACE_RECORDER
+      "trace",
+#endif
+  };
+  int i;
+
+  fprintf(out,
+          "console: %lu bytes sent in %lu interrupts, largest burst %lu\n",
+          (unsigned long)consoleStats.sent,
+          (unsigned long)consoleStats.interrupts,
+          (unsigned long)consoleStats.largestBurst);
+  for (i = 0; i < CONSOLE_NUM_CHANNELS; i++) {
+    fprintf(out,
+            "console: %s: %lu bytes staged, %lu dropped in %lu writes, "
+            "%lu waiting\n",
+            channelNames[i], (unsigned long)channels[i].written,
+            (unsigned long)channels[i].dropped,
+            (unsigned long)channels[i].droppedWrites,
+            (unsigned long)spscRingCount(&channels[i].ring));
+  }
+}
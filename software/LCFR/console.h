@@ -0,0 +1,66 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Non-blocking JTAG UART output.
+ *
+ * The HAL driver serialises writers on a lock and blocks them when its buffer
+ * is full, and its small variant busy-waits on the FIFO a byte at a time.
+ * Here each writing task has its own channel, a spsc_ring.h staging ring, so a
+ * write is a copy into that ring and never waits. A write that does not fit is
+ * dropped whole and counted.
+ *
+ * consoleISR(), on the JTAG UART write interrupt, drains the channels round
+ * robin and fills the hardware FIFO as far as it has space on each interrupt.
+ * It disables the interrupt once every channel is empty, and the next write
+ * enables it again.
+ *
+ * consoleInit() takes the JTAG UART interrupt over from the HAL driver, so
+ * from then on stdout and stderr writes that go through the HAL fast driver
+ * stay in its buffer. Print through a channel instead.
+ */
+
+#define CONSOLE_STAGING_SIZE 4096 // bytes per channel, must be a power of two
+
+/**
+ * Each channel may only be written from one task at a time.
+ */
+typedef enum {
+  CONSOLE_REPORT,    // latencyReportTask()
+  CONSOLE_TELEMETRY, // telemetryTask()
+  CONSOLE_DISPLAY,   // vgaRefreshTask()
+#ifdef LCFR_TRACE_RECORDER
+  CONSOLE_TRACE, // traceRecorderTask()
+#endif
+  CONSOLE_NUM_CHANNELS
+} ConsoleChannel;
+
+/**
+ * Sets up the channels and registers consoleISR().
+ */
+void consoleInit(void);
+
+/**
+ * Stages size bytes for the UART. Returns false and drops all of them if the
+ * channel does not have room. Never blocks.
+ */
+bool consoleWrite(ConsoleChannel channel, const void *data, size_t size);
+
+/**
+ * A fully buffered stdio stream onto a channel. Each flush is one
+ * consoleWrite(), so a dropped flush loses whole buffers rather than bytes
+ * here and there. Returns NULL if the stream cannot be created.
+ */
+FILE *consoleOpen(ConsoleChannel channel);
+
+/**
+ * Prints the bytes written and dropped per channel and the drain interrupt
+ * counts.
+ */
+void consoleDump(FILE *out);
+
+#endif /* CONSOLE_H */
@@ -0,0 +1,83 @@
+#include "cpu_load.h"
+
+#include <stdbool.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+
+#include "latency.h"
+
+struct cpuLoadState_t {
+  uint64_t clock;     // widened timestamp as of the last hook
+  uint32_t lastStamp; // latencyNow() as of the last hook
+  uint64_t idle;
+  uint64_t idleSince; // clock when the idle task was switched in
+  bool inIdle;
+};
+
+static struct cpuLoadState_t state;
+static CpuLoad lastDump;
+
+static void advanceClock(void) {
+  uint32_t now = latencyNow();
+
+  state.clock += now - state.lastStamp;
+  state.lastStamp = now;
+}
+
+void cpuLoadTaskSwitchedIn(void *task) {
+  if (task == xTaskGetIdleTaskHandle()) {
+    advanceClock();
+    state.idleSince = state.clock;
+    state.inIdle = true;
+  }
+}
+
+void cpuLoadTaskSwitchedOut(void *task) {
+  if (state.inIdle && task == xTaskGetIdleTaskHandle()) {
+    advanceClock();
+    state.idle += state.clock - state.idleSince;
+    state.inIdle = false;
+  }
+}
+
+void cpuLoadTick(void) { advanceClock(); }
+
+void cpuLoadGet(CpuLoad *load) {
+  taskENTER_CRITICAL();
+  cpuLoadGetFromISR(load);
+  taskEXIT_CRITICAL();
+}
+
+void cpuLoadGetFromISR(CpuLoad *load) {
+  advanceClock();
+  load->elapsed = state.clock;
+  load->idle = state.idle;
+  if (state.inIdle) {
+    load->idle += state.clock - state.idleSince;
+  }
+}
+
+static double busyPercent(uint64_t elapsed, uint64_t idle) {
+  return elapsed == 0 ? 0.0 : 100.0 * (double)(elapsed - idle) / elapsed;
+}
+
+void cpuLoadDump(FILE *out, const CpuLoad *now) {
+  double freq = (double)alt_timestamp_freq();
+
+  if (freq == 0.0) {
+    fprintf(out, "cpu: no timestamp timer\n");
+    return;
+  }
+
+  uint64_t elapsed = now->elapsed - lastDump.elapsed;
+  uint64_t idle = now->idle - lastDump.idle;
+
+  fprintf(out,
+          "cpu: %.1f%% busy over the last %.1f s, %.1f%% over %.1f s, "
+          "idle %.2f s\n",
+          busyPercent(elapsed, idle), elapsed / freq,
+          busyPercent(now->elapsed, now->idle), now->elapsed / freq,
+          now->idle / freq);
+  lastDump = *now;
+}
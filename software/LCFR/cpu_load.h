@@ -0,0 +1,49 @@
+#ifndef CPU_LOAD_H
+#define CPU_LOAD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * CPU utilisation counters.
+ *
+ * The kernel's task switch trace hooks (see FreeRTOSConfig.h) record how long
+ * the idle task runs, on the alt_timestamp() clock that latency.h also uses.
+ * The tick hook widens that clock to 64 bits, so the 32-bit counter may wrap
+ * between switches. Interrupts taken while idle count as idle time.
+ *
+ * Counting relies on latencyInit() having started the timestamp timer;
+ * without one every counter stays at zero. Time before the scheduler starts
+ * counts as busy.
+ */
+
+typedef struct {
+  uint64_t elapsed; // timestamp ticks since latencyInit()
+  uint64_t idle;    // of which the idle task was running
+} CpuLoad;
+
+/**
+ * Current counters, from a task.
+ */
+void cpuLoadGet(CpuLoad *load);
+
+/**
+ * Current counters, from an ISR or with interrupts masked.
+ */
+void cpuLoadGetFromISR(CpuLoad *load);
+
+/**
+ * Prints the utilisation between the previous call and now, and overall. Only
+ * call from one task at a time.
+ */
+void cpuLoadDump(FILE *out, const CpuLoad *now);
+
+/*
+ * Kernel hooks, called with interrupts masked from the trace macros in
+ * FreeRTOSConfig.h.
+ */
+void cpuLoadTaskSwitchedIn(void *task);
+void cpuLoadTaskSwitchedOut(void *task);
+void cpuLoadTick(void);
+
+#endif /* CPU_LOAD_H */
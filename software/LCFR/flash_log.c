@@ -0,0 +1,318 @@
+#include "flash_log.h"
+
+#include "sys/alt_flash.h"
+#include "sys/alt_timestamp.h"
+#include "system.h"
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+
+#include "latency.h"
+#include "spsc_ring.h"
+
+#define FLASH_LOG_MAX_SECTORS 128
+
+struct flashLogSector_t {
+  uint32_t offset; // from the start of the flash
+  uint32_t size;
+};
+
+static alt_flash_fd *flash;
+static struct flashLogSector_t sectors[FLASH_LOG_MAX_SECTORS];
+static int numSectors;
+
+/*
+ * Where the next page goes. Set by flashLogInit() and then written by
+ * flashLogTask() only.
+ */
+static int sector;
+static uint32_t pageOffset; // in the sector, its size once it is full
+static uint32_t sectorErases;
+static uint32_t nextSequence;
+static uint32_t boot;
+
+static SpscRing ring;
+static TelemetryRecord ringBuffer[FLASH_LOG_RING_SIZE];
+
+// assembled by flashLogTask()
+static FlashLogPage page;
+
+// written by the flashLogWrite() caller only and read without a lock
+static volatile uint32_t recordsQueued;
+static volatile uint32_t recordsDropped;
+
+/*
+ * Written by flashLogTask() only and read without a lock. Times are in
+ * timestamp ticks.
+ */
+struct flashLogStats_t {
+  volatile uint32_t pages;
+  volatile uint32_t partialPages;
+  volatile uint32_t records;
+  volatile uint32_t erases;
+  volatile uint32_t errors;
+  volatile uint32_t worstProgram; // one page
+  volatile uint32_t worstErase;   // one sector
+};
+
+static struct flashLogStats_t flashLogStats;
+
+/**
+ * Reads the page header at offset and returns whether it is a valid one.
+ */
+static bool readHeader(uint32_t offset, FlashLogPageHeader *header) {
+  return alt_read_flash(flash, offset, header, sizeof(*header)) == 0 &&
+         header->magic == FLASH_LOG_MAGIC &&
+         header->version == FLASH_LOG_VERSION;
+}
+
+static bool isBlankPage(uint32_t offset) {
+  uint32_t words[FLASH_LOG_PAGE_SIZE / sizeof(uint32_t)];
+  unsigned int i;
+
+  if (alt_read_flash(flash, offset, words, sizeof(words)) != 0) {
+    return false;
+  }
+  for (i = 0; i < FLASH_LOG_PAGE_SIZE / sizeof(uint32_t); i++) {
+    if (words[i] != 0xffffffff) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Lists the erase blocks from FLASH_LOG_OFFSET to the end of the log, and
+ * returns false unless they cover it exactly in whole pages.
+ */
+static bool findSectors(void) {
+  flash_region *regions;
+  int numRegions, i, j;
+  uint32_t end = FLASH_LOG_OFFSET;
+
+  if (alt_get_flash_info(flash, &regions, &numRegions) != 0) {
+    return false;
+  }
+
+  numSectors = 0;
+  for (i = 0; i < numRegions; i++) {
+    for (j = 0; j < regions[i].number_of_blocks; j++) {
+      uint32_t offset = regions[i].offset + j * regions[i].block_size;
+
+      if (offset < FLASH_LOG_OFFSET ||
+          offset >= FLASH_LOG_OFFSET + FLASH_LOG_SIZE) {
+        continue;
+      }
+      if (offset != end || numSectors == FLASH_LOG_MAX_SECTORS ||
+          regions[i].block_size % FLASH_LOG_PAGE_SIZE != 0) {
+        return false;
+      }
+      sectors[numSectors].offset = offset;
+      sectors[numSectors].size = regions[i].block_size;
+      numSectors++;
+      end += regions[i].block_size;
+    }
+  }
+  return end == FLASH_LOG_OFFSET + FLASH_LOG_SIZE;
+}
+
+void flashLogInit(void) {
+  FlashLogPageHeader header;
+  uint32_t newestSequence = 0;
+  int newest = -1, i;
+
+  spscRingInit(&ring, ringBuffer, FLASH_LOG_RING_SIZE,
+               sizeof(TelemetryRecord));
+
+  flash = alt_flash_open_dev(FLASH_CONTROLLER_NAME);
+  if (flash == NULL || !findSectors()) {
+    flash = NULL;
+    return;
+  }
+
+  // the sector whose first page is newest holds the end of the log
+  for (i = 0; i < numSectors; i++) {
+    if (readHeader(sectors[i].offset, &header) &&
+        (newest < 0 || header.sequence > newestSequence)) {
+      newest = i;
+      newestSequence = header.sequence;
+    }
+  }
+
+  if (newest < 0) {
+    // a blank or foreign log, the first page erases the first sector
+    sector = numSectors - 1;
+    pageOffset = sectors[sector].size;
+    sectorErases = 0;
+    nextSequence = 0;
+    boot = 0;
+    return;
+  }
+
+  sector = newest;
+  readHeader(sectors[sector].offset, &header);
+  sectorErases = header.erases;
+  for (pageOffset = 0; pageOffset < sectors[sector].size;
+       pageOffset += FLASH_LOG_PAGE_SIZE) {
+    uint32_t offset = sectors[sector].offset + pageOffset;
+
+    if (isBlankPage(offset)) {
+      break;
+    }
+    // a torn page is neither blank nor valid, and is skipped
+    if (readHeader(offset, &header)) {
+      nextSequence = header.sequence + 1;
+      boot = header.boot + 1;
+    }
+  }
+}
+
+bool flashLogWrite(const TelemetryRecord *records, uint32_t count) {
+  // nothing waits on the ring, flashLogTask() polls it
+  if (flash == NULL || !spscRingPushNFromISR(&ring, records, count, NULL)) {
+    recordsDropped += count;
+    return false;
+  }
+  recordsQueued += count;
+  return true;
+}
+
+/**
+ * Erases the sector after the current one and moves to its start.
+ */
+static void nextSector(void) {
+  FlashLogPageHeader header;
+  uint32_t start, elapsed;
+
+  sector = (sector + 1) % numSectors;
+  pageOffset = 0;
+
+  /*
+   * Sectors are erased in turn, so one whose count cannot be read has been
+   * erased about as often as the one before it.
+   */
+  if (readHeader(sectors[sector].offset, &header)) {
+    sectorErases = header.erases + 1;
+  } else if (sectorErases == 0) {
+    sectorErases = 1;
+  }
+
+  start = latencyNow();
+  if (alt_erase_flash_block(flash, sectors[sector].offset,
+                            sectors[sector].size) != 0) {
+    flashLogStats.errors++;
+  }
+  elapsed = latencyNow() - start;
+
+  flashLogStats.erases++;
+  if (elapsed > flashLogStats.worstErase) {
+    flashLogStats.worstErase = elapsed;
+  }
+}
+
+/**
+ * Programs the first count records of page at the next page in the log.
+ */
+static void writePage(uint32_t count) {
+  uint32_t blockOffset, offset, size, start, elapsed;
+  const uint8_t *data = (const uint8_t *)&page;
+
+  if (pageOffset + FLASH_LOG_PAGE_SIZE > sectors[sector].size) {
+    nextSector();
+  }
+  blockOffset = sectors[sector].offset;
+  offset = blockOffset + pageOffset;
+  pageOffset += FLASH_LOG_PAGE_SIZE;
+
+  page.header.magic = FLASH_LOG_MAGIC;
+  page.header.sequence = nextSequence++;
+  page.header.boot = boot;
+  page.header.erases = sectorErases;
+  page.header.timestampFreq = alt_timestamp_freq();
+  page.header.dropped = recordsDropped;
+  page.header.uptimeMs = xTaskGetTickCount() * portTICK_PERIOD_MS;
+  page.header.count = (uint16_t)count;
+  page.header.version = FLASH_LOG_VERSION;
+  size = sizeof(page.header) + count * sizeof(page.records[0]);
+
+  // the magic goes last, so a page cut short by a power cut is never valid
+  start = latencyNow();
+  if (alt_write_flash_block(flash, blockOffset, offset + sizeof(uint32_t),
+                            data + sizeof(uint32_t),
+                            size - sizeof(uint32_t)) != 0 ||
+      alt_write_flash_block(flash, blockOffset, offset, data,
+                            sizeof(uint32_t)) != 0) {
+    flashLogStats.errors++;
+    return;
+  }
+  elapsed = latencyNow() - start;
+
+  flashLogStats.pages++;
+  flashLogStats.records += count;
+  if (count < FLASH_LOG_RECORDS_PER_PAGE) {
+    flashLogStats.partialPages++;
+  }
+  if (elapsed > flashLogStats.worstProgram) {
+    flashLogStats.worstProgram = elapsed;
+  }
+}
+
+void flashLogTask(void *pvParameters) {
+  TickType_t lastWake = xTaskGetTickCount();
+  TickType_t pendingSince = 0;
+  bool isPending = false;
+  uint32_t count;
+
+  if (flash == NULL) {
+    vTaskDelete(NULL);
+  }
+
+  while (1) {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(FLASH_LOG_POLL_MS));
+
+    while (spscRingCount(&ring) >= FLASH_LOG_RECORDS_PER_PAGE) {
+      writePage(
+          spscRingPopN(&ring, page.records, FLASH_LOG_RECORDS_PER_PAGE));
+      isPending = false;
+    }
+
+    // the rest waits for more to fill a page, but not for long
+    count = spscRingCount(&ring);
+    if (count == 0) {
+      isPending = false;
+    } else if (!isPending) {
+      isPending = true;
+      pendingSince = xTaskGetTickCount();
+    } else if (xTaskGetTickCount() - pendingSince >=
+               pdMS_TO_TICKS(FLASH_LOG_MAX_AGE_MS)) {
+      writePage(spscRingPopN(&ring, page.records, count));
+      isPending = false;
+    }
+  }
+}
+
+void flashLogDump(FILE *out) {
+  double ticksPerMs = alt_timestamp_freq() / 1e3;
+
+  if (flash == NULL) {
+    fprintf(out, "flash log: no flash, %lu records dropped\n",
+            (unsigned long)recordsDropped);
+    return;
+  }
+  fprintf(out,
+          "flash log: %lu of %lu records written in %lu pages, %lu part "
+          "filled; %lu dropped, %lu errors\n",
+          (unsigned long)flashLogStats.records, (unsigned long)recordsQueued,
+          (unsigned long)flashLogStats.pages,
+          (unsigned long)flashLogStats.partialPages,
+          (unsigned long)recordsDropped, (unsigned long)flashLogStats.errors);
+  if (ticksPerMs > 0) {
+    fprintf(out,
+            "flash log: boot %lu, sector %d of %d erased %lu times; %lu "
+            "erases this boot, worst %.1f ms, worst page %.2f ms\n",
+            (unsigned long)boot, sector + 1, numSectors,
+            (unsigned long)sectorErases, (unsigned long)flashLogStats.erases,
+            flashLogStats.worstErase / ticksPerMs,
+            flashLogStats.worstProgram / ticksPerMs);
+  }
+}
@@ -0,0 +1,99 @@
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "telemetry.h"
+
+/*
+ * Telemetry records kept in the CFI flash, so the history leading up to a
+ * power cycle can be read back afterwards.
+ *
+ * flashLogWrite() copies records into a spsc_ring.h ring. flashLogTask() packs
+ * them into FLASH_LOG_PAGE_SIZE pages and programs one page at a time, so a
+ * real-time path never waits for the flash. The CFI driver busy-waits while
+ * the chip programs or erases, so the task runs just above idle and every
+ * other task preempts it.
+ *
+ * The log takes the FLASH_LOG_SIZE bytes from FLASH_LOG_OFFSET. The boot
+ * image sits at the start of the flash, and this range is well clear of it.
+ * Pages are written in order through a sector. At the end of a sector the
+ * next one is erased and written, wrapping at the end of the log. Every
+ * sector is therefore erased equally often, and each erase loses the oldest
+ * sector's pages. At one sample record per FLASH_LOG_SAMPLE_DECIMATION mains
+ * cycles the log holds about half a day of stable mains. Each sector is
+ * erased about twice a day, well inside the 100000 cycles the chip is
+ * rated for.
+ *
+ * A page's magic is programmed last, after the rest of the page. A page
+ * torn by a power cut is therefore never taken for a valid one.
+ * flashLogInit() finds the newest valid page and carries on after it, in a
+ * new boot.
+ *
+ * host/flash_log_read prints the pages in a flash image as CSV.
+ */
+
+#define FLASH_LOG_OFFSET 0x400000 // from the start of the flash
+#define FLASH_LOG_SIZE 0x400000   // a whole number of sectors
+#define FLASH_LOG_PAGE_SIZE 256
+#define FLASH_LOG_RING_SIZE 256 // records, must be a power of two
+#define FLASH_LOG_POLL_MS 500
+#define FLASH_LOG_MAX_AGE_MS 2000 // before a part-filled page is written
+
+// one TELEMETRY_SAMPLE is logged per this many samples while stable
+#define FLASH_LOG_SAMPLE_DECIMATION 10
+
+#define FLASH_LOG_MAGIC 0x474c4641 // bytes 'A' 'F' 'L' 'G' in flash
+#define FLASH_LOG_VERSION 1
+
+/*
+ * Page layout, little-endian. Record sources are not stored, because each
+ * TelemetryEvent comes from only one source.
+ */
+typedef struct {
+  uint32_t magic;         // FLASH_LOG_MAGIC, programmed last
+  uint32_t sequence;      // pages written before this one since the log began
+  uint32_t boot;          // boots before this one since the log began
+  uint32_t erases;        // times this page's sector has been erased
+  uint32_t timestampFreq; // alt_timestamp_freq()
+  uint32_t dropped;       // records dropped on the way to flash this boot
+  uint32_t uptimeMs;      // when the page was programmed
+  uint16_t count;         // records in the page
+  uint16_t version;
+} FlashLogPageHeader;
+
+#define FLASH_LOG_RECORDS_PER_PAGE                                             \
+  ((FLASH_LOG_PAGE_SIZE - sizeof(FlashLogPageHeader)) /                        \
+   sizeof(TelemetryRecord))
+
+typedef struct {
+  FlashLogPageHeader header;
+  TelemetryRecord records[FLASH_LOG_RECORDS_PER_PAGE];
+} FlashLogPage;
+
+/**
+ * Opens the flash and finds where the last boot's log ends. Records are
+ * dropped if the flash cannot be opened.
+ */
+void flashLogInit(void);
+
+/**
+ * Queues count records for the flash. Drops all of them and returns false if
+ * the ring does not have room. Never blocks. Called from one task only.
+ */
+bool flashLogWrite(const TelemetryRecord *records, uint32_t count);
+
+/**
+ * Programs queued records into the flash a page at a time. Run just above
+ * idle.
+ */
+void flashLogTask(void *pvParameters);
+
+/**
+ * Prints the pages written, sector erases and program and erase times.
+ */
+void flashLogDump(FILE *out);
+
+#endif /* FLASH_LOG_H */
@@ -0,0 +1,51 @@
+#include "frequency.h"
+
+fixed_t fixedFrequencyFromSamples(uint32_t samples) {
+  if (samples == 0) {
+    return 0;
+  }
+
+  // 16000 << 16 still fits in 32 bits, so this is a plain integer divide
+  uint32_t scaled = (uint32_t)SAMPLING_FREQUENCY << FREQUENCY_FRACTION_BITS;
+  return (fixed_t)((scaled + samples / 2) / samples);
+}
+
+double doubleFrequencyFromSamples(uint32_t samples) {
+  return (double)SAMPLING_FREQUENCY / (double)samples;
+}
+
+/*
+ * (current - previous) * 2 * current * previous / (current + previous) is the
+ * difference times the harmonic mean of the two frequencies. The harmonic mean
+ * is no larger than either input, so computing it first keeps the product
+ * inside 64 bits for any frequency the analyser can report.
+ */
+fixed_t fixedFrequencyRoc(fixed_t current, fixed_t previous) {
+  int64_t sum = (int64_t)current + previous;
+
+  if (sum <= 0) {
+    return FIXED_CONSTANT(ROC_LIMIT);
+  }
+
+  int64_t harmonicMean = (((int64_t)current * previous) << 1) / sum;
+  int64_t roc =
+      ((int64_t)(current - previous) * harmonicMean) >> FREQUENCY_FRACTION_BITS;
+
+  if (roc > FIXED_CONSTANT(ROC_LIMIT)) {
+    return FIXED_CONSTANT(ROC_LIMIT);
+  }
+  if (roc < -INT32_MAX) {
+    return -INT32_MAX;
+  }
+  return (fixed_t)roc;
+}
+
+double doubleFrequencyRoc(double current, double previous) {
+  double roc =
+      (current - previous) * 2.0 * current * previous / (current + previous);
+
+  if (roc > ROC_LIMIT) {
+    roc = ROC_LIMIT;
+  }
+  return roc;
+}
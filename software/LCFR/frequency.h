@@ -0,0 +1,75 @@
+#ifndef FREQUENCY_H
+#define FREQUENCY_H
+
+#include <stdint.h>
+
+/*
+ * Frequency (Hz) and rate of change (Hz/s) arithmetic for the relay.
+ *
+ * The Nios II has no FPU, so by default both are fixed point with
+ * FREQUENCY_FRACTION_BITS fractional bits (Q16.16). Building with
+ * LCFR_DOUBLE_FREQUENCY defined switches the relay back to double for
+ * validation. Both implementations are always compiled so they can be compared
+ * against each other, see host/frequency_check.c.
+ */
+
+#ifndef FREQUENCY_FRACTION_BITS
+#define FREQUENCY_FRACTION_BITS 16
+#endif
+
+// the integer part has to hold the sampling frequency itself
+#if FREQUENCY_FRACTION_BITS < 1 || FREQUENCY_FRACTION_BITS > 16
+#error "FREQUENCY_FRACTION_BITS must be between 1 and 16"
+#endif
+
+#define SAMPLING_FREQUENCY 16000 // Hz, frequency analyser sample clock
+#define ROC_LIMIT 100            // Hz/s, larger rates of change are clamped
+
+typedef int32_t fixed_t;
+
+#define FIXED_ONE ((fixed_t)1 << FREQUENCY_FRACTION_BITS)
+#define FIXED_CONSTANT(x)                                                      \
+  ((fixed_t)((x) * (double)FIXED_ONE + ((x) < 0 ? -0.5 : 0.5)))
+
+/**
+ * Frequency of a mains cycle that lasted the given number of samples.
+ */
+fixed_t fixedFrequencyFromSamples(uint32_t samples);
+double doubleFrequencyFromSamples(uint32_t samples);
+
+/**
+ * Rate of change between two consecutive cycle frequencies, clamped above at
+ * ROC_LIMIT. The fixed point one is clamped below at -INT32_MAX, so that
+ * frequencyAbs() of it never overflows.
+ */
+fixed_t fixedFrequencyRoc(fixed_t current, fixed_t previous);
+double doubleFrequencyRoc(double current, double previous);
+
+#ifdef LCFR_DOUBLE_FREQUENCY
+
+typedef double frequency_t;
+
+#define FREQUENCY_CONSTANT(x) ((double)(x))
+#define frequencyFromSamples doubleFrequencyFromSamples
+#define frequencyRoc doubleFrequencyRoc
+#define frequencyToDouble(x) ((double)(x))
+#define frequencyToQ16(x) ((int32_t)((x) * 65536.0))
+
+#else
+
+typedef fixed_t frequency_t;
+
+#define FREQUENCY_CONSTANT(x) FIXED_CONSTANT(x)
+#define frequencyFromSamples fixedFrequencyFromSamples
+#define frequencyRoc fixedFrequencyRoc
+#define frequencyToDouble(x) ((double)(x) / FIXED_ONE)
+#define frequencyToQ16(x)                                                      \
+  ((int32_t)(x) * (1 << (16 - FREQUENCY_FRACTION_BITS)))
+
+#endif /* LCFR_DOUBLE_FREQUENCY */
+
+static inline frequency_t frequencyAbs(frequency_t value) {
+  return value < 0 ? -value : value;
+}
+
+#endif /* FREQUENCY_H */
@@ -0,0 +1,234 @@
+/*
+ * Host stand-in for the CFI flash driver and the HAL flash device functions.
+ *
+ * FLASH_CONTROLLER is simulated as FLASH_CONTROLLER_SIZE bytes of NOR flash
+ * in uniform simFLASH_BLOCK_SIZE erase blocks.  Erasing a block sets it to
+ * 0xff.  Programming can only clear bits, so programming over data that was
+ * not erased ANDs the two, as the chip does.  Erases and programs take about
+ * as long as on the DE2-115's S29GL064N.  Like the Altera driver, the caller
+ * busy-waits for them, but other tasks preempt it meanwhile.
+ *
+ * The flash is blank at every run unless LCFR_SIM_FLASH names an image file.
+ * That file is created blank if it does not exist, and the flash is kept in
+ * it, so consecutive runs see what earlier runs wrote, as after a power
+ * cycle.
+ */
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sys/alt_flash.h"
+#include "system.h"
+
+#include "FreeRTOS/FreeRTOS.h"
+
+#include "sim_device.h"
+
+#define simFLASH_BLOCK_SIZE 0x10000
+#define simFLASH_BLOCKS (FLASH_CONTROLLER_SIZE / simFLASH_BLOCK_SIZE)
+#define simFLASH_ERASE_NS 500000000ULL // typical sector erase
+#define simFLASH_BYTE_NS 10000ULL      // per byte with the driver's polling
+
+static alt_flash_dev xFlash;
+static alt_u8 *pucFlash = NULL;
+
+static alt_u64 ullBytesProgrammed = 0;
+static alt_u32 ulBlockErases[simFLASH_BLOCKS];
+
+/*-----------------------------------------------------------*/
+
+/* Waits out a program or erase the way the driver polls the chip. */
+static void prvBusy(alt_u64 ullNs) {
+  alt_u64 ullEnd = ullSimTimeNs() + ullNs;
+
+  while (ullSimTimeNs() < ullEnd) {
+    vPortPreemptionPoint();
+    sched_yield();
+  }
+}
+
+static int prvInRange(int xOffset, int xLength) {
+  return xOffset >= 0 && xLength >= 0 &&
+         xLength <= (int)FLASH_CONTROLLER_SIZE - xOffset;
+}
+
+static int prvRead(alt_flash_dev *pxFlash, int xOffset, void *pvDest,
+                   int xLength) {
+  (void)pxFlash;
+
+  if (!prvInRange(xOffset, xLength)) {
+    return -1;
+  }
+  memcpy(pvDest, pucFlash + xOffset, xLength);
+  return 0;
+}
+
+static int prvEraseBlock(alt_flash_dev *pxFlash, int xOffset) {
+  (void)pxFlash;
+
+  if (!prvInRange(xOffset, simFLASH_BLOCK_SIZE) ||
+      xOffset % simFLASH_BLOCK_SIZE != 0) {
+    return -1;
+  }
+  prvBusy(simFLASH_ERASE_NS);
+  memset(pucFlash + xOffset, 0xff, simFLASH_BLOCK_SIZE);
+  ulBlockErases[xOffset / simFLASH_BLOCK_SIZE]++;
+  return 0;
+}
+
+static int prvWriteBlock(alt_flash_dev *pxFlash, int xBlockOffset,
+                         int xDataOffset, const void *pvData, int xLength) {
+  const alt_u8 *pucData = pvData;
+  int i;
+
+  (void)pxFlash;
+
+  if (!prvInRange(xDataOffset, xLength) || xDataOffset < xBlockOffset ||
+      xDataOffset + xLength > xBlockOffset + simFLASH_BLOCK_SIZE) {
+    return -1;
+  }
+  prvBusy(simFLASH_BYTE_NS * (alt_u64)xLength);
+  for (i = 0; i < xLength; i++) {
+    pucFlash[xDataOffset + i] &= pucData[i];
+  }
+  ullBytesProgrammed += (alt_u64)xLength;
+  return 0;
+}
+
+/* What alt_flash_cfi_write() does: every block the data touches that does not
+already hold it is erased and then programmed, losing the rest of the
+block. */
+static int prvWrite(alt_flash_dev *pxFlash, int xOffset, const void *pvSrc,
+                    int xLength) {
+  const alt_u8 *pucSrc = pvSrc;
+  int xBlock, xChunk, xRet;
+
+  if (!prvInRange(xOffset, xLength)) {
+    return -1;
+  }
+  while (xLength > 0) {
+    xBlock = xOffset - xOffset % simFLASH_BLOCK_SIZE;
+    xChunk = xBlock + simFLASH_BLOCK_SIZE - xOffset;
+    if (xChunk > xLength) {
+      xChunk = xLength;
+    }
+    if (memcmp(pucFlash + xOffset, pucSrc, xChunk) != 0) {
+      if ((xRet = prvEraseBlock(pxFlash, xBlock)) != 0 ||
+          (xRet = prvWriteBlock(pxFlash, xBlock, xOffset, pucSrc, xChunk)) !=
+              0) {
+        return xRet;
+      }
+    }
+    xOffset += xChunk;
+    pucSrc += xChunk;
+    xLength -= xChunk;
+  }
+  return 0;
+}
+
+static int prvGetInfo(alt_flash_dev *pxFlash, flash_region **ppxInfo,
+                      int *pxNumberOfRegions) {
+  *ppxInfo = pxFlash->region_info;
+  *pxNumberOfRegions = pxFlash->number_of_regions;
+  return 0;
+}
+
+/* Maps the LCFR_SIM_FLASH image, or allocates a blank flash without one. */
+static alt_u8 *prvOpenImage(void) {
+  const char *pcPath = getenv("LCFR_SIM_FLASH");
+  struct stat xStat;
+  alt_u8 *pucImage;
+  off_t xOldSize;
+  int xFd;
+
+  if (pcPath == NULL) {
+    pucImage = malloc(FLASH_CONTROLLER_SIZE);
+    if (pucImage != NULL) {
+      memset(pucImage, 0xff, FLASH_CONTROLLER_SIZE);
+    }
+    return pucImage;
+  }
+
+  xFd = open(pcPath, O_RDWR | O_CREAT, 0644);
+  if (xFd < 0 || fstat(xFd, &xStat) != 0 ||
+      (xStat.st_size < (off_t)FLASH_CONTROLLER_SIZE &&
+       ftruncate(xFd, FLASH_CONTROLLER_SIZE) != 0)) {
+    perror(pcPath);
+    if (xFd >= 0) {
+      close(xFd);
+    }
+    return NULL;
+  }
+  xOldSize = xStat.st_size;
+  pucImage = mmap(NULL, FLASH_CONTROLLER_SIZE, PROT_READ | PROT_WRITE,
+                  MAP_SHARED, xFd, 0);
+  close(xFd);
+  if (pucImage == MAP_FAILED) {
+    perror(pcPath);
+    return NULL;
+  }
+
+  /* Whatever the file did not cover is blank. */
+  if (xOldSize < (off_t)FLASH_CONTROLLER_SIZE) {
+    memset(pucImage + xOldSize, 0xff, FLASH_CONTROLLER_SIZE - xOldSize);
+  }
+  return pucImage;
+}
+
+/*-----------------------------------------------------------*/
+
+alt_flash_fd *alt_flash_open_dev(const char *name) {
+  if (strcmp(name, FLASH_CONTROLLER_NAME) != 0) {
+    return NULL;
+  }
+  if (pucFlash == NULL && (pucFlash = prvOpenImage()) == NULL) {
+    return NULL;
+  }
+
+  xFlash.name = FLASH_CONTROLLER_NAME;
+  xFlash.write = prvWrite;
+  xFlash.read = prvRead;
+  xFlash.get_info = prvGetInfo;
+  xFlash.erase_block = prvEraseBlock;
+  xFlash.write_block = prvWriteBlock;
+  xFlash.base_addr = pucFlash;
+  xFlash.length = FLASH_CONTROLLER_SIZE;
+  xFlash.number_of_regions = 1;
+  xFlash.region_info[0].offset = 0;
+  xFlash.region_info[0].region_size = FLASH_CONTROLLER_SIZE;
+  xFlash.region_info[0].number_of_blocks = simFLASH_BLOCKS;
+  xFlash.region_info[0].block_size = simFLASH_BLOCK_SIZE;
+  return &xFlash;
+}
+
+void alt_flash_close_dev(alt_flash_fd *fd) { (void)fd; }
+
+alt_u64 ullSimFlashBytesProgrammed(void) { return ullBytesProgrammed; }
+
+alt_u64 ullSimFlashErases(void) {
+  alt_u64 ullErases = 0;
+  unsigned int i;
+
+  for (i = 0; i < simFLASH_BLOCKS; i++) {
+    ullErases += ulBlockErases[i];
+  }
+  return ullErases;
+}
+
+alt_u32 ulSimFlashMostErases(void) {
+  alt_u32 ulMost = 0;
+  unsigned int i;
+
+  for (i = 0; i < simFLASH_BLOCKS; i++) {
+    if (ulBlockErases[i] > ulMost) {
+      ulMost = ulBlockErases[i];
+    }
+  }
+  return ulMost;
+}
@@ -0,0 +1,50 @@
+/*
+ * Host stand-in for the University Program character buffer driver.  See
+ * altera_up_avalon_video_character_buffer_with_dma.h.
+ */
+
+#include <string.h>
+
+#include "altera_up_avalon_video_character_buffer_with_dma.h"
+
+#define CHAR_BUFFER_X_RESOLUTION 80
+#define CHAR_BUFFER_Y_RESOLUTION 60
+
+static alt_up_char_buffer_dev char_buffer_dev = {
+	CHAR_BUFFER_X_RESOLUTION,
+	CHAR_BUFFER_Y_RESOLUTION,
+};
+
+static unsigned char text[CHAR_BUFFER_Y_RESOLUTION][CHAR_BUFFER_X_RESOLUTION];
+
+alt_up_char_buffer_dev* alt_up_char_buffer_open_dev(const char* name)
+{
+	(void)name;
+	return &char_buffer_dev;
+}
+
+int alt_up_char_buffer_draw(alt_up_char_buffer_dev *char_buffer, unsigned char ch, 
+	unsigned int x, unsigned int y)
+{
+	if (x >= char_buffer->x_resolution || y >= char_buffer->y_resolution)
+		return -1;
+	text[y][x] = ch;
+	return 0;
+}
+
+int alt_up_char_buffer_string(alt_up_char_buffer_dev *char_buffer, const char *ptr, 
+	unsigned int x, unsigned int y)
+{
+	if (x >= char_buffer->x_resolution || y >= char_buffer->y_resolution)
+		return -1;
+	while (*ptr && x < char_buffer->x_resolution)
+		text[y][x++] = (unsigned char)*ptr++;
+	return 0;
+}
+
+int alt_up_char_buffer_clear(alt_up_char_buffer_dev *char_buffer)
+{
+	(void)char_buffer;
+	memset(text, ' ', sizeof(text));
+	return 0;
+}
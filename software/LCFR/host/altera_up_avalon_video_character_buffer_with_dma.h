@@ -0,0 +1,35 @@
+#ifndef __ALTERA_UP_AVALON_VIDEO_CHARACTER_BUFFER_WITH_DMA_H__
+#define __ALTERA_UP_AVALON_VIDEO_CHARACTER_BUFFER_WITH_DMA_H__
+
+/*
+ * Host stand-in for the University Program character buffer driver.  Text is
+ * kept in an in-memory 80x60 grid.
+ */
+
+#include <stddef.h>
+#include <alt_types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+typedef struct alt_up_char_buffer_dev {
+	/// @brief the character resolution in x direction 
+	alt_u32 x_resolution;
+	/// @brief the character resolution in y direction 
+	alt_u32 y_resolution;
+} alt_up_char_buffer_dev;
+
+alt_up_char_buffer_dev* alt_up_char_buffer_open_dev(const char* name);
+int alt_up_char_buffer_draw(alt_up_char_buffer_dev *char_buffer, unsigned char ch, 
+	unsigned int x, unsigned int y);
+int alt_up_char_buffer_string(alt_up_char_buffer_dev *char_buffer, const char *ptr, 
+	unsigned int x, unsigned int y);
+int alt_up_char_buffer_clear(alt_up_char_buffer_dev *char_buffer);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ALTERA_UP_AVALON_VIDEO_CHARACTER_BUFFER_WITH_DMA_H__ */
@@ -0,0 +1,172 @@
+/*
+ * Host stand-in for the University Program pixel buffer DMA driver.  See
+ * altera_up_avalon_video_pixel_buffer_dma.h.
+ */
+
+#include <string.h>
+
+#include "system.h"
+
+#include "FreeRTOS/FreeRTOS.h"
+
+#include "altera_up_avalon_video_pixel_buffer_dma.h"
+#include "sim_device.h"
+
+#define PIXEL_BUFFER_X_RESOLUTION 640
+#define PIXEL_BUFFER_Y_RESOLUTION 480
+#define PIXEL_BUFFER_VSYNC_NS (1000000000ULL / 60)
+
+#define ABS(x)	((x >= 0) ? (x) : (-(x)))
+
+static alt_up_pixel_buffer_dma_dev pixel_buffer_dev = {
+	VIDEO_PIXEL_BUFFER_DMA_BASE,
+	SDRAM_BASE,		/* Front and back buffer share memory until	*/
+	SDRAM_BASE,		/* the back buffer address is changed.		*/
+	ALT_UP_PIXEL_BUFFER_XY_ADDRESS_MODE,
+	ALT_UP_30BIT_COLOR_MODE,
+	PIXEL_BUFFER_X_RESOLUTION,
+	PIXEL_BUFFER_Y_RESOLUTION,
+};
+
+/* Frame memory, indexed by the buffer start addresses seen so far. */
+static unsigned int frame_address[2] = { SDRAM_BASE, 0 };
+static alt_u32 frame[2][PIXEL_BUFFER_Y_RESOLUTION][PIXEL_BUFFER_X_RESOLUTION];
+
+static alt_u64 pixel_writes = 0;
+static alt_u64 swap_deadline_ns = 0;
+
+alt_u64 ullSimPixelWrites(void)
+{
+	return pixel_writes;
+}
+
+static alt_u32 (*frame_of(alt_up_pixel_buffer_dma_dev *pixel_buffer, int backbuffer))[PIXEL_BUFFER_X_RESOLUTION]
+{
+	unsigned int address = (backbuffer == 1) ? pixel_buffer->back_buffer_start_address : pixel_buffer->buffer_start_address;
+
+	if (address == frame_address[1])
+		return frame[1];
+	if (address != frame_address[0] && frame_address[1] == 0) {
+		frame_address[1] = address;
+		return frame[1];
+	}
+	return frame[0];
+}
+
+static void put_pixel(alt_u32 (*buffer)[PIXEL_BUFFER_X_RESOLUTION], int x, int y, int color)
+{
+	/* The hardware wraps out of range coordinates; the stand-in drops them. */
+	if (x < 0 || y < 0 || x >= PIXEL_BUFFER_X_RESOLUTION || y >= PIXEL_BUFFER_Y_RESOLUTION)
+		return;
+	vPortPreemptionPoint();
+	buffer[y][x] = (alt_u32)color;
+	pixel_writes++;
+}
+
+alt_up_pixel_buffer_dma_dev* alt_up_pixel_buffer_dma_open_dev(const char* name)
+{
+	(void)name;
+	return &pixel_buffer_dev;
+}
+
+int alt_up_pixel_buffer_dma_draw(alt_up_pixel_buffer_dma_dev *pixel_buffer, unsigned int color, unsigned int x, unsigned int y)
+{
+	if ((x >= pixel_buffer->x_resolution) || (y >= pixel_buffer->y_resolution))
+		return -1;
+	put_pixel(frame_of(pixel_buffer, 0), (int)x, (int)y, (int)color);
+	return 0;
+}
+
+int alt_up_pixel_buffer_dma_change_back_buffer_address(alt_up_pixel_buffer_dma_dev *pixel_buffer, unsigned int new_address)
+{
+	pixel_buffer->back_buffer_start_address = new_address;
+	return 0;
+}
+
+int alt_up_pixel_buffer_dma_swap_buffers(alt_up_pixel_buffer_dma_dev *pixel_buffer)
+{
+	unsigned int temp = pixel_buffer->back_buffer_start_address;
+	alt_u64 now = ullSimTimeNs();
+
+	/* The swap takes effect at the next vertical refresh. */
+	swap_deadline_ns = (now / PIXEL_BUFFER_VSYNC_NS + 1) * PIXEL_BUFFER_VSYNC_NS;
+	pixel_buffer->back_buffer_start_address = pixel_buffer->buffer_start_address;
+	pixel_buffer->buffer_start_address = temp;
+	return 0;
+}
+
+int alt_up_pixel_buffer_dma_check_swap_buffers_status(alt_up_pixel_buffer_dma_dev *pixel_buffer)
+{
+	(void)pixel_buffer;
+	return (ullSimTimeNs() < swap_deadline_ns) ? 1 : 0;
+}
+
+void alt_up_pixel_buffer_dma_clear_screen(alt_up_pixel_buffer_dma_dev *pixel_buffer, int backbuffer)
+{
+	alt_up_pixel_buffer_dma_draw_box(pixel_buffer, 0, 0, pixel_buffer->x_resolution - 1, pixel_buffer->y_resolution - 1, 0, backbuffer);
+}
+
+void alt_up_pixel_buffer_dma_draw_box(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x0, int y0, int x1, int y1, int color, int backbuffer)
+{
+	alt_u32 (*buffer)[PIXEL_BUFFER_X_RESOLUTION] = frame_of(pixel_buffer, backbuffer);
+	int x, y, temp;
+
+	if (x0 > x1) { temp = x0; x0 = x1; x1 = temp; }
+	if (y0 > y1) { temp = y0; y0 = y1; y1 = temp; }
+	for (y = y0; y <= y1; y++)
+		for (x = x0; x <= x1; x++)
+			put_pixel(buffer, x, y, color);
+}
+
+void alt_up_pixel_buffer_dma_draw_hline(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x0, int x1, int y, int color, int backbuffer)
+{
+	alt_up_pixel_buffer_dma_draw_box(pixel_buffer, x0, y, x1, y, color, backbuffer);
+}
+
+void alt_up_pixel_buffer_dma_draw_vline(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x, int y0, int y1, int color, int backbuffer)
+{
+	alt_up_pixel_buffer_dma_draw_box(pixel_buffer, x, y0, x, y1, color, backbuffer);
+}
+
+void alt_up_pixel_buffer_dma_draw_rectangle(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x0, int y0, int x1, int y1, int color, int backbuffer)
+{
+	alt_up_pixel_buffer_dma_draw_hline(pixel_buffer, x0, x1, y0, color, backbuffer);
+	alt_up_pixel_buffer_dma_draw_hline(pixel_buffer, x0, x1, y1, color, backbuffer);
+	alt_up_pixel_buffer_dma_draw_vline(pixel_buffer, x0, y0, y1, color, backbuffer);
+	alt_up_pixel_buffer_dma_draw_vline(pixel_buffer, x1, y0, y1, color, backbuffer);
+}
+
+void alt_up_pixel_buffer_dma_draw_line(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x0, int y0, int x1, int y1, int color, int backbuffer)
+/* Same Bresenham walk as the BSP driver, so the pixel count per line matches. */
+{
+	alt_u32 (*buffer)[PIXEL_BUFFER_X_RESOLUTION] = frame_of(pixel_buffer, backbuffer);
+	char steep = (ABS(y1 - y0) > ABS(x1 - x0)) ? 1 : 0;
+	int deltax, deltay, error, ystep, x, y, temp;
+
+	if (steep > 0) {
+		temp = x0; x0 = y0; y0 = temp;
+		temp = x1; x1 = y1; y1 = temp;
+	}
+	if (x0 > x1) {
+		temp = x0; x0 = x1; x1 = temp;
+		temp = y0; y0 = y1; y1 = temp;
+	}
+
+	deltax = x1 - x0;
+	deltay = ABS(y1 - y0);
+	error = -(deltax / 2);
+	y = y0;
+	ystep = (y0 < y1) ? 1 : -1;
+
+	for (x = x0; x <= x1; x++) {
+		if (steep == 1)
+			put_pixel(buffer, y, x, color);
+		else
+			put_pixel(buffer, x, y, color);
+		error = error + deltay;
+		if (error > 0) {
+			y = y + ystep;
+			error = error - deltax;
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#ifndef __ALTERA_UP_AVALON_VIDEO_PIXEL_BUFFER_DMA_H__
+#define __ALTERA_UP_AVALON_VIDEO_PIXEL_BUFFER_DMA_H__
+
+/*
+ * Host stand-in for the University Program pixel buffer DMA driver.
+ *
+ * Keeps the same device structure and direct operation API as the driver in
+ * the BSP, but draws into in-memory frame buffers and counts every pixel
+ * written so the cost of a VGA frame can be measured on the host.
+ */
+
+#include <stddef.h>
+#include <alt_types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+#define ALT_UP_PIXEL_BUFFER_CONSECUTIVE_ADDRESS_MODE 1
+#define ALT_UP_PIXEL_BUFFER_XY_ADDRESS_MODE 0
+
+#define ALT_UP_8BIT_COLOR_MODE	1
+#define ALT_UP_16BIT_COLOR_MODE 2
+#define ALT_UP_24BIT_COLOR_MODE 3
+#define ALT_UP_30BIT_COLOR_MODE 4
+
+typedef struct alt_up_pixel_buffer_dma_dev {
+	/// @brief the pixel buffer's slave base address
+	unsigned int base;
+	/// @brief the memory buffer's start address
+	unsigned int buffer_start_address;
+	/// @brief the memory back buffer's start address
+	unsigned int back_buffer_start_address;
+	/// @brief the addressing mode 
+	unsigned int addressing_mode;
+	/// @brief the color mode 
+	unsigned int color_mode;
+	/// @brief the resolution in x direction 
+	unsigned int x_resolution;
+	/// @brief the resolution in y direction 
+	unsigned int y_resolution;
+} alt_up_pixel_buffer_dma_dev;
+
+alt_up_pixel_buffer_dma_dev* alt_up_pixel_buffer_dma_open_dev(const char* name);
+int alt_up_pixel_buffer_dma_draw(alt_up_pixel_buffer_dma_dev *pixel_buffer, unsigned int color, unsigned int x, unsigned int y);
+int alt_up_pixel_buffer_dma_change_back_buffer_address(alt_up_pixel_buffer_dma_dev *pixel_buffer, unsigned int new_address);
+int alt_up_pixel_buffer_dma_swap_buffers(alt_up_pixel_buffer_dma_dev *pixel_buffer);
+int alt_up_pixel_buffer_dma_check_swap_buffers_status(alt_up_pixel_buffer_dma_dev *pixel_buffer);
+void alt_up_pixel_buffer_dma_clear_screen(alt_up_pixel_buffer_dma_dev *pixel_buffer, int backbuffer);
+void alt_up_pixel_buffer_dma_draw_box(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x0, int y0, int x1, int y1, int color, int backbuffer);
+void alt_up_pixel_buffer_dma_draw_hline(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x0, int x1, int y, int color, int backbuffer);
+void alt_up_pixel_buffer_dma_draw_vline(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x, int y0, int y1, int color, int backbuffer);
+void alt_up_pixel_buffer_dma_draw_rectangle(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x0, int y0, int x1, int y1, int color, int backbuffer);
+void alt_up_pixel_buffer_dma_draw_line(alt_up_pixel_buffer_dma_dev *pixel_buffer, int x0, int y0, int x1, int y1, int color, int backbuffer);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ALTERA_UP_AVALON_VIDEO_PIXEL_BUFFER_DMA_H__ */
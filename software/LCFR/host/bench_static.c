@@ -0,0 +1,31 @@
+/*
+ * Idle and timer task memory for the benchmarks that run the kernel, when
+ * built with LCFR_STATIC_ALLOCATION, which has no heap.  Each benchmark
+ * allocates its own kernel objects.
+ */
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+
+#if configSUPPORT_STATIC_ALLOCATION == 1
+static StaticTask_t xIdleTaskBuffer;
+static StackType_t xIdleTaskStack[configMINIMAL_STACK_SIZE];
+static StaticTask_t xTimerTaskBuffer;
+static StackType_t xTimerTaskStack[configTIMER_TASK_STACK_DEPTH];
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint16_t *pusIdleTaskStackSize) {
+  *ppxIdleTaskTCBBuffer = &xIdleTaskBuffer;
+  *ppxIdleTaskStackBuffer = xIdleTaskStack;
+  *pusIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+                                    StackType_t **ppxTimerTaskStackBuffer,
+                                    uint16_t *pusTimerTaskStackSize) {
+  *ppxTimerTaskTCBBuffer = &xTimerTaskBuffer;
+  *ppxTimerTaskStackBuffer = xTimerTaskStack;
+  *pusTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Reader for the flash log written by ../flash_log.c.
+ *
+ * Reads a flash image from the file named on the command line, or stdin, and
+ * prints every record in the log as a CSV row, oldest first.  The image can
+ * be the whole flash, such as an LCFR_SIM_FLASH file, or just the log: pages
+ * are found by their magic at every FLASH_LOG_PAGE_SIZE boundary and put in
+ * order by their sequence numbers.
+ *
+ * The first column is the boot the record was logged in.  Times are seconds
+ * on the alt_timestamp() clock from the first record of that boot that is
+ * still in the log, unwrapped as telemetry_decode does.  As there, records of
+ * different sources logged close together can be out of time order.  A row
+ * with the event "lost pages" marks a gap in the sequence, and one with the
+ * event "dropped" marks records the relay could not queue for the flash.  A
+ * summary of each boot goes to stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_log.h"
+#include "read_all.h"
+#include "telemetry_csv.h"
+
+typedef struct PAGE_REF {
+  uint32_t ulSequence;
+  size_t xOffset;
+} xPageRef;
+
+typedef struct BOOT_STATE {
+  uint32_t ulBoot;
+  uint32_t ulLastTimestamp;
+  long long llTime; // unwrapped timestamp ticks since the boot's first record
+  int xStarted;
+  uint32_t ulDropped;
+  unsigned long ulPages;
+  unsigned long ulRecords;
+  uint32_t ulUptimeMs; // of its last page
+  uint32_t ulErases;   // most of any of its pages' sectors
+} xBootState;
+
+static int prvCompareSequence(const void *pvA, const void *pvB) {
+  const xPageRef *pxA = pvA, *pxB = pvB;
+
+  return pxA->ulSequence < pxB->ulSequence
+             ? -1
+             : pxA->ulSequence > pxB->ulSequence;
+}
+
+static void prvBootSummary(const xBootState *pxBoot) {
+  fprintf(stderr,
+          "boot %lu: %lu records in %lu pages, last written %.1f s after "
+          "boot, sectors erased up to %lu times\n",
+          (unsigned long)pxBoot->ulBoot, pxBoot->ulRecords, pxBoot->ulPages,
+          pxBoot->ulUptimeMs / 1e3, (unsigned long)pxBoot->ulErases);
+}
+
+static void prvPrintPage(xBootState *pxBoot, const FlashLogPage *pxPage) {
+  const FlashLogPageHeader *pxHeader = &pxPage->header;
+  double dTime = 0.0;
+  unsigned int i;
+
+  if (pxHeader->dropped != pxBoot->ulDropped) {
+    printf("%lu,,,dropped,,%lu,,,\n", (unsigned long)pxBoot->ulBoot,
+           (unsigned long)(pxHeader->dropped - pxBoot->ulDropped));
+    pxBoot->ulDropped = pxHeader->dropped;
+  }
+
+  for (i = 0; i < pxHeader->count; i++) {
+    const TelemetryRecord *pxRecord = &pxPage->records[i];
+
+    if (!pxBoot->xStarted) {
+      pxBoot->llTime = 0;
+      pxBoot->xStarted = 1;
+    } else {
+      pxBoot->llTime +=
+          (int32_t)(pxRecord->timestamp - pxBoot->ulLastTimestamp);
+    }
+    pxBoot->ulLastTimestamp = pxRecord->timestamp;
+    if (pxHeader->timestampFreq != 0) {
+      dTime = (double)pxBoot->llTime / pxHeader->timestampFreq;
+    }
+
+    printf("%lu,", (unsigned long)pxBoot->ulBoot);
+    vTelemetryCsvRecord(dTime, xTelemetryEventSource(pxRecord->event),
+                        pxRecord);
+  }
+
+  pxBoot->ulPages++;
+  pxBoot->ulRecords += pxHeader->count;
+  pxBoot->ulUptimeMs = pxHeader->uptimeMs;
+  if (pxHeader->erases > pxBoot->ulErases) {
+    pxBoot->ulErases = pxHeader->erases;
+  }
+}
+
+int main(int argc, char **argv) {
+  FILE *pxFile = stdin;
+  unsigned char *pucData;
+  size_t xSize, xOffset, xPages = 0, i;
+  xPageRef *pxPages;
+  xBootState xBoot;
+  FlashLogPage xPage;
+  unsigned long ulLost = 0;
+
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [flash image]\n", argv[0]);
+    return 2;
+  }
+  if (argc == 2 && (pxFile = fopen(argv[1], "rb")) == NULL) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  pucData = pucReadAll(pxFile, &xSize);
+  pxPages = malloc((xSize / FLASH_LOG_PAGE_SIZE + 1) * sizeof(*pxPages));
+  if (pucData == NULL || pxPages == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+
+  for (xOffset = 0; xOffset + FLASH_LOG_PAGE_SIZE <= xSize;
+       xOffset += FLASH_LOG_PAGE_SIZE) {
+    memcpy(&xPage.header, pucData + xOffset, sizeof(xPage.header));
+    if (xPage.header.magic == FLASH_LOG_MAGIC &&
+        xPage.header.version == FLASH_LOG_VERSION &&
+        xPage.header.count <= FLASH_LOG_RECORDS_PER_PAGE) {
+      pxPages[xPages].ulSequence = xPage.header.sequence;
+      pxPages[xPages].xOffset = xOffset;
+      xPages++;
+    }
+  }
+  qsort(pxPages, xPages, sizeof(*pxPages), prvCompareSequence);
+
+  printf("boot," telemetryCSV_COLUMNS "\n");
+  for (i = 0; i < xPages; i++) {
+    memcpy(&xPage, pucData + pxPages[i].xOffset, sizeof(xPage));
+
+    if (i == 0 || xPage.header.boot != xBoot.ulBoot) {
+      if (i != 0) {
+        prvBootSummary(&xBoot);
+      }
+      memset(&xBoot, 0, sizeof(xBoot));
+      xBoot.ulBoot = xPage.header.boot;
+    }
+    if (i != 0 && pxPages[i].ulSequence != pxPages[i - 1].ulSequence + 1) {
+      ulLost += pxPages[i].ulSequence - pxPages[i - 1].ulSequence - 1;
+      printf("%lu,,,lost pages,,%lu,,,\n", (unsigned long)xBoot.ulBoot,
+             (unsigned long)(pxPages[i].ulSequence -
+                             pxPages[i - 1].ulSequence - 1));
+    }
+    prvPrintPage(&xBoot, &xPage);
+  }
+  if (xPages != 0) {
+    prvBootSummary(&xBoot);
+  }
+
+  fprintf(stderr, "%lu pages, %lu lost between them\n", (unsigned long)xPages,
+          ulLost);
+  free(pxPages);
+  free(pucData);
+  return EXIT_SUCCESS;
+}
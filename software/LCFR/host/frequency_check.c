@@ -0,0 +1,171 @@
+/*
+ * Equivalence check between the fixed point and double frequency pipelines in
+ * ../frequency.c.
+ *
+ * Every trace named on the command line (same format as LCFR_SIM_TRACE) is run
+ * through both: frequency from the sample count, rate of change against the
+ * previous cycle, and the stability decision against the default thresholds
+ * in main.c.  The fixed point results must stay within two least significant
+ * bits of the double ones, and the two may only disagree on a decision when
+ * the double value is within that tolerance of its threshold.
+ *
+ * A rate of change too steep for the fixed point range must still come out
+ * unstable, as it does in double, whichever way the frequency moved.
+ *
+ * Exits non-zero if any trace or the clamp check fails.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "frequency.h"
+
+#define checkFREQUENCY_THRESHOLD 49.0
+#define checkROC_THRESHOLD 8.0
+
+typedef struct CHECK_RESULT {
+  unsigned long ulSamples;
+  double dMaxFrequencyError;
+  double dMaxRocError;
+  unsigned long ulFailures;
+  unsigned long ulBoundaryDecisions;
+} xCheckResult;
+
+static double prvToDouble(fixed_t xValue) {
+  return (double)xValue / FIXED_ONE;
+}
+
+static void prvCheckSample(xCheckResult *pxResult, uint32_t ulSamples,
+                           fixed_t *pxPrevious, double *pdPrevious) {
+  const double dLsb = 1.0 / FIXED_ONE;
+  fixed_t xFrequency = fixedFrequencyFromSamples(ulSamples);
+  double dFrequency = doubleFrequencyFromSamples(ulSamples);
+  fixed_t xRoc = fixedFrequencyRoc(xFrequency, *pxPrevious);
+  double dRoc = doubleFrequencyRoc(dFrequency, *pdPrevious);
+  double dFrequencyError = fabs(prvToDouble(xFrequency) - dFrequency);
+  double dRocError = fabs(prvToDouble(xRoc) - dRoc);
+
+  /* Each frequency carries up to half an LSB of rounding, and the difference
+  of two of them is scaled by their harmonic mean. */
+  double dRocTolerance =
+      2.0 * dLsb * (1.0 + 2.0 * dFrequency * *pdPrevious /
+                              (dFrequency + *pdPrevious));
+
+  int xFixedStable = xFrequency >= FIXED_CONSTANT(checkFREQUENCY_THRESHOLD) &&
+                     (xRoc < 0 ? -xRoc : xRoc) <=
+                         FIXED_CONSTANT(checkROC_THRESHOLD);
+  int xDoubleStable =
+      dFrequency >= checkFREQUENCY_THRESHOLD && fabs(dRoc) <= checkROC_THRESHOLD;
+
+  pxResult->ulSamples++;
+  if (dFrequencyError > pxResult->dMaxFrequencyError) {
+    pxResult->dMaxFrequencyError = dFrequencyError;
+  }
+  if (dRocError > pxResult->dMaxRocError) {
+    pxResult->dMaxRocError = dRocError;
+  }
+  if (dFrequencyError > 2.0 * dLsb || dRocError > dRocTolerance) {
+    pxResult->ulFailures++;
+  }
+  if (xFixedStable != xDoubleStable) {
+    if (fabs(dFrequency - checkFREQUENCY_THRESHOLD) <= 2.0 * dLsb ||
+        fabs(fabs(dRoc) - checkROC_THRESHOLD) <= dRocTolerance) {
+      pxResult->ulBoundaryDecisions++;
+    } else {
+      pxResult->ulFailures++;
+    }
+  }
+
+  *pxPrevious = xFrequency;
+  *pdPrevious = dFrequency;
+}
+
+static int prvCheckTrace(const char *pcPath) {
+  FILE *pxFile = fopen(pcPath, "r");
+  xCheckResult xResult = {0};
+  char cLine[64];
+  unsigned long ulCount;
+  fixed_t xPrevious = 0;
+  double dPrevious = 0.0;
+  int xFirst = 1;
+
+  if (pxFile == NULL) {
+    fprintf(stderr, "%s: cannot open\n", pcPath);
+    return 1;
+  }
+
+  while (fgets(cLine, sizeof(cLine), pxFile) != NULL) {
+    if (cLine[0] == '#' || sscanf(cLine, " %lu", &ulCount) != 1 ||
+        ulCount == 0) {
+      continue;
+    }
+    if (xFirst) {
+      /* The relay starts from an empty history, compare from the first
+      complete pair instead. */
+      xPrevious = fixedFrequencyFromSamples((uint32_t)ulCount);
+      dPrevious = doubleFrequencyFromSamples((uint32_t)ulCount);
+      xFirst = 0;
+    }
+    prvCheckSample(&xResult, (uint32_t)ulCount, &xPrevious, &dPrevious);
+  }
+  fclose(pxFile);
+
+  printf("%s: %lu samples, max error %.2e Hz, %.2e Hz/s, "
+         "%lu boundary decisions, %lu failures\n",
+         pcPath, xResult.ulSamples, xResult.dMaxFrequencyError,
+         xResult.dMaxRocError, xResult.ulBoundaryDecisions,
+         xResult.ulFailures);
+
+  return xResult.ulFailures != 0;
+}
+
+/* Frequency steps past either end of the fixed point rate of change range,
+from the largest frequency Q(32 - FREQUENCY_FRACTION_BITS) holds down to
+1 Hz and back. */
+static int prvCheckRocClamp(void) {
+  const fixed_t xSteps[][2] = {
+      {FIXED_ONE, INT32_MAX}, /* current, previous */
+      {INT32_MAX, FIXED_ONE},
+  };
+  int xFailed = 0;
+  unsigned int i;
+
+  for (i = 0; i < sizeof(xSteps) / sizeof(xSteps[0]); i++) {
+    fixed_t xRoc = fixedFrequencyRoc(xSteps[i][0], xSteps[i][1]);
+    double dRoc = doubleFrequencyRoc(prvToDouble(xSteps[i][0]),
+                                     prvToDouble(xSteps[i][1]));
+    fixed_t xAbs = xRoc < 0 ? -xRoc : xRoc;
+    int xFixedStable = xAbs <= FIXED_CONSTANT(checkROC_THRESHOLD);
+    int xDoubleStable = fabs(dRoc) <= checkROC_THRESHOLD;
+
+    printf("roc clamp: %.1f Hz to %.1f Hz, %.1f Hz/s fixed, %.1f Hz/s "
+           "double%s\n",
+           prvToDouble(xSteps[i][1]), prvToDouble(xSteps[i][0]),
+           prvToDouble(xRoc), dRoc,
+           xAbs < 0 || xFixedStable != xDoubleStable ? ", FAILED" : "");
+    if (xAbs < 0 || xFixedStable != xDoubleStable) {
+      xFailed = 1;
+    }
+  }
+  return xFailed;
+}
+
+int main(int argc, char **argv) {
+  int xFailed = 0;
+  int i;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s trace...\n", argv[0]);
+    return 2;
+  }
+
+  printf("Q%d.%d against double\n", 32 - FREQUENCY_FRACTION_BITS,
+         FREQUENCY_FRACTION_BITS);
+  for (i = 1; i < argc; i++) {
+    xFailed |= prvCheckTrace(argv[i]);
+  }
+  xFailed |= prvCheckRocClamp();
+
+  return xFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
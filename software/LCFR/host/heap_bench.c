@@ -0,0 +1,157 @@
+/*
+ * Micro-benchmark of the two heaps: the first fit free list in
+ * ../FreeRTOS/heap.c against the two-level segregated fit allocator in
+ * ../FreeRTOS/heap_tlsf.c.
+ *
+ * The Makefile compiles each heap a second time with its functions renamed,
+ * pvPortMalloc() to pvPortMallocFirstFit() and pvPortMallocTlsf() and so on,
+ * so both run in this one program against the same workload.
+ *
+ * The workload is a table of slots.  Each step picks a slot at random and
+ * frees its block if it holds one, or allocates one of a random size if it
+ * does not, so the table hovers around half full and the heap fragments the
+ * way a long running system's would.  Sizes are log-uniform, every power of two
+ * between the smallest and largest equally likely.  Both heaps see the same
+ * sequence.
+ *
+ * Times are host nanoseconds per call, clock reads included.  The kernel is
+ * not linked: the scheduler suspension both heaps wrap every call in is a
+ * stub here, so the times are the allocators' own.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+
+#define benchSLOTS 1024
+#define benchSTEPS 1000000UL
+#define benchMIN_SIZE 8
+#define benchMAX_SIZE 2048
+#define benchSEED 723
+
+typedef struct BENCH_HEAP {
+  const char *pcName;
+  void *(*pvMalloc)(size_t xSize);
+  void (*vFree)(void *pv);
+  void (*vGetStats)(HeapStats_t *pxStats);
+} xBenchHeap;
+
+void *pvPortMallocFirstFit(size_t xSize);
+void vPortFreeFirstFit(void *pv);
+void vPortGetHeapStatsFirstFit(HeapStats_t *pxStats);
+void *pvPortMallocTlsf(size_t xSize);
+void vPortFreeTlsf(void *pv);
+void vPortGetHeapStatsTlsf(HeapStats_t *pxStats);
+
+static const xBenchHeap xHeaps[] = {
+    {"first fit", pvPortMallocFirstFit, vPortFreeFirstFit,
+     vPortGetHeapStatsFirstFit},
+    {"tlsf", pvPortMallocTlsf, vPortFreeTlsf, vPortGetHeapStatsTlsf},
+};
+
+// nothing else runs, so there is nothing to hold off
+void vTaskSuspendAll(void) {}
+
+BaseType_t xTaskResumeAll(void) { return pdFALSE; }
+
+static void *pvSlots[benchSLOTS];
+
+// latencies of one run, in ns
+static uint32_t ulMallocNs[benchSTEPS];
+static uint32_t ulFreeNs[benchSTEPS];
+
+static double prvNowNs(void) {
+  struct timespec xNow;
+
+  clock_gettime(CLOCK_MONOTONIC, &xNow);
+  return (double)xNow.tv_sec * 1e9 + (double)xNow.tv_nsec;
+}
+
+static int prvCompare(const void *pvA, const void *pvB) {
+  uint32_t ulA = *(const uint32_t *)pvA;
+  uint32_t ulB = *(const uint32_t *)pvB;
+
+  return (ulA > ulB) - (ulA < ulB);
+}
+
+static void prvPrintLatencies(const char *pcWhat, uint32_t *pulNs,
+                              unsigned long ulCount) {
+  if (ulCount == 0) {
+    return;
+  }
+  qsort(pulNs, ulCount, sizeof(pulNs[0]), prvCompare);
+  printf("  %-6s %8lu calls %8lu %8lu %8lu %8lu %8lu\n", pcWhat, ulCount,
+         (unsigned long)pulNs[ulCount / 2],
+         (unsigned long)pulNs[ulCount * 90 / 100],
+         (unsigned long)pulNs[ulCount * 99 / 100],
+         (unsigned long)pulNs[ulCount * 999 / 1000],
+         (unsigned long)pulNs[ulCount - 1]);
+}
+
+static void prvBenchHeap(const xBenchHeap *pxHeap) {
+  unsigned long ulMallocs = 0, ulFrees = 0, ulFailures = 0, ulStep;
+  HeapStats_t xStats;
+  unsigned int i;
+
+  srand(benchSEED);
+  for (ulStep = 0; ulStep < benchSTEPS; ulStep++) {
+    unsigned int uxSlot = (unsigned int)rand() % benchSLOTS;
+    double dStart;
+
+    if (pvSlots[uxSlot] != NULL) {
+      dStart = prvNowNs();
+      pxHeap->vFree(pvSlots[uxSlot]);
+      ulFreeNs[ulFrees++] = (uint32_t)(prvNowNs() - dStart);
+      pvSlots[uxSlot] = NULL;
+    } else {
+      size_t xSize = (size_t)(benchMIN_SIZE *
+                              pow((double)benchMAX_SIZE / benchMIN_SIZE,
+                                  (double)rand() / RAND_MAX));
+
+      dStart = prvNowNs();
+      pvSlots[uxSlot] = pxHeap->pvMalloc(xSize);
+      ulMallocNs[ulMallocs++] = (uint32_t)(prvNowNs() - dStart);
+      if (pvSlots[uxSlot] == NULL) {
+        ulFailures++;
+      }
+    }
+  }
+
+  pxHeap->vGetStats(&xStats);
+  printf("%s:\n", pxHeap->pcName);
+  printf("  %-6s %14s %8s %8s %8s %8s %8s\n", "ns", "", "p50", "p90", "p99",
+         "p99.9", "max");
+  prvPrintLatencies("malloc", ulMallocNs, ulMallocs);
+  prvPrintLatencies("free", ulFreeNs, ulFrees);
+  printf("  %lu failed, %lu bytes free in %lu blocks, largest %lu, "
+         "smallest %lu, high-water mark %lu bytes used\n",
+         ulFailures, (unsigned long)xStats.xAvailableHeapSpaceInBytes,
+         (unsigned long)xStats.xNumberOfFreeBlocks,
+         (unsigned long)xStats.xSizeOfLargestFreeBlockInBytes,
+         (unsigned long)xStats.xSizeOfSmallestFreeBlockInBytes,
+         (unsigned long)(configTOTAL_HEAP_SIZE -
+                         xStats.xMinimumEverFreeBytesRemaining));
+
+  for (i = 0; i < benchSLOTS; i++) {
+    if (pvSlots[i] != NULL) {
+      pxHeap->vFree(pvSlots[i]);
+      pvSlots[i] = NULL;
+    }
+  }
+}
+
+int main(void) {
+  unsigned int i;
+
+  printf("%lu steps over %d slots, %d to %d byte blocks\n", benchSTEPS,
+         benchSLOTS, benchMIN_SIZE, benchMAX_SIZE);
+  for (i = 0; i < sizeof(xHeaps) / sizeof(xHeaps[0]); i++) {
+    prvBenchHeap(&xHeaps[i]);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#ifndef __IO_H__
+#define __IO_H__
+
+/*
+ * Host stand-in for the Nios II HAL io.h.
+ *
+ * The Nios II versions compile to ldwio/stwio instructions against the
+ * Avalon bus.  On the host every access is routed to the simulated
+ * peripherals in sim_device.c, which keep the register state in memory.
+ */
+
+#include <stdint.h>
+
+#include "alt_types.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+extern alt_u32 ulSimRead( alt_u32 ulAddress, int xWidth );
+extern void vSimWrite( alt_u32 ulAddress, alt_u32 ulData, int xWidth );
+
+/* Dynamic bus access functions */
+
+#define __IO_CALC_ADDRESS_DYNAMIC(BASE, OFFSET) \
+  ((alt_u32)(uintptr_t)(BASE) + (alt_u32)(OFFSET))
+
+#define IORD_32DIRECT(BASE, OFFSET) \
+  ulSimRead (__IO_CALC_ADDRESS_DYNAMIC ((BASE), (OFFSET)), 4)
+#define IORD_16DIRECT(BASE, OFFSET) \
+  ulSimRead (__IO_CALC_ADDRESS_DYNAMIC ((BASE), (OFFSET)), 2)
+#define IORD_8DIRECT(BASE, OFFSET) \
+  ulSimRead (__IO_CALC_ADDRESS_DYNAMIC ((BASE), (OFFSET)), 1)
+
+#define IOWR_32DIRECT(BASE, OFFSET, DATA) \
+  vSimWrite (__IO_CALC_ADDRESS_DYNAMIC ((BASE), (OFFSET)), (DATA), 4)
+#define IOWR_16DIRECT(BASE, OFFSET, DATA) \
+  vSimWrite (__IO_CALC_ADDRESS_DYNAMIC ((BASE), (OFFSET)), (DATA), 2)
+#define IOWR_8DIRECT(BASE, OFFSET, DATA) \
+  vSimWrite (__IO_CALC_ADDRESS_DYNAMIC ((BASE), (OFFSET)), (DATA), 1)
+
+/* Native bus access functions */
+
+#define __IO_CALC_ADDRESS_NATIVE(BASE, REGNUM) \
+  ((alt_u32)(uintptr_t)(BASE) + ((alt_u32)(REGNUM) * 4))
+
+#define IORD(BASE, REGNUM) \
+  ulSimRead (__IO_CALC_ADDRESS_NATIVE ((BASE), (REGNUM)), 4)
+#define IOWR(BASE, REGNUM, DATA) \
+  vSimWrite (__IO_CALC_ADDRESS_NATIVE ((BASE), (REGNUM)), (DATA), 4)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __IO_H__ */
@@ -0,0 +1,215 @@
+/*
+ * Micro-benchmark of load selection: the pow() loops shedLoad() and
+ * activateLoad() used to run against the bitmap selection in ../loads.h, for
+ * 5, 32 and 64 loads.
+ *
+ * Each pass picks the load to shed and the load to reconnect for a set of
+ * random load maps.  The bitmap selection by load number is timed with both
+ * ways of finding the highest set bit, __builtin_clz() and the byte table the
+ * Nios II build uses, and every answer is checked against the old loops
+ * first.  The last column times what shedLoad() and activateLoad() run now:
+ * loadsPastDwell() on the candidates, then loadsSelectShed() or
+ * loadsSelectReconnect() by priority rank, with about half the loads still
+ * within their dwell.
+ *
+ * Times are host nanoseconds per shed and reconnect pair.  On the Nios II
+ * pow() is soft float and __builtin_clz() a libgcc call, so the gap there is
+ * wider than here.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NUM_OF_LOADS 64
+#include "loads.h"
+
+#define benchMAPS 4096
+#define benchPASSES 200
+
+#define benchNOW_MS 100000
+#define benchDEFICIT_KW 10
+
+typedef struct BENCH_MAPS {
+  LoadMap xActivated;
+  LoadMap xBlocked;
+} xBenchMaps;
+
+static xBenchMaps xMaps[benchMAPS];
+static volatile LoadMap xSink;
+
+static double prvNowNs(void) {
+  struct timespec xNow;
+
+  clock_gettime(CLOCK_MONOTONIC, &xNow);
+  return (double)xNow.tv_sec * 1e9 + (double)xNow.tv_nsec;
+}
+
+static LoadMap prvRandomMap(int xLoads) {
+  LoadMap xMap = ((LoadMap)rand() << 40) ^ ((LoadMap)rand() << 20) ^ rand();
+
+  return xLoads == 64 ? xMap : xMap & (((LoadMap)1 << xLoads) - 1);
+}
+
+/* The loops as they were, widened to 64 loads. */
+static LoadMap prvOldShed(const xBenchMaps *pxMaps, int xLoads) {
+  LoadMap xPos;
+  int i;
+
+  for (i = 0; i < xLoads; i++) {
+    xPos = (LoadMap)pow(2, i);
+    if ((pxMaps->xBlocked & xPos) == 0) {
+      if ((pxMaps->xActivated & xPos) == xPos) {
+        return xPos;
+      }
+    }
+  }
+  return 0;
+}
+
+static LoadMap prvOldActivate(const xBenchMaps *pxMaps, int xLoads) {
+  LoadMap xPos;
+  int i;
+
+  for (i = xLoads - 1; i >= 0; i--) {
+    xPos = (LoadMap)pow(2, i);
+    if ((pxMaps->xBlocked & xPos) == xPos) {
+      return xPos;
+    }
+  }
+  return 0;
+}
+
+static LoadMap prvNewShed(const xBenchMaps *pxMaps, LoadMap xMask) {
+  return loadLeastImportant(pxMaps->xActivated & ~pxMaps->xBlocked & xMask);
+}
+
+static LoadMap prvNewActivateClz(const xBenchMaps *pxMaps) {
+  LoadMap xLoads = pxMaps->xBlocked;
+
+  if (xLoads == 0) {
+    return 0;
+  }
+  if (xLoads >> 32) {
+    return (LoadMap)1 << (32 + loadHighestBit32Clz((uint32_t)(xLoads >> 32)));
+  }
+  return (LoadMap)1 << loadHighestBit32Clz((uint32_t)xLoads);
+}
+
+static LoadMap prvNewActivateTable(const xBenchMaps *pxMaps) {
+  LoadMap xLoads = pxMaps->xBlocked;
+
+  if (xLoads == 0) {
+    return 0;
+  }
+  if (xLoads >> 32) {
+    return (LoadMap)1 << (32 +
+                          loadHighestBit32Table((uint32_t)(xLoads >> 32)));
+  }
+  return (LoadMap)1 << loadHighestBit32Table((uint32_t)xLoads);
+}
+
+/* As shedLoad() in deficit mode and activateLoad() in ../main.c. */
+static LoadMap prvRankedShed(const xBenchMaps *pxMaps, LoadMap xMask) {
+  return loadsSelectShed(loadsPastDwell(pxMaps->xActivated & ~pxMaps->xBlocked
+                                            & xMask,
+                                        true, benchNOW_MS),
+                         benchDEFICIT_KW);
+}
+
+static LoadMap prvRankedActivate(const xBenchMaps *pxMaps) {
+  return loadsSelectReconnect(
+      loadsPastDwell(pxMaps->xBlocked, false, benchNOW_MS));
+}
+
+static int prvCheck(int xLoads, LoadMap xMask) {
+  int i;
+
+  for (i = 0; i < benchMAPS; i++) {
+    LoadMap xShed = prvOldShed(&xMaps[i], xLoads);
+    LoadMap xActivate = prvOldActivate(&xMaps[i], xLoads);
+
+    if (prvNewShed(&xMaps[i], xMask) != xShed ||
+        prvNewActivateClz(&xMaps[i]) != xActivate ||
+        prvNewActivateTable(&xMaps[i]) != xActivate) {
+      fprintf(stderr, "%d loads: selection differs for map %d\n", xLoads, i);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void prvBench(int xLoads) {
+  LoadMap xMask = xLoads == 64 ? ~(LoadMap)0 : ((LoadMap)1 << xLoads) - 1;
+  double dStart, dOld, dClz, dTable, dRanked;
+  int xPass, i;
+
+  for (i = 0; i < benchMAPS; i++) {
+    xMaps[i].xActivated = prvRandomMap(xLoads);
+    /* Shed loads are a sparse subset of the upper ones, which is the long
+    way round for the old loops. */
+    xMaps[i].xBlocked = prvRandomMap(xLoads) & prvRandomMap(xLoads) &
+                        ~(xMask >> (xLoads / 2));
+  }
+  if (prvCheck(xLoads, xMask)) {
+    exit(EXIT_FAILURE);
+  }
+  /* About half the loads switched within their dwell. */
+  loadsSwitched(~(LoadMap)0, benchNOW_MS - 10000);
+  loadsSwitched(prvRandomMap(xLoads), benchNOW_MS - 100);
+
+  dStart = prvNowNs();
+  for (xPass = 0; xPass < benchPASSES; xPass++) {
+    for (i = 0; i < benchMAPS; i++) {
+      xSink = prvOldShed(&xMaps[i], xLoads);
+      xSink = prvOldActivate(&xMaps[i], xLoads);
+    }
+  }
+  dOld = prvNowNs() - dStart;
+
+  dStart = prvNowNs();
+  for (xPass = 0; xPass < benchPASSES; xPass++) {
+    for (i = 0; i < benchMAPS; i++) {
+      xSink = prvNewShed(&xMaps[i], xMask);
+      xSink = prvNewActivateClz(&xMaps[i]);
+    }
+  }
+  dClz = prvNowNs() - dStart;
+
+  dStart = prvNowNs();
+  for (xPass = 0; xPass < benchPASSES; xPass++) {
+    for (i = 0; i < benchMAPS; i++) {
+      xSink = prvNewShed(&xMaps[i], xMask);
+      xSink = prvNewActivateTable(&xMaps[i]);
+    }
+  }
+  dTable = prvNowNs() - dStart;
+
+  dStart = prvNowNs();
+  for (xPass = 0; xPass < benchPASSES; xPass++) {
+    for (i = 0; i < benchMAPS; i++) {
+      xSink = prvRankedShed(&xMaps[i], xMask);
+      xSink = prvRankedActivate(&xMaps[i]);
+    }
+  }
+  dRanked = prvNowNs() - dStart;
+
+  printf("%6d %12.1f %12.1f %12.1f %12.1f\n", xLoads,
+         dOld / (benchPASSES * benchMAPS), dClz / (benchPASSES * benchMAPS),
+         dTable / (benchPASSES * benchMAPS),
+         dRanked / (benchPASSES * benchMAPS));
+}
+
+int main(void) {
+  srand(1);
+  loadsInit();
+  printf("ns per shed and reconnect, %d random load maps\n", benchMAPS);
+  printf("%6s %12s %12s %12s %12s\n", "loads", "pow loop", "bitmap clz",
+         "bitmap table", "dwell+rank");
+  prvBench(5);
+  prvBench(32);
+  prvBench(64);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+/*
+ * Dwell boundary check for ../loads.c.
+ *
+ * The relay sheds a load at some point within a scheduler tick and records
+ * the tick count, then reconnects it when the load management deadline
+ * (LOAD_MANAGEMENT_TIMER_INTERVAL ms later) reaches the load manager.  With
+ * LCFR_HW_LOAD_TIMER that deadline need not fall on a tick boundary, and the
+ * tick interrupt for the boundary just before it may not have run yet, so the
+ * tick count can read one short of the dwell.  For every phase of the shed
+ * within its tick and every such tick lag, a load whose minOffMs is the
+ * deadline must be past its dwell when the deadline arrives, but not while
+ * it is still more than LOAD_DWELL_SLACK_MS short.
+ *
+ * Exits non-zero if any case fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "loads.h"
+
+#define checkINTERVAL_MS 500 /* LOAD_MANAGEMENT_TIMER_INTERVAL in main.c */
+#define checkSTEPS 10        /* phases and lags tried per tick */
+#define checkSTART_MS 123456 /* shed time, in whole ticks */
+
+/* Tick count at fMs, read before the tick interrupt for a boundary less than
+fLag ms ago has run. */
+static uint32_t prvTickMs(double fMs, double fLag) {
+  uint32_t ulMs = (uint32_t)fMs;
+
+  return (fMs - ulMs) < fLag ? ulMs - 1 : ulMs;
+}
+
+int main(void) {
+  LoadMap xLoad = (LoadMap)1 << 0;
+  unsigned long ulCases = 0, ulFailures = 0;
+  int i, j;
+
+  loadsInit();
+  if (loadTable[0].minOffMs != checkINTERVAL_MS) {
+    fprintf(stderr, "load 0 minOffMs is %u, not the %d ms deadline\n",
+            (unsigned)loadTable[0].minOffMs, checkINTERVAL_MS);
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < checkSTEPS; i++) {
+    for (j = 0; j < checkSTEPS; j++) {
+      double fShed = checkSTART_MS + (double)i / checkSTEPS;
+      double fLag = (double)j / checkSTEPS;
+      uint32_t ulShed = (uint32_t)fShed;
+      uint32_t ulDeadline = prvTickMs(fShed + checkINTERVAL_MS, fLag);
+      uint32_t ulEarly = ulShed + checkINTERVAL_MS - LOAD_DWELL_SLACK_MS - 1;
+
+      /* In time order: a load found past its dwell stays past it. */
+      loadsSwitched(xLoad, ulShed);
+      ulCases++;
+      if (loadsPastDwell(xLoad, false, ulEarly) != 0) {
+        printf("shed at %.1f ms, lag %.1f ms: past its dwell before the "
+               "slack allows (tick %lu)\n",
+               fShed, fLag, (unsigned long)ulEarly);
+        ulFailures++;
+      }
+      if (loadsPastDwell(xLoad, false, ulDeadline) != xLoad) {
+        printf("shed at %.1f ms, lag %.1f ms: not past its dwell at the "
+               "deadline (tick %lu)\n",
+               fShed, fLag, (unsigned long)ulDeadline);
+        ulFailures++;
+      }
+    }
+  }
+
+  printf("dwell: %lu deadlines %d ms after a shed, %lu failures\n", ulCases,
+         checkINTERVAL_MS, ulFailures);
+  return ulFailures != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
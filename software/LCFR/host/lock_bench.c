@@ -0,0 +1,242 @@
+/*
+ * Priority inversion benchmark of the state locks the relay took before its
+ * state was given a single owner, profiled with ../lock_profile.c.
+ *
+ * Stand-ins for the relay's tasks run at their priorities in ../main.c and
+ * take the six state locks as the old main.c did, in the order it declared
+ * them, spinning for a fixed CPU time while they hold them.  The VGA task
+ * holds the stability lock the longest, as the lowest priority task, and the
+ * switch monitor spins without a lock at a priority between it and the tasks
+ * that wait for it.  The switch monitor is woken by the VGA task once that has
+ * taken its lock, rather than at a tick of its own, so every hold overlaps a
+ * spin however the host schedules the simulator.
+ *
+ *     ./lock_bench binary    locks are binary semaphores, as they were
+ *     ./lock_bench mutex     locks are mutexes with priority inheritance
+ *
+ * Each run prints the lock profile after benchRUN_TICKS.  Spinning counts
+ * host loop iterations calibrated at start up, so a task preempted part way
+ * through its spin still spins for the full time once it runs again.  Wait
+ * and hold times are simulated alt_timestamp() microseconds.  The waits and
+ * inversions counted repeat from run to run, the times vary with the host;
+ * compare the mean waits of the two kinds of lock.
+ */
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/semphr.h"
+#include "FreeRTOS/task.h"
+
+#include "sys/alt_timestamp.h"
+
+#include "lock_profile.h"
+
+/* The old main.c's state locks, in the order it took them. */
+#define benchTHRESHOLD 0x01UL
+#define benchBLOCKED 0x02UL
+#define benchACTIVATED 0x04UL
+#define benchSTABILITY 0x08UL
+#define benchMAINTENANCE 0x10UL
+#define benchLOAD_MANAGEMENT 0x20UL
+#define benchNUM_LOCKS 6
+
+#define benchNUM_TASKS 6
+#define benchRUN_TICKS 3000
+#define benchCALIBRATION_SPINS 10000000UL
+#define benchSPINS_PER_YIELD 1024UL
+
+typedef struct {
+  const char *pcName;
+  UBaseType_t uxPriority;
+  TickType_t xPeriod;  /* 0 to wait for benchWAKES_SPINNER instead */
+  TickType_t xPhase;  /* ticks after the start to first wake */
+  uint32_t ulLocks;   /* taken together, lowest bit first */
+  uint32_t ulHoldUs;  /* CPU time with the locks held */
+  uint32_t ulSpinUs;  /* CPU time after giving them */
+  BaseType_t xWakesSpinner; /* wakes the spinner once it holds the locks */
+} xBenchTask;
+
+/*
+ * The VGA task takes the stability lock on the first tick of every ten and
+ * wakes the switch monitor, which preempts it and spins past the next tick,
+ * when the tasks above both wake and wait for the lock.
+ */
+static const xBenchTask xTasks[benchNUM_TASKS] = {
+  { "Analyser", 10, 20, 1, benchSTABILITY | benchMAINTENANCE, 50, 0, pdFALSE },
+  { "LED Manager", 9, 20, 1, benchBLOCKED | benchACTIVATED, 20, 0, pdFALSE },
+  { "Load Manager", 8, 50, 1,
+    benchBLOCKED | benchACTIVATED | benchSTABILITY | benchLOAD_MANAGEMENT,
+    100, 0, pdFALSE },
+  { "Keyboard", 6, 100, 3, benchTHRESHOLD, 20, 0, pdFALSE },
+  { "Switch Monitor", 5, 0, 0, 0, 0, 3000, pdFALSE },
+  { "VGA Display", 1, 10, 0, benchSTABILITY, 2500, 0, pdTRUE },
+};
+
+static const char *const pcLockNames[benchNUM_LOCKS] = {
+  "threshold", "blocked", "activated", "stability", "maintenance",
+  "load management",
+};
+
+#if configSUPPORT_STATIC_ALLOCATION == 1
+/* Kernel objects for LCFR_STATIC_ALLOCATION, see bench_static.c. */
+static StaticSemaphore_t xLockBuffers[benchNUM_LOCKS];
+static StaticTask_t xTaskBuffers[benchNUM_TASKS + 1];
+static StackType_t xTaskStacks[benchNUM_TASKS + 1][configMINIMAL_STACK_SIZE];
+#endif
+
+static ProfiledLock xLocks[benchNUM_LOCKS];
+static BaseType_t xUseMutexes;
+static TaskHandle_t xSpinner;
+
+/* Spin loop iterations per microsecond of host time. */
+static double dSpinsPerUs;
+static volatile uint32_t ulSpins;
+
+static void prvSpin(unsigned long ulCount) {
+  unsigned long i;
+
+  /* A tick that pends a switch is taken here, as at a register access.  On a
+  single CPU host the simulator thread raises the tick only once the spinning
+  thread lets it run. */
+  for (i = 0; i < ulCount; i++) {
+    vPortPreemptionPoint();
+    if (i % benchSPINS_PER_YIELD == 0) {
+      sched_yield();
+    }
+    ulSpins++;
+  }
+}
+
+static void prvSpinUs(uint32_t ulUs) {
+  prvSpin((unsigned long)(ulUs * dSpinsPerUs));
+}
+
+static void prvCalibrate(void) {
+  struct timespec xStart, xEnd;
+  double dNs;
+
+  clock_gettime(CLOCK_MONOTONIC, &xStart);
+  prvSpin(benchCALIBRATION_SPINS);
+  clock_gettime(CLOCK_MONOTONIC, &xEnd);
+  dNs = (double)(xEnd.tv_sec - xStart.tv_sec) * 1e9 +
+        (double)(xEnd.tv_nsec - xStart.tv_nsec);
+  dSpinsPerUs = benchCALIBRATION_SPINS * 1e3 / dNs;
+}
+
+static void prvCreateLocks(void) {
+  SemaphoreHandle_t xHandle;
+  unsigned int i;
+
+  for (i = 0; i < benchNUM_LOCKS; i++) {
+#if configSUPPORT_STATIC_ALLOCATION == 1
+    xHandle = xUseMutexes ? xSemaphoreCreateMutexStatic(&xLockBuffers[i])
+                          : xSemaphoreCreateBinaryStatic(&xLockBuffers[i]);
+#else
+    xHandle = xUseMutexes ? xSemaphoreCreateMutex() : xSemaphoreCreateBinary();
+#endif
+    /* A binary semaphore starts empty, a mutex starts given. */
+    if (!xUseMutexes) {
+      xSemaphoreGive(xHandle);
+    }
+    lockProfileInit(&xLocks[i], pcLockNames[i], xHandle);
+  }
+}
+
+static void prvStateTask(void *pvParameters) {
+  const xBenchTask *pxTask = pvParameters;
+  TickType_t xLastWake = xTaskGetTickCount();
+  int i;
+
+  if (pxTask->xPeriod != 0) {
+    vTaskDelayUntil(&xLastWake, pxTask->xPhase + 1);
+  }
+  for (;;) {
+    if (pxTask->xPeriod == 0) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    for (i = 0; i < benchNUM_LOCKS; i++) {
+      if (pxTask->ulLocks & (1UL << i)) {
+        lockProfileTake(&xLocks[i], portMAX_DELAY);
+      }
+    }
+    if (pxTask->xWakesSpinner) {
+      xTaskNotifyGive(xSpinner);
+    }
+    prvSpinUs(pxTask->ulHoldUs);
+    for (i = benchNUM_LOCKS - 1; i >= 0; i--) {
+      if (pxTask->ulLocks & (1UL << i)) {
+        lockProfileGive(&xLocks[i]);
+      }
+    }
+    prvSpinUs(pxTask->ulSpinUs);
+    if (pxTask->xPeriod != 0) {
+      vTaskDelayUntil(&xLastWake, pxTask->xPeriod);
+    }
+  }
+}
+
+static TaskHandle_t prvCreateTask(TaskFunction_t pxCode, const char *pcName,
+                                  UBaseType_t uxPriority,
+                                  void *pvParameters) {
+  TaskHandle_t xHandle = NULL;
+#if configSUPPORT_STATIC_ALLOCATION == 1
+  static unsigned int uxCreated;
+
+  xHandle = xTaskCreateStatic(pxCode, pcName, configMINIMAL_STACK_SIZE,
+                              pvParameters, uxPriority,
+                              xTaskStacks[uxCreated],
+                              &xTaskBuffers[uxCreated]);
+  uxCreated++;
+#else
+  xTaskCreate(pxCode, pcName, configMINIMAL_STACK_SIZE, pvParameters,
+              uxPriority, &xHandle);
+#endif
+  return xHandle;
+}
+
+static void prvBenchTask(void *pvParameters) {
+  unsigned int i;
+
+  (void)pvParameters;
+
+  prvCalibrate();
+  prvCreateLocks();
+  /* None runs before this task blocks, so the spinner is known by then. */
+  for (i = 0; i < benchNUM_TASKS; i++) {
+    TaskHandle_t xHandle = prvCreateTask(prvStateTask, xTasks[i].pcName,
+                                         xTasks[i].uxPriority,
+                                         (void *)&xTasks[i]);
+
+    if (xTasks[i].xPeriod == 0) {
+      xSpinner = xHandle;
+    }
+  }
+
+  vTaskDelay(benchRUN_TICKS);
+
+  printf("%u ticks with %s state locks\n", benchRUN_TICKS,
+         xUseMutexes ? "mutex" : "binary semaphore");
+  lockProfileDump(stdout);
+
+  exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2 ||
+      (strcmp(argv[1], "binary") != 0 && strcmp(argv[1], "mutex") != 0)) {
+    fprintf(stderr, "usage: %s binary|mutex\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  xUseMutexes = strcmp(argv[1], "mutex") == 0;
+
+  alt_timestamp_start();
+  prvCreateTask(prvBenchTask, "Bench", configMAX_PRIORITIES - 1, NULL);
+  vTaskStartScheduler();
+
+  return EXIT_FAILURE;
+}
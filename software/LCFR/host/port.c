@@ -0,0 +1,572 @@
+/*
+ * POSIX (Linux host) simulation port of FreeRTOS for the LCFR.
+ *
+ * Each task runs on its own pthread.  A thread only executes while it owns the
+ * simulated CPU (pxRunningThread), and ownership only changes hands inside
+ * this file, so the kernel always sees exactly one running task.
+ *
+ * Interrupts are raised on the simulator thread (sim_device.c), which brackets
+ * every handler with vPortEnterInterrupt()/vPortExitInterrupt().  Entry waits
+ * while the running task has interrupts disabled, which gives the kernel the
+ * same critical section guarantees it has on the Nios II.  A context switch
+ * requested by an interrupt is pended and performed the next time the running
+ * task re-enables interrupts, yields or accesses a simulated peripheral.
+ */
+
+/*-----------------------------------------------------------
+ * Implementation of functions defined in portable.h for the host port.
+ *----------------------------------------------------------*/
+
+/* Standard Includes. */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Altera includes. */
+#include "sys/alt_irq.h"
+#include "sys/alt_timestamp.h"
+#include "altera_avalon_timer_regs.h"
+
+/* Scheduler includes. */
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+
+#define SYS_CLK_BASE TIMER1MS_BASE
+#define configCPU_CLOCK_HZ_HOST TIMER1MS_FREQ
+#define SYS_CLK_IRQ TIMER1MS_IRQ
+
+/* Timer counts between two ticks.  The period registers hold one less. */
+#define portTIMER_COUNTS_PER_TICK ( configCPU_CLOCK_HZ_HOST / configTICK_RATE_HZ )
+
+#if configUSE_TICKLESS_IDLE == 1
+
+	/* The same limits as the Nios II port, see FreeRTOS/port.c. */
+	#define portPASTE( x, y )			x ## y
+	#define portTIMESTAMP( x, y )		portPASTE( x, y )
+	#define portTIMESTAMP_BASE			portTIMESTAMP( ALT_TIMESTAMP_CLK, _BASE )
+	#define portTIMESTAMP_FREQ			portTIMESTAMP( ALT_TIMESTAMP_CLK, _FREQ )
+
+	#if portTIMESTAMP_BASE == SYS_CLK_BASE
+		#error The timestamp timer must not be the tick timer
+	#endif
+	#if portTIMESTAMP_FREQ != configCPU_CLOCK_HZ_HOST
+		#error The timestamp timer must run at the tick timer frequency
+	#endif
+	#define portMAX_SUPPRESSED_TICKS ( 0x7FFFFFFFUL / portTIMER_COUNTS_PER_TICK )
+	#define portTICKLESS_MARGIN_COUNTS ( portTIMER_COUNTS_PER_TICK / 10 )
+	#define portTICKLESS_MIN_COUNTS ( portTIMER_COUNTS_PER_TICK / 100 )
+
+#endif /* configUSE_TICKLESS_IDLE */
+
+/* Host stack for each task thread.  The FreeRTOS stack only holds the thread
+record, so the host stack is filled the same way the kernel fills a task stack
+and uxPortGetThreadStackHighWaterMark() measures it instead. */
+#define portHOST_THREAD_STACK_SIZE ( 256 * 1024 )
+#define portHOST_STACK_FILL_BYTE ( 0xa5U )
+
+typedef struct THREAD_STATE
+{
+	pthread_t xThread;
+	TaskFunction_t pxCode;
+	void *pvParameters;
+	uint8_t *pucStack;
+} xThreadState;
+
+/* pxTopOfStack is the first member of the TCB, and holds the thread record
+returned by pxPortInitialiseStack(). */
+extern void * volatile pxCurrentTCB;
+#define portTHREAD_OF( pxTCB ) ( *( xThreadState ** ) ( pxTCB ) )
+
+static pthread_mutex_t xCpuMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xCpuCond = PTHREAD_COND_INITIALIZER;
+
+/* Thread currently allowed to execute. */
+static xThreadState * volatile pxRunningThread = NULL;
+
+/* Interrupts are disabled until the first task starts, as on the target. */
+static volatile BaseType_t xInterruptsMasked = pdTRUE;
+static volatile BaseType_t xInInterrupt = pdFALSE;
+static volatile BaseType_t xSwitchPending = pdFALSE;
+
+/* Set while the simulator thread waits in vPortEnterInterrupt() to raise an
+interrupt, which is what the Nios II shows in ipending. */
+static volatile BaseType_t xInterruptWaiting = pdFALSE;
+
+/* Interrupts taken so far. */
+static volatile uint32_t ulInterruptCount = 0;
+
+#if configUSE_TICKLESS_IDLE == 1
+
+	/* See FreeRTOS/port.c. */
+	static uint32_t ulLastTickStamp;
+	static BaseType_t xTickPeriodAltered = pdFALSE;
+	static TicklessStats_t xTicklessStats;
+
+#endif /* configUSE_TICKLESS_IDLE */
+
+//stack overflow hook
+void vApplicationStackOverflowHook( TaskHandle_t xTask, char *pcTaskName )
+{
+	( void ) xTask;
+	printf("[free_rtos] Application stack overflow at task: %s\n", pcTaskName);
+}
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Setup the timer to generate the tick interrupts.
+ */
+static void prvSetupTimerInterrupt( void );
+
+/*
+ * Call back for the alarm function.
+ */
+void vPortSysTickHandler( void * context, alt_u32 id );
+
+/*
+ * Restart the tick timer with a first timeout ulCounts from now, then every
+ * ulCounts.
+ */
+static void prvStartTickTimer( uint32_t ulCounts );
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Hand the CPU to the thread of pxCurrentTCB and wait until it is handed
+ * back.  Called with xCpuMutex held and interrupts masked.
+ */
+static void prvSwitchThread( void )
+{
+xThreadState *pxThisThread = pxRunningThread;
+xThreadState *pxNextThread = portTHREAD_OF( pxCurrentTCB );
+
+	if( pxNextThread != pxThisThread )
+	{
+		pxRunningThread = pxNextThread;
+		pthread_cond_broadcast( &xCpuCond );
+
+		while( pxRunningThread != pxThisThread )
+		{
+			pthread_cond_wait( &xCpuCond, &xCpuMutex );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Take any context switch pended by an interrupt.  Called with xCpuMutex held
+ * and interrupts masked.
+ */
+static void prvTakePendingSwitch( void )
+{
+	while( xSwitchPending != pdFALSE )
+	{
+		xSwitchPending = pdFALSE;
+		vTaskSwitchContext();
+		prvSwitchThread();
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void *prvThreadEntry( void *pvParameters )
+{
+xThreadState *pxThread = ( xThreadState * ) pvParameters;
+
+	pthread_mutex_lock( &xCpuMutex );
+	while( pxRunningThread != pxThread )
+	{
+		pthread_cond_wait( &xCpuCond, &xCpuMutex );
+	}
+
+	/* Tasks start with interrupts enabled. */
+	prvTakePendingSwitch();
+	xInterruptsMasked = pdFALSE;
+	pthread_cond_broadcast( &xCpuCond );
+	pthread_mutex_unlock( &xCpuMutex );
+
+	pxThread->pxCode( pxThread->pvParameters );
+
+	/* Tasks must not return. */
+	fprintf( stderr, "[free_rtos] task function returned\n" );
+	abort();
+
+	return NULL;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.
+ */
+StackType_t *pxPortInitialiseStack( StackType_t *pxTopOfStack, TaskFunction_t pxCode, void *pvParameters )
+{
+xThreadState *pxThread;
+pthread_attr_t xAttr;
+
+	/* Keep the thread record at the top of the task's stack, clear of the
+	fill bytes used for the high water mark and overflow checks. */
+	pxThread = ( xThreadState * ) ( ( ( uintptr_t ) ( pxTopOfStack + 1 ) - sizeof( xThreadState ) ) & ~( uintptr_t ) portBYTE_ALIGNMENT_MASK );
+	pxThread->pxCode = pxCode;
+	pxThread->pvParameters = pvParameters;
+	pxThread->pucStack = malloc( portHOST_THREAD_STACK_SIZE );
+	if( pxThread->pucStack == NULL )
+	{
+		fprintf( stderr, "[free_rtos] could not allocate task thread stack\n" );
+		abort();
+	}
+	memset( pxThread->pucStack, portHOST_STACK_FILL_BYTE, portHOST_THREAD_STACK_SIZE );
+
+	pthread_attr_init( &xAttr );
+	pthread_attr_setstack( &xAttr, pxThread->pucStack, portHOST_THREAD_STACK_SIZE );
+	pthread_attr_setdetachstate( &xAttr, PTHREAD_CREATE_DETACHED );
+	if( pthread_create( &pxThread->xThread, &xAttr, prvThreadEntry, pxThread ) != 0 )
+	{
+		fprintf( stderr, "[free_rtos] could not create task thread\n" );
+		abort();
+	}
+	pthread_attr_destroy( &xAttr );
+
+	return ( StackType_t * ) pxThread;
+}
+/*-----------------------------------------------------------*/
+
+UBaseType_t uxPortGetThreadStackHighWaterMark( TaskHandle_t xTask )
+{
+xThreadState *pxThread = portTHREAD_OF( xTask == NULL ? pxCurrentTCB : xTask );
+const uint8_t *pucByte = pxThread->pucStack;
+
+	/* Host stacks grow down, so the bytes never written are at the bottom. */
+	while( ( pucByte < pxThread->pucStack + portHOST_THREAD_STACK_SIZE ) && ( *pucByte == portHOST_STACK_FILL_BYTE ) )
+	{
+		pucByte++;
+	}
+
+	return ( UBaseType_t ) ( ( size_t ) ( pucByte - pxThread->pucStack ) / sizeof( StackType_t ) );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * See header file for description.
+ */
+BaseType_t xPortStartScheduler( void )
+{
+	/* Start the timer that generates the tick ISR.  Interrupts are disabled
+	here already. */
+	prvSetupTimerInterrupt();
+
+	/* Start the first task.  The main thread plays no further part. */
+	pthread_mutex_lock( &xCpuMutex );
+	pxRunningThread = portTHREAD_OF( pxCurrentTCB );
+	pthread_cond_broadcast( &xCpuCond );
+	for( ;; )
+	{
+		pthread_cond_wait( &xCpuCond, &xCpuMutex );
+	}
+
+	/* Should not get here! */
+	return 0;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEndScheduler( void )
+{
+	/* A simulation run ends with LCFR_SIM_DURATION_MS, see sim_device.c. */
+}
+/*-----------------------------------------------------------*/
+
+void vPortDisableInterrupts( void )
+{
+	pthread_mutex_lock( &xCpuMutex );
+	while( xInInterrupt != pdFALSE )
+	{
+		pthread_cond_wait( &xCpuCond, &xCpuMutex );
+	}
+	xInterruptsMasked = pdTRUE;
+	pthread_mutex_unlock( &xCpuMutex );
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnableInterrupts( void )
+{
+	pthread_mutex_lock( &xCpuMutex );
+	prvTakePendingSwitch();
+	xInterruptsMasked = pdFALSE;
+	pthread_cond_broadcast( &xCpuCond );
+	pthread_mutex_unlock( &xCpuMutex );
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+BaseType_t xWasMasked;
+
+	pthread_mutex_lock( &xCpuMutex );
+	while( xInInterrupt != pdFALSE )
+	{
+		pthread_cond_wait( &xCpuCond, &xCpuMutex );
+	}
+	xWasMasked = xInterruptsMasked;
+	xInterruptsMasked = pdTRUE;
+
+	xSwitchPending = pdFALSE;
+	vTaskSwitchContext();
+	prvSwitchThread();
+
+	/* Back on the CPU, restore this task's own interrupt state. */
+	if( xWasMasked == pdFALSE )
+	{
+		prvTakePendingSwitch();
+		xInterruptsMasked = pdFALSE;
+		pthread_cond_broadcast( &xCpuCond );
+	}
+	pthread_mutex_unlock( &xCpuMutex );
+}
+/*-----------------------------------------------------------*/
+
+void vPortYieldFromISR( void )
+{
+	/* Only called between vPortEnterInterrupt() and vPortExitInterrupt(). */
+	xSwitchPending = pdTRUE;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterInterrupt( void )
+{
+	pthread_mutex_lock( &xCpuMutex );
+	xInterruptWaiting = pdTRUE;
+	pthread_cond_broadcast( &xCpuCond );
+	while( ( pxRunningThread == NULL ) || ( xInterruptsMasked != pdFALSE ) || ( xInInterrupt != pdFALSE ) )
+	{
+		pthread_cond_wait( &xCpuCond, &xCpuMutex );
+	}
+	xInterruptWaiting = pdFALSE;
+	xInInterrupt = pdTRUE;
+	pthread_mutex_unlock( &xCpuMutex );
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitInterrupt( void )
+{
+	pthread_mutex_lock( &xCpuMutex );
+	xInInterrupt = pdFALSE;
+	ulInterruptCount++;
+	pthread_cond_broadcast( &xCpuCond );
+	pthread_mutex_unlock( &xCpuMutex );
+}
+/*-----------------------------------------------------------*/
+
+void vPortPreemptionPoint( void )
+{
+xThreadState *pxThread = pxRunningThread;
+
+	/* Unlocked peek first, this is called for every register access. */
+	if( ( xSwitchPending == pdFALSE ) || ( pxThread == NULL ) || ( pthread_equal( pthread_self(), pxThread->xThread ) == 0 ) )
+	{
+		return;
+	}
+
+	pthread_mutex_lock( &xCpuMutex );
+	if( xInterruptsMasked == pdFALSE )
+	{
+		while( xInInterrupt != pdFALSE )
+		{
+			pthread_cond_wait( &xCpuCond, &xCpuMutex );
+		}
+		xInterruptsMasked = pdTRUE;
+		prvTakePendingSwitch();
+		xInterruptsMasked = pdFALSE;
+		pthread_cond_broadcast( &xCpuCond );
+	}
+	pthread_mutex_unlock( &xCpuMutex );
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * With every task blocked the idle task would spin without ever entering a
+ * critical section, so it waits here for an interrupt to pend a switch, much
+ * like a wait-for-interrupt instruction.  With tickless idle it waits for any
+ * interrupt, so the idle task gets to stop the tick after the interrupt that
+ * blocked the last task.
+ */
+void vApplicationIdleHook( void )
+{
+uint32_t ulSeen;
+
+	pthread_mutex_lock( &xCpuMutex );
+	ulSeen = ulInterruptCount;
+	while( ( xSwitchPending == pdFALSE ) && ( ( configUSE_TICKLESS_IDLE == 0 ) || ( ulInterruptCount == ulSeen ) ) )
+	{
+		pthread_cond_wait( &xCpuCond, &xCpuMutex );
+	}
+	pthread_mutex_unlock( &xCpuMutex );
+
+	portDISABLE_INTERRUPTS();
+	portENABLE_INTERRUPTS();
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Setup the systick timer to generate the tick interrupts at the required
+ * frequency.
+ */
+void prvSetupTimerInterrupt( void )
+{
+	/* Try to register the interrupt handler. */
+	if ( 0 != alt_irq_register( SYS_CLK_IRQ, 0x0, vPortSysTickHandler ) )
+	{
+		/* Failed to install the Interrupt Handler. */
+		abort();
+	}
+	else
+	{
+		/* Configure SysTick to interrupt at the requested rate. */
+		IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_STOP_MSK );
+
+		#if configUSE_TICKLESS_IDLE == 1
+		{
+			ulLastTickStamp = alt_timestamp();
+		}
+		#endif
+
+		prvStartTickTimer( portTIMER_COUNTS_PER_TICK );
+	}
+
+	/* Clear any already pending interrupts generated by the Timer. */
+	IOWR_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE, ~ALTERA_AVALON_TIMER_STATUS_TO_MSK );
+}
+/*-----------------------------------------------------------*/
+
+static void prvStartTickTimer( uint32_t ulCounts )
+{
+	/* Writing the period stops the timer and reloads its counter. */
+	IOWR_ALTERA_AVALON_TIMER_PERIODL( SYS_CLK_BASE, ( ulCounts - 1UL ) & 0xFFFF );
+	IOWR_ALTERA_AVALON_TIMER_PERIODH( SYS_CLK_BASE, ( ulCounts - 1UL ) >> 16 );
+	IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_CONT_MSK | ALTERA_AVALON_TIMER_CONTROL_START_MSK | ALTERA_AVALON_TIMER_CONTROL_ITO_MSK );
+}
+/*-----------------------------------------------------------*/
+
+#if configUSE_TICKLESS_IDLE == 0
+
+	void vPortSysTickHandler( void * context, alt_u32 id )
+	{
+		/* Increment the kernel tick. */
+		if( xTaskIncrementTick() != pdFALSE )
+		{
+			vPortYieldFromISR();
+		}
+
+		/* Clear the interrupt. */
+		IOWR_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE, ~ALTERA_AVALON_TIMER_STATUS_TO_MSK );
+	}
+
+#else /* configUSE_TICKLESS_IDLE */
+
+	/* The same as in FreeRTOS/port.c. */
+	void vPortSysTickHandler( void * context, alt_u32 id )
+	{
+		while( ( int32_t ) ( alt_timestamp() - ulLastTickStamp ) >= ( int32_t ) ( portTIMER_COUNTS_PER_TICK - portTICKLESS_MARGIN_COUNTS ) )
+		{
+			ulLastTickStamp += portTIMER_COUNTS_PER_TICK;
+			if( xTaskIncrementTick() != pdFALSE )
+			{
+				vPortYieldFromISR();
+			}
+		}
+
+		if( xTickPeriodAltered != pdFALSE )
+		{
+			xTickPeriodAltered = pdFALSE;
+			prvStartTickTimer( portTIMER_COUNTS_PER_TICK );
+		}
+
+		/* Clear the interrupt. */
+		IOWR_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE, ~ALTERA_AVALON_TIMER_STATUS_TO_MSK );
+	}
+	/*-----------------------------------------------------------*/
+
+	/*
+	 * Waits with interrupts disabled until one is waiting to be taken, as the
+	 * Nios II port polls ipending.
+	 */
+	static void prvWaitForInterrupt( void )
+	{
+		pthread_mutex_lock( &xCpuMutex );
+		while( xInterruptWaiting == pdFALSE )
+		{
+			pthread_cond_wait( &xCpuCond, &xCpuMutex );
+		}
+		pthread_mutex_unlock( &xCpuMutex );
+	}
+	/*-----------------------------------------------------------*/
+
+	/* The same as in FreeRTOS/port.c, but for the wait. */
+	void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime )
+	{
+	uint32_t ulElapsed, ulCompleteTicks;
+	TickType_t xModifiableIdleTime;
+
+		if( xExpectedIdleTime > portMAX_SUPPRESSED_TICKS )
+		{
+			xExpectedIdleTime = portMAX_SUPPRESSED_TICKS;
+		}
+
+		portDISABLE_INTERRUPTS();
+
+		ulElapsed = alt_timestamp() - ulLastTickStamp;
+		if( ( eTaskConfirmSleepModeStatus() == eAbortSleep ) || ( ulElapsed >= portTIMER_COUNTS_PER_TICK - portTICKLESS_MARGIN_COUNTS ) )
+		{
+			xTicklessStats.ulAborted++;
+			portENABLE_INTERRUPTS();
+			return;
+		}
+
+		prvStartTickTimer( xExpectedIdleTime * portTIMER_COUNTS_PER_TICK - ( alt_timestamp() - ulLastTickStamp ) );
+
+		xModifiableIdleTime = xExpectedIdleTime;
+		configPRE_SLEEP_PROCESSING( xModifiableIdleTime );
+		if( xModifiableIdleTime > 0 )
+		{
+			prvWaitForInterrupt();
+		}
+		configPOST_SLEEP_PROCESSING( xExpectedIdleTime );
+
+		IOWR_ALTERA_AVALON_TIMER_CONTROL( SYS_CLK_BASE, ALTERA_AVALON_TIMER_CONTROL_STOP_MSK );
+		IOWR_ALTERA_AVALON_TIMER_STATUS( SYS_CLK_BASE, ~ALTERA_AVALON_TIMER_STATUS_TO_MSK );
+
+		ulCompleteTicks = ( alt_timestamp() - ulLastTickStamp ) / portTIMER_COUNTS_PER_TICK;
+		if( ulCompleteTicks >= xExpectedIdleTime )
+		{
+			ulCompleteTicks = xExpectedIdleTime - 1UL;
+		}
+		vTaskStepTick( ulCompleteTicks );
+		ulLastTickStamp += ulCompleteTicks * portTIMER_COUNTS_PER_TICK;
+
+		ulElapsed = alt_timestamp() - ulLastTickStamp;
+		if( ulElapsed + portTICKLESS_MIN_COUNTS < portTIMER_COUNTS_PER_TICK )
+		{
+			prvStartTickTimer( portTIMER_COUNTS_PER_TICK - ulElapsed );
+		}
+		else
+		{
+			prvStartTickTimer( portTICKLESS_MIN_COUNTS );
+		}
+		xTickPeriodAltered = pdTRUE;
+
+		xTicklessStats.ulSleeps++;
+		xTicklessStats.ulTicksSuppressed += ulCompleteTicks;
+		if( ulCompleteTicks > xTicklessStats.ulLongestSleep )
+		{
+			xTicklessStats.ulLongestSleep = ulCompleteTicks;
+		}
+
+		portENABLE_INTERRUPTS();
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortGetTicklessStats( TicklessStats_t *pxStats )
+	{
+		*pxStats = xTicklessStats;
+	}
+
+#endif /* configUSE_TICKLESS_IDLE */
+/*-----------------------------------------------------------*/
@@ -0,0 +1,110 @@
+/*
+ * portmacro.h for the POSIX (Linux host) simulation port of the LCFR.
+ *
+ * Selected from FreeRTOS/deprecated_definitions.h when LCFR_POSIX_GCC is
+ * defined.  Every FreeRTOS task runs on its own pthread but only the thread
+ * owning pxCurrentTCB is ever allowed to execute, so the kernel still sees a
+ * single CPU.  Interrupts are raised by the simulated peripherals in
+ * sim_device.c and run on the simulator thread while the task level is not
+ * inside a critical section.  A context switch requested from an interrupt is
+ * pended and taken the next time the running task enables interrupts, yields or
+ * touches a peripheral, much as PendSV behaves on a Cortex-M.
+ */
+
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------
+ * Port specific definitions.
+ *-----------------------------------------------------------
+ */
+
+/* Type definitions. */
+#define portCHAR		char
+#define portFLOAT		float
+#define portDOUBLE		double
+#define portLONG		long
+#define portSHORT		short
+#define portSTACK_TYPE	uintptr_t
+#define portBASE_TYPE	long
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+/* Pointers are 64 bits wide on the host. */
+#define portPOINTER_SIZE_TYPE	uintptr_t
+
+#if( configUSE_16_BIT_TICKS == 1 )
+	typedef uint16_t TickType_t;
+	#define portMAX_DELAY ( TickType_t ) 0xffff
+#else
+	typedef uint32_t TickType_t;
+	#define portMAX_DELAY ( TickType_t ) 0xffffffffUL
+	#define portTICK_TYPE_IS_ATOMIC 1
+#endif
+/*-----------------------------------------------------------*/
+
+/* Architecture specifics. */
+#define portSTACK_GROWTH				( -1 )
+#define portTICK_PERIOD_MS				( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+#define portBYTE_ALIGNMENT				8
+#define portNOP()
+#define portCRITICAL_NESTING_IN_TCB		1
+/*-----------------------------------------------------------*/
+
+extern void vPortYield( void );
+extern void vPortYieldFromISR( void );
+#define portYIELD()									vPortYield()
+#define portEND_SWITCHING_ISR( xSwitchRequired ) 	if( xSwitchRequired ) 	vPortYieldFromISR()
+#define portYIELD_FROM_ISR( xSwitchRequired )		portEND_SWITCHING_ISR( xSwitchRequired )
+
+/* Tickless idle, see port.c. */
+extern void vPortSuppressTicksAndSleep( TickType_t xExpectedIdleTime );
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+/*-----------------------------------------------------------*/
+
+extern void vTaskEnterCritical( void );
+extern void vTaskExitCritical( void );
+extern void vPortDisableInterrupts( void );
+extern void vPortEnableInterrupts( void );
+
+#define portDISABLE_INTERRUPTS()	vPortDisableInterrupts()
+#define portENABLE_INTERRUPTS()		vPortEnableInterrupts()
+#define portENTER_CRITICAL()        vTaskEnterCritical()
+#define portEXIT_CRITICAL()         vTaskExitCritical()
+/*-----------------------------------------------------------*/
+
+/* Called by the simulated peripherals around every interrupt handler.  Entry
+blocks while the running task has interrupts disabled. */
+extern void vPortEnterInterrupt( void );
+extern void vPortExitInterrupt( void );
+
+/* A task thread cannot be stopped asynchronously, so a switch pended by an
+interrupt is also taken whenever the running task touches a simulated
+peripheral.  Does nothing on any other thread or inside a critical section. */
+extern void vPortPreemptionPoint( void );
+/*-----------------------------------------------------------*/
+
+/* High water mark of a task's host thread stack, in words, measured like
+uxTaskGetStackHighWaterMark() measures a task stack.  A NULL task is the
+calling task.  The FreeRTOS stack of a task only holds its thread record on the
+host, so this is the figure to size stacks by. */
+extern UBaseType_t uxPortGetThreadStackHighWaterMark( void *xTask );
+/*-----------------------------------------------------------*/
+
+/* Task function macros as described on the FreeRTOS.org WEB site. */
+#define portTASK_FUNCTION_PROTO( vFunction, pvParameters ) void vFunction( void *pvParameters )
+#define portTASK_FUNCTION( vFunction, pvParameters ) void vFunction( void *pvParameters )
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PORTMACRO_H */
@@ -0,0 +1,27 @@
+/*
+ * Whole-file input.  See read_all.h.
+ */
+
+#include "read_all.h"
+
+#include <stdlib.h>
+
+unsigned char *pucReadAll(FILE *pxFile, size_t *pxSize) {
+  size_t xCapacity = 65536, xSize = 0, xRead;
+  unsigned char *pucData = malloc(xCapacity), *pucGrown;
+
+  while (pucData != NULL &&
+         (xRead = fread(pucData + xSize, 1, xCapacity - xSize, pxFile)) > 0) {
+    xSize += xRead;
+    if (xSize == xCapacity) {
+      xCapacity *= 2;
+      pucGrown = realloc(pucData, xCapacity);
+      if (pucGrown == NULL) {
+        free(pucData);
+      }
+      pucData = pucGrown;
+    }
+  }
+  *pxSize = xSize;
+  return pucData;
+}
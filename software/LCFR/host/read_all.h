@@ -0,0 +1,16 @@
+#ifndef READ_ALL_H
+#define READ_ALL_H
+
+/*
+ * Whole-file input, shared by telemetry_decode.c, flash_log_read.c and
+ * trace_json.c.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* Reads pxFile to the end into a malloc()ed buffer and sets *pxSize to its
+length.  Returns NULL if memory runs out. */
+extern unsigned char *pucReadAll(FILE *pxFile, size_t *pxSize);
+
+#endif /* READ_ALL_H */
@@ -0,0 +1,135 @@
+/*
+ * Micro-benchmark of the frequency sample path: the lock-free ring in
+ * ../spsc_ring.c against the FreeRTOS queue it replaced.
+ *
+ * A single task plays both sides.  For each batch size it pushes a batch of
+ * 8 byte samples with the FromISR call, the way frequencyDetectorISR() does,
+ * and drains them the way frequencyAnalyserTask() does: one xQueueReceive()
+ * per item for the queue, one spscRingPopN() for the ring.  The ring side also
+ * pays for the empty to non-empty notification and for clearing it once per
+ * batch, which is all the per-item cost there is at a batch size of one.
+ *
+ * Times are host nanoseconds per item.  Kernel critical sections cost a
+ * pthread mutex here rather than a status register write, so the queue is
+ * penalised more than it would be on the Nios II; compare the shape, not the
+ * absolute numbers.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/queue.h"
+#include "FreeRTOS/task.h"
+
+#include "spsc_ring.h"
+
+#define benchCAPACITY 128
+#define benchITEMS 2000000UL
+
+typedef struct BENCH_SAMPLE {
+  uint32_t ulSamples;
+  uint32_t ulTimestamp;
+} xBenchSample;
+
+static xBenchSample xRingBuffer[benchCAPACITY];
+static xBenchSample xBatch[benchCAPACITY];
+
+#if configSUPPORT_STATIC_ALLOCATION == 1
+/* Kernel objects for LCFR_STATIC_ALLOCATION, see bench_static.c. */
+static StaticQueue_t xQueueBuffer;
+static uint8_t ucQueueStorage[benchCAPACITY * sizeof(xBenchSample)];
+static StaticTask_t xBenchTaskBuffer;
+static StackType_t xBenchTaskStack[configMINIMAL_STACK_SIZE];
+#endif
+
+static double prvNowNs(void) {
+  struct timespec xNow;
+
+  clock_gettime(CLOCK_MONOTONIC, &xNow);
+  return (double)xNow.tv_sec * 1e9 + (double)xNow.tv_nsec;
+}
+
+static double prvBenchQueue(QueueHandle_t xQueue, uint32_t ulBatch) {
+  xBenchSample xSample = {320, 0};
+  unsigned long ulDone;
+  uint32_t i;
+  double dStart = prvNowNs();
+
+  for (ulDone = 0; ulDone < benchITEMS; ulDone += ulBatch) {
+    for (i = 0; i < ulBatch; i++) {
+      xSample.ulTimestamp = i;
+      xQueueSendToBackFromISR(xQueue, &xSample, NULL);
+    }
+    for (i = 0; i < ulBatch; i++) {
+      xQueueReceive(xQueue, &xBatch[i], 0);
+    }
+  }
+
+  return (prvNowNs() - dStart) / (double)ulDone;
+}
+
+static double prvBenchRing(SpscRing *pxRing, uint32_t ulBatch) {
+  xBenchSample xSample = {320, 0};
+  BaseType_t xWoken = pdFALSE;
+  unsigned long ulDone;
+  uint32_t i;
+  double dStart = prvNowNs();
+
+  for (ulDone = 0; ulDone < benchITEMS; ulDone += ulBatch) {
+    for (i = 0; i < ulBatch; i++) {
+      xSample.ulTimestamp = i;
+      spscRingPushFromISR(pxRing, &xSample, &xWoken);
+    }
+    while (spscRingPopN(pxRing, xBatch, benchCAPACITY) != 0) {
+    }
+    ulTaskNotifyTake(pdTRUE, 0);
+  }
+
+  return (prvNowNs() - dStart) / (double)ulDone;
+}
+
+static void prvBenchTask(void *pvParameters) {
+  static const uint32_t ulBatches[] = {1, 4, 16, 64, benchCAPACITY};
+#if configSUPPORT_STATIC_ALLOCATION == 1
+  QueueHandle_t xQueue = xQueueCreateStatic(
+      benchCAPACITY, sizeof(xBenchSample), ucQueueStorage, &xQueueBuffer);
+#else
+  QueueHandle_t xQueue = xQueueCreate(benchCAPACITY, sizeof(xBenchSample));
+#endif
+  SpscRing xRing;
+  unsigned int i;
+
+  (void)pvParameters;
+
+  spscRingInit(&xRing, xRingBuffer, benchCAPACITY, sizeof(xBenchSample));
+  spscRingSetConsumer(&xRing, xTaskGetCurrentTaskHandle());
+
+  printf("%lu samples of %u bytes, ns per sample\n", benchITEMS,
+         (unsigned int)sizeof(xBenchSample));
+  printf("%8s %14s %14s %8s\n", "batch", "freertos queue", "spsc ring",
+         "speedup");
+  for (i = 0; i < sizeof(ulBatches) / sizeof(ulBatches[0]); i++) {
+    double dQueue = prvBenchQueue(xQueue, ulBatches[i]);
+    double dRing = prvBenchRing(&xRing, ulBatches[i]);
+
+    printf("%8lu %14.1f %14.1f %7.1fx\n", (unsigned long)ulBatches[i], dQueue,
+           dRing, dQueue / dRing);
+  }
+
+  exit(EXIT_SUCCESS);
+}
+
+int main(void) {
+#if configSUPPORT_STATIC_ALLOCATION == 1
+  xTaskCreateStatic(prvBenchTask, "Bench", configMINIMAL_STACK_SIZE, NULL,
+                    tskIDLE_PRIORITY + 1, xBenchTaskStack, &xBenchTaskBuffer);
+#else
+  xTaskCreate(prvBenchTask, "Bench", configMINIMAL_STACK_SIZE, NULL,
+              tskIDLE_PRIORITY + 1, NULL);
+#endif
+  vTaskStartScheduler();
+
+  return EXIT_FAILURE;
+}
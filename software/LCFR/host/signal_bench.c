@@ -0,0 +1,196 @@
+/*
+ * Micro-benchmark of waking a task: a binary semaphore per reason against
+ * the task notification bits ../task_events.c posts.
+ *
+ * The first table has a single task play both sides, so no context switch is
+ * timed.  For each number of reasons it signals that many, with the task call
+ * and with the FromISR call, and then collects them: one xSemaphoreTake() per
+ * semaphore, or one xTaskNotifyWait() for all the bits.  The second table
+ * wakes a higher priority task blocked on each, which adds the two context
+ * switches of every round trip.
+ *
+ * Times are host nanoseconds per wakeup.  Kernel critical sections cost a
+ * pthread mutex here rather than a status register write, and a context
+ * switch costs two pthread handovers; compare the shape, not the absolute
+ * numbers.  The relay's own report gives the target cost of a post in CPU
+ * cycles.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/semphr.h"
+#include "FreeRTOS/task.h"
+
+#define benchMAX_REASONS 4
+#define benchWAKEUPS 1000000UL
+#define benchROUND_TRIPS 100000UL
+
+#if configSUPPORT_STATIC_ALLOCATION == 1
+/* Kernel objects for LCFR_STATIC_ALLOCATION, see bench_static.c. */
+static StaticSemaphore_t xSemaphoreBuffers[benchMAX_REASONS];
+static StaticTask_t xBenchTaskBuffer;
+static StackType_t xBenchTaskStack[configMINIMAL_STACK_SIZE];
+static StaticTask_t xWaiterTaskBuffer;
+static StackType_t xWaiterTaskStack[configMINIMAL_STACK_SIZE];
+#endif
+
+static SemaphoreHandle_t xSemaphores[benchMAX_REASONS];
+
+/* What the waiter task blocks on for the round trips. */
+static volatile BaseType_t xWaitOnNotify;
+
+static double prvNowNs(void) {
+  struct timespec xNow;
+
+  clock_gettime(CLOCK_MONOTONIC, &xNow);
+  return (double)xNow.tv_sec * 1e9 + (double)xNow.tv_nsec;
+}
+
+static double prvBenchSemaphores(uint32_t ulReasons, BaseType_t xFromISR) {
+  BaseType_t xWoken = pdFALSE;
+  unsigned long ulDone;
+  uint32_t i;
+  double dStart = prvNowNs();
+
+  for (ulDone = 0; ulDone < benchWAKEUPS; ulDone++) {
+    for (i = 0; i < ulReasons; i++) {
+      if (xFromISR) {
+        xSemaphoreGiveFromISR(xSemaphores[i], &xWoken);
+      } else {
+        xSemaphoreGive(xSemaphores[i]);
+      }
+    }
+    for (i = 0; i < ulReasons; i++) {
+      xSemaphoreTake(xSemaphores[i], 0);
+    }
+  }
+
+  return (prvNowNs() - dStart) / (double)ulDone;
+}
+
+static double prvBenchNotify(uint32_t ulReasons, BaseType_t xFromISR) {
+  TaskHandle_t xSelf = xTaskGetCurrentTaskHandle();
+  BaseType_t xWoken = pdFALSE;
+  uint32_t ulEvents;
+  unsigned long ulDone;
+  uint32_t i;
+  double dStart = prvNowNs();
+
+  for (ulDone = 0; ulDone < benchWAKEUPS; ulDone++) {
+    for (i = 0; i < ulReasons; i++) {
+      if (xFromISR) {
+        xTaskNotifyFromISR(xSelf, 1UL << i, eSetBits, &xWoken);
+      } else {
+        xTaskNotify(xSelf, 1UL << i, eSetBits);
+      }
+    }
+    xTaskNotifyWait(0, UINT32_MAX, &ulEvents, 0);
+  }
+
+  return (prvNowNs() - dStart) / (double)ulDone;
+}
+
+static void prvWaiterTask(void *pvParameters) {
+  uint32_t ulEvents;
+
+  (void)pvParameters;
+
+  for (;;) {
+    if (xWaitOnNotify) {
+      xTaskNotifyWait(0, UINT32_MAX, &ulEvents, portMAX_DELAY);
+    } else {
+      xSemaphoreTake(xSemaphores[0], portMAX_DELAY);
+    }
+  }
+}
+
+static double prvBenchRoundTrip(TaskHandle_t xWaiter, BaseType_t xNotify) {
+  unsigned long ulDone;
+  double dStart;
+
+  /* Let the waiter block on the new object before timing. */
+  xWaitOnNotify = xNotify;
+  xSemaphoreGive(xSemaphores[0]);
+  xTaskNotify(xWaiter, 1, eSetBits);
+
+  dStart = prvNowNs();
+  for (ulDone = 0; ulDone < benchROUND_TRIPS; ulDone++) {
+    if (xNotify) {
+      xTaskNotify(xWaiter, 1, eSetBits);
+    } else {
+      xSemaphoreGive(xSemaphores[0]);
+    }
+  }
+
+  return (prvNowNs() - dStart) / (double)ulDone;
+}
+
+static void prvBenchTask(void *pvParameters) {
+  TaskHandle_t xWaiter;
+  uint32_t ulReasons;
+  unsigned int i;
+
+  (void)pvParameters;
+
+  for (i = 0; i < benchMAX_REASONS; i++) {
+#if configSUPPORT_STATIC_ALLOCATION == 1
+    xSemaphores[i] = xSemaphoreCreateBinaryStatic(&xSemaphoreBuffers[i]);
+#else
+    xSemaphores[i] = xSemaphoreCreateBinary();
+#endif
+  }
+
+  printf("%lu wakeups without a context switch, ns per wakeup\n",
+         benchWAKEUPS);
+  printf("%8s %6s %10s %10s %8s\n", "reasons", "from", "semaphores",
+         "notify", "speedup");
+  for (ulReasons = 1; ulReasons <= benchMAX_REASONS; ulReasons *= 2) {
+    for (i = 0; i < 2; i++) {
+      double dSemaphores = prvBenchSemaphores(ulReasons, i);
+      double dNotify = prvBenchNotify(ulReasons, i);
+
+      printf("%8lu %6s %10.1f %10.1f %7.1fx\n", (unsigned long)ulReasons,
+             i ? "isr" : "task", dSemaphores, dNotify,
+             dSemaphores / dNotify);
+    }
+  }
+
+#if configSUPPORT_STATIC_ALLOCATION == 1
+  xWaiter = xTaskCreateStatic(prvWaiterTask, "Waiter",
+                              configMINIMAL_STACK_SIZE, NULL,
+                              tskIDLE_PRIORITY + 2, xWaiterTaskStack,
+                              &xWaiterTaskBuffer);
+#else
+  xTaskCreate(prvWaiterTask, "Waiter", configMINIMAL_STACK_SIZE, NULL,
+              tskIDLE_PRIORITY + 2, &xWaiter);
+#endif
+
+  {
+    double dSemaphore = prvBenchRoundTrip(xWaiter, pdFALSE);
+    double dNotify = prvBenchRoundTrip(xWaiter, pdTRUE);
+
+    printf("\n%lu wakeups of a blocked higher priority task, ns per wakeup\n",
+           benchROUND_TRIPS);
+    printf("%10s %10s %8s\n", "semaphore", "notify", "speedup");
+    printf("%10.1f %10.1f %7.1fx\n", dSemaphore, dNotify,
+           dSemaphore / dNotify);
+  }
+
+  exit(EXIT_SUCCESS);
+}
+
+int main(void) {
+#if configSUPPORT_STATIC_ALLOCATION == 1
+  xTaskCreateStatic(prvBenchTask, "Bench", configMINIMAL_STACK_SIZE, NULL,
+                    tskIDLE_PRIORITY + 1, xBenchTaskStack, &xBenchTaskBuffer);
+#else
+  xTaskCreate(prvBenchTask, "Bench", configMINIMAL_STACK_SIZE, NULL,
+              tskIDLE_PRIORITY + 1, NULL);
+#endif
+  vTaskStartScheduler();
+
+  return EXIT_FAILURE;
+}
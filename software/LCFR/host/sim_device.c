@@ -0,0 +1,745 @@
+/*
+ * Simulated DE2-115 peripherals for the host build of the LCFR.
+ *
+ * Provides the memory-backed register file behind IORD/IOWR, the legacy
+ * alt_irq_register() interrupt table and a single simulator thread that raises
+ * interrupts in simulated time:
+ *
+ *  - TIMER1MS, TIMER1US, LOAD_TIMER: Altera Avalon interval timers (STATUS,
+ *    CONTROL, PERIODL/H and SNAPL/H).  TIMER1MS drives the FreeRTOS tick in
+ *    port.c.  LOAD_TIMER is not in the board's system, see sim_device.h.
+ *  - FREQUENCY_ANALYSER: register 0 holds the number of 16 kHz samples in the
+ *    last mains cycle, and FREQUENCY_ANALYSER_IRQ is raised at a configurable
+ *    rate.
+ *  - RED_LEDS, GREEN_LEDS, SLIDE_SWITCH, PUSH_BUTTON: plain PIO registers.
+ *  - JTAG_UART: the write side only.  Characters written to DATA go to the
+ *    host's stdout and fill a JTAG_UART_WRITE_DEPTH FIFO that a terminal
+ *    empties at simJTAG_UART_BYTES_PER_S.  With WE set in CONTROL,
+ *    JTAG_UART_IRQ is raised while no more than JTAG_UART_WRITE_THRESHOLD
+ *    characters are left in it.
+ *  - FLASH_CONTROLLER: behind the HAL flash API rather than registers, see
+ *    altera_avalon_cfi_flash.c.
+ *
+ * Interrupts are only delivered while the running task has interrupts
+ * enabled, see vPortEnterInterrupt() in port.c.
+ *
+ * A run is configured from the environment:
+ *
+ *   LCFR_SIM_SPEEDUP      simulated seconds per host second (default 1)
+ *   LCFR_SIM_DURATION_MS  simulated run time, 0 runs forever (default 0)
+ *   LCFR_SIM_FREQ_HZ      mains frequency seen by the analyser (default 50)
+ *   LCFR_SIM_IRQ_RATE_HZ  analyser interrupts per simulated second, 0 raises
+ *                         one per mains cycle (default 0)
+ *   LCFR_SIM_SWITCHES     initial slide switch value (default 0x1f)
+ *   LCFR_SIM_TRACE        replay a recorded trace instead, see below
+ *   LCFR_SIM_TRACE_SPEED  trace replay speed: 1, 10, 100... or "max" to raise
+ *                         each sample as soon as the last handler returns
+ *                         (default 1)
+ *   LCFR_SIM_FEEDBACK_HZ  Hz each shed load gives back to the mains, 0 leaves
+ *                         the frequency alone (default 0)
+ *   LCFR_SIM_FLASH        image file that keeps the flash between runs
+ *
+ * A trace is a text file of frequency analyser sample counts, one per line,
+ * in the order they were recorded; blank lines and lines starting with '#'
+ * are skipped.  Each count is both the value register 0 returns and the length
+ * of that mains cycle, so at speed 1 the samples arrive when they did in the
+ * field.  The run ends shortly after the last sample unless
+ * LCFR_SIM_DURATION_MS ends it first.
+ *
+ * With feedback, every load switched on at the slide switches whose green LED
+ * is lit counts as shed, and the frequency the analyser sees rises by
+ * LCFR_SIM_FEEDBACK_HZ per shed load.  The rise follows a first order lag, so
+ * shedding sooner recovers sooner.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "altera_avalon_jtag_uart_regs.h"
+#include "altera_avalon_pio_regs.h"
+#include "altera_avalon_timer.h"
+#include "altera_avalon_timer_regs.h"
+#include "sys/alt_irq.h"
+#include "system.h"
+
+#include "FreeRTOS/FreeRTOS.h"
+
+#include "sim_device.h"
+
+#if configUSE_TRACE_RECORDER == 1
+#include "trace_recorder.h"
+#endif
+
+#define simNS_PER_SECOND 1000000000ULL
+#define simSAMPLING_FREQUENCY 16000.0
+#define simTIMER_SPAN 0x20
+#define simPIO_SPAN 0x18
+#define simPIO_REGISTERS (simPIO_SPAN / 4)
+#define simTRACE_DRAIN_NS (100ULL * 1000000ULL)
+#define simNEVER (~(alt_u64)0)
+#define simFEEDBACK_TAU_S 0.5
+#define simJTAG_UART_SPAN 0x8
+#define simJTAG_UART_BYTES_PER_S 32768.0
+
+typedef struct SIM_TIMER {
+  alt_u32 ulBase;
+  alt_u32 ulIrq;
+  alt_u64 ullFrequency;
+  alt_u32 ulControl;
+  alt_u32 ulStatus;
+  alt_u32 ulPeriod;
+  alt_u32 ulSnapshot;
+  int xRunning;
+  alt_u64 ullExpiryNs;
+} xSimTimer;
+
+typedef struct SIM_PIO {
+  alt_u32 ulBase;
+  alt_u32 ulRegister[simPIO_REGISTERS];
+} xSimPio;
+
+typedef struct SIM_JTAG_UART {
+  alt_u32 ulControl; // RE and WE
+  double dFill;      // characters in the write FIFO as of ullFillNs
+  alt_u64 ullFillNs;
+  alt_u64 ullBytes;
+} xSimJtagUart;
+
+typedef struct SIM_IRQ {
+  alt_isr_func pxHandler;
+  void *pvContext;
+  alt_u64 ullCount;
+} xSimIrq;
+
+static xSimTimer xTimers[] = {
+    {TIMER1MS_BASE, TIMER1MS_IRQ, TIMER1MS_FREQ},
+    {TIMER1US_BASE, TIMER1US_IRQ, TIMER1US_FREQ},
+    {LOAD_TIMER_BASE, LOAD_TIMER_IRQ, LOAD_TIMER_FREQ},
+};
+#define simNUM_TIMERS (sizeof(xTimers) / sizeof(xTimers[0]))
+
+static xSimPio xPios[] = {
+    {RED_LEDS_BASE},
+    {GREEN_LEDS_BASE},
+    {SLIDE_SWITCH_BASE},
+    {PUSH_BUTTON_BASE},
+};
+#define simNUM_PIOS (sizeof(xPios) / sizeof(xPios[0]))
+
+static xSimJtagUart xJtagUart;
+
+static xSimIrq xIrqs[ALT_NIRQ];
+
+static pthread_mutex_t xSimMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xSimCond;
+
+static struct timespec xHostStart;
+static double dSpeedup = 1.0;
+static alt_u64 ullDurationNs = 0;
+static double dMainsFrequency = 50.0;
+static double dIrqRate = 0.0;
+
+static alt_u32 ulSampleCount = 0;
+static alt_u64 ullNextSampleNs = 0;
+static alt_u64 ullLedWrites = 0;
+
+static alt_u32 *pulTrace = NULL;
+static size_t xTraceLength = 0;
+static size_t xTraceNext = 0;
+static double dTraceSpeed = 1.0; // 0 replays as fast as possible
+static alt_u64 ullTraceStartNs = 0;
+static alt_u64 ullTraceEndNs = 0;
+
+static double dFeedbackHz = 0.0;
+static double dFeedbackOffset = 0.0; // Hz the shed loads give back so far
+
+/*-----------------------------------------------------------*/
+
+static alt_u64 prvHostNs(const struct timespec *pxTime) {
+  return (alt_u64)pxTime->tv_sec * simNS_PER_SECOND + (alt_u64)pxTime->tv_nsec;
+}
+
+alt_u64 ullSimTimeNs(void) {
+  struct timespec xNow;
+
+  clock_gettime(CLOCK_MONOTONIC, &xNow);
+  return (alt_u64)((double)(prvHostNs(&xNow) - prvHostNs(&xHostStart)) *
+                   dSpeedup);
+}
+
+static void prvHostDeadline(alt_u64 ullSimNs, struct timespec *pxDeadline) {
+  alt_u64 ullHostNs =
+      prvHostNs(&xHostStart) + (alt_u64)((double)ullSimNs / dSpeedup);
+
+  pxDeadline->tv_sec = (time_t)(ullHostNs / simNS_PER_SECOND);
+  pxDeadline->tv_nsec = (long)(ullHostNs % simNS_PER_SECOND);
+}
+
+static alt_u64 prvCyclesToNs(alt_u64 ullCycles, alt_u64 ullFrequency) {
+  return ullCycles * simNS_PER_SECOND / ullFrequency;
+}
+
+/*-----------------------------------------------------------*/
+
+static xSimTimer *prvFindTimer(alt_u32 ulAddress) {
+  unsigned int i;
+
+  for (i = 0; i < simNUM_TIMERS; i++) {
+    if (ulAddress >= xTimers[i].ulBase &&
+        ulAddress < xTimers[i].ulBase + simTIMER_SPAN) {
+      return &xTimers[i];
+    }
+  }
+  return NULL;
+}
+
+static xSimPio *prvFindPio(alt_u32 ulAddress) {
+  unsigned int i;
+
+  for (i = 0; i < simNUM_PIOS; i++) {
+    if (ulAddress >= xPios[i].ulBase &&
+        ulAddress < xPios[i].ulBase + simPIO_SPAN) {
+      return &xPios[i];
+    }
+  }
+  return NULL;
+}
+
+/* Counter value the hardware would latch into SNAPL/SNAPH right now. */
+static alt_u32 prvTimerCounter(xSimTimer *pxTimer, alt_u64 ullNow) {
+  alt_u64 ullRemaining;
+
+  if (!pxTimer->xRunning || pxTimer->ullExpiryNs <= ullNow) {
+    return pxTimer->ulPeriod;
+  }
+  ullRemaining = (pxTimer->ullExpiryNs - ullNow) * pxTimer->ullFrequency /
+                 simNS_PER_SECOND;
+  return ullRemaining > pxTimer->ulPeriod ? pxTimer->ulPeriod
+                                          : (alt_u32)ullRemaining;
+}
+
+static alt_u32 prvTimerRead(xSimTimer *pxTimer, int xRegister) {
+  switch (xRegister) {
+  case ALTERA_AVALON_TIMER_STATUS_REG:
+    return pxTimer->ulStatus |
+           (pxTimer->xRunning ? ALTERA_AVALON_TIMER_STATUS_RUN_MSK : 0);
+  case ALTERA_AVALON_TIMER_CONTROL_REG:
+    return pxTimer->ulControl;
+  case ALTERA_AVALON_TIMER_PERIODL_REG:
+    return pxTimer->ulPeriod & 0xFFFF;
+  case ALTERA_AVALON_TIMER_PERIODH_REG:
+    return pxTimer->ulPeriod >> 16;
+  case ALTERA_AVALON_TIMER_SNAPL_REG:
+    return pxTimer->ulSnapshot & 0xFFFF;
+  case ALTERA_AVALON_TIMER_SNAPH_REG:
+    return pxTimer->ulSnapshot >> 16;
+  default:
+    return 0;
+  }
+}
+
+static void prvTimerWrite(xSimTimer *pxTimer, int xRegister, alt_u32 ulData) {
+  alt_u64 ullNow = ullSimTimeNs();
+
+  switch (xRegister) {
+  case ALTERA_AVALON_TIMER_STATUS_REG:
+    /* Any write clears the timeout bit. */
+    pxTimer->ulStatus &= ~ALTERA_AVALON_TIMER_STATUS_TO_MSK;
+    break;
+  case ALTERA_AVALON_TIMER_CONTROL_REG:
+    pxTimer->ulControl = ulData & (ALTERA_AVALON_TIMER_CONTROL_ITO_MSK |
+                                   ALTERA_AVALON_TIMER_CONTROL_CONT_MSK);
+    if (ulData & ALTERA_AVALON_TIMER_CONTROL_STOP_MSK) {
+      pxTimer->xRunning = 0;
+    } else if (ulData & ALTERA_AVALON_TIMER_CONTROL_START_MSK) {
+      pxTimer->xRunning = 1;
+      pxTimer->ullExpiryNs =
+          ullNow + prvCyclesToNs((alt_u64)pxTimer->ulPeriod + 1,
+                                 pxTimer->ullFrequency);
+    }
+    break;
+  case ALTERA_AVALON_TIMER_PERIODL_REG:
+    /* Writing either half of the period stops the counter. */
+    pxTimer->ulPeriod = (pxTimer->ulPeriod & 0xFFFF0000) | (ulData & 0xFFFF);
+    pxTimer->xRunning = 0;
+    break;
+  case ALTERA_AVALON_TIMER_PERIODH_REG:
+    pxTimer->ulPeriod = (pxTimer->ulPeriod & 0xFFFF) | ((ulData & 0xFFFF) << 16);
+    pxTimer->xRunning = 0;
+    break;
+  case ALTERA_AVALON_TIMER_SNAPL_REG:
+  case ALTERA_AVALON_TIMER_SNAPH_REG:
+    pxTimer->ulSnapshot = prvTimerCounter(pxTimer, ullNow);
+    break;
+  default:
+    break;
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Characters still in the write FIFO, after the terminal has taken what it
+could since the last look. */
+static alt_u32 prvJtagUartFill(alt_u64 ullNow) {
+  xJtagUart.dFill -= (double)(ullNow - xJtagUart.ullFillNs) *
+                     simJTAG_UART_BYTES_PER_S / simNS_PER_SECOND;
+  if (xJtagUart.dFill < 0.0) {
+    xJtagUart.dFill = 0.0;
+  }
+  xJtagUart.ullFillNs = ullNow;
+  return (alt_u32)ceil(xJtagUart.dFill);
+}
+
+/* When the write interrupt is next due, simNEVER if it is disabled. */
+static alt_u64 prvJtagUartIrqNs(alt_u64 ullNow) {
+  alt_u32 ulFill;
+
+  if (!(xJtagUart.ulControl & ALTERA_AVALON_JTAG_UART_CONTROL_WE_MSK) ||
+      xIrqs[JTAG_UART_IRQ].pxHandler == NULL) {
+    return simNEVER;
+  }
+  ulFill = prvJtagUartFill(ullNow);
+  if (ulFill <= JTAG_UART_WRITE_THRESHOLD) {
+    return ullNow;
+  }
+  return ullNow + (alt_u64)((ulFill - JTAG_UART_WRITE_THRESHOLD) *
+                            simNS_PER_SECOND / simJTAG_UART_BYTES_PER_S);
+}
+
+static alt_u32 prvJtagUartRead(int xRegister) {
+  alt_u32 ulFill, ulControl;
+
+  if (xRegister != ALTERA_AVALON_JTAG_UART_CONTROL_REG) {
+    /* Nothing is ever typed, so RVALID stays clear. */
+    return 0;
+  }
+  ulFill = prvJtagUartFill(ullSimTimeNs());
+  ulControl = xJtagUart.ulControl |
+              ((JTAG_UART_WRITE_DEPTH - ulFill)
+               << ALTERA_AVALON_JTAG_UART_CONTROL_WSPACE_OFST);
+  if ((xJtagUart.ulControl & ALTERA_AVALON_JTAG_UART_CONTROL_WE_MSK) &&
+      ulFill <= JTAG_UART_WRITE_THRESHOLD) {
+    ulControl |= ALTERA_AVALON_JTAG_UART_CONTROL_WI_MSK;
+  }
+  return ulControl;
+}
+
+static void prvJtagUartWrite(int xRegister, alt_u32 ulData) {
+  if (xRegister == ALTERA_AVALON_JTAG_UART_CONTROL_REG) {
+    xJtagUart.ulControl = ulData & (ALTERA_AVALON_JTAG_UART_CONTROL_RE_MSK |
+                                    ALTERA_AVALON_JTAG_UART_CONTROL_WE_MSK);
+    return;
+  }
+  /* A character written to a full FIFO is lost, as on the hardware. */
+  if (prvJtagUartFill(ullSimTimeNs()) < JTAG_UART_WRITE_DEPTH) {
+    xJtagUart.dFill += 1.0;
+    xJtagUart.ullBytes++;
+    putchar((int)(ulData & ALTERA_AVALON_JTAG_UART_DATA_DATA_MSK));
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+alt_u32 ulSimRead(alt_u32 ulAddress, int xWidth) {
+  xSimTimer *pxTimer;
+  xSimPio *pxPio;
+  alt_u32 ulData = 0;
+
+  (void)xWidth;
+
+  vPortPreemptionPoint();
+  pthread_mutex_lock(&xSimMutex);
+  if ((pxTimer = prvFindTimer(ulAddress)) != NULL) {
+    ulData = prvTimerRead(pxTimer, (ulAddress - pxTimer->ulBase) / 4);
+  } else if ((pxPio = prvFindPio(ulAddress)) != NULL) {
+    ulData = pxPio->ulRegister[(ulAddress - pxPio->ulBase) / 4];
+  } else if (ulAddress == FREQUENCY_ANALYSER_BASE) {
+    ulData = ulSampleCount;
+  } else if (ulAddress >= JTAG_UART_BASE &&
+             ulAddress < JTAG_UART_BASE + simJTAG_UART_SPAN) {
+    ulData = prvJtagUartRead((ulAddress - JTAG_UART_BASE) / 4);
+  }
+  pthread_mutex_unlock(&xSimMutex);
+
+  return ulData;
+}
+
+void vSimWrite(alt_u32 ulAddress, alt_u32 ulData, int xWidth) {
+  xSimTimer *pxTimer;
+  xSimPio *pxPio;
+  int xRegister;
+
+  (void)xWidth;
+
+  vPortPreemptionPoint();
+  pthread_mutex_lock(&xSimMutex);
+  if ((pxTimer = prvFindTimer(ulAddress)) != NULL) {
+    prvTimerWrite(pxTimer, (ulAddress - pxTimer->ulBase) / 4, ulData);
+    pthread_cond_broadcast(&xSimCond);
+  } else if ((pxPio = prvFindPio(ulAddress)) != NULL) {
+    xRegister = (ulAddress - pxPio->ulBase) / 4;
+    if (xRegister == 3) {
+      /* Writing the edge capture register clears it. */
+      pxPio->ulRegister[3] = 0;
+    } else {
+      pxPio->ulRegister[xRegister] = ulData;
+    }
+    if (xRegister == 0 && (pxPio->ulBase == RED_LEDS_BASE ||
+                           pxPio->ulBase == GREEN_LEDS_BASE)) {
+      ullLedWrites++;
+    }
+  } else if (ulAddress >= JTAG_UART_BASE &&
+             ulAddress < JTAG_UART_BASE + simJTAG_UART_SPAN) {
+    prvJtagUartWrite((ulAddress - JTAG_UART_BASE) / 4, ulData);
+    pthread_cond_broadcast(&xSimCond);
+  }
+  pthread_mutex_unlock(&xSimMutex);
+}
+
+/*-----------------------------------------------------------*/
+
+int alt_irq_register(alt_u32 id, void *context, alt_isr_func handler) {
+  if (id >= ALT_NIRQ) {
+    return -1;
+  }
+
+#if configUSE_TRACE_RECORDER == 1
+  // as on the board, see alt_irq_register() in ../FreeRTOS/port.c
+  handler = traceRecorderWrapIsr(id, context, handler);
+  context = NULL;
+#endif
+
+  pthread_mutex_lock(&xSimMutex);
+  xIrqs[id].pxHandler = handler;
+  xIrqs[id].pvContext = context;
+  pthread_mutex_unlock(&xSimMutex);
+
+  return 0;
+}
+
+/* Runs the registered handler in interrupt context.  Called without
+xSimMutex held so the handler can access the registers. */
+static void prvRaiseIrq(alt_u32 ulIrq) {
+  alt_isr_func pxHandler;
+  void *pvContext;
+
+  pthread_mutex_lock(&xSimMutex);
+  pxHandler = xIrqs[ulIrq].pxHandler;
+  pvContext = xIrqs[ulIrq].pvContext;
+  xIrqs[ulIrq].ullCount++;
+  pthread_mutex_unlock(&xSimMutex);
+
+  if (pxHandler != NULL) {
+    vPortEnterInterrupt();
+    pxHandler(pvContext, ulIrq);
+    vPortExitInterrupt();
+  }
+}
+
+/*-----------------------------------------------------------*/
+
+alt_u64 ullSimTraceNs(void) {
+  if (xTraceNext == 0) {
+    return 0;
+  }
+  /* A run cut short ends the replay early. */
+  return (ullTraceEndNs != 0 ? ullTraceEndNs : ullSimTimeNs()) -
+         ullTraceStartNs;
+}
+
+/* Loads the sample counts of a trace file into pulTrace. */
+static int prvLoadTrace(const char *pcPath) {
+  FILE *pxFile = fopen(pcPath, "r");
+  char cLine[64];
+  size_t xCapacity = 0;
+  unsigned long ulCount;
+
+  if (pxFile == NULL) {
+    return -1;
+  }
+
+  while (fgets(cLine, sizeof(cLine), pxFile) != NULL) {
+    if (sscanf(cLine, " %lu", &ulCount) != 1 || cLine[0] == '#' ||
+        ulCount == 0) {
+      continue;
+    }
+    if (xTraceLength == xCapacity) {
+      xCapacity = xCapacity != 0 ? xCapacity * 2 : 1024;
+      pulTrace = realloc(pulTrace, xCapacity * sizeof(*pulTrace));
+      if (pulTrace == NULL) {
+        fclose(pxFile);
+        return -1;
+      }
+    }
+    pulTrace[xTraceLength++] = (alt_u32)ulCount;
+  }
+
+  fclose(pxFile);
+  return xTraceLength != 0 ? 0 : -1;
+}
+
+/* The sample count the analyser sees for a mains cycle of ulCount samples,
+once the loads shed so far have pulled the frequency back up.  Called once per
+cycle with xSimMutex held. */
+static alt_u32 prvFeedbackCount(alt_u32 ulCount) {
+  alt_u32 ulShed = prvFindPio(GREEN_LEDS_BASE)->ulRegister[0] &
+                   prvFindPio(SLIDE_SWITCH_BASE)->ulRegister[0];
+  double dCycleS = (double)ulCount / simSAMPLING_FREQUENCY;
+
+  if (dFeedbackHz == 0.0) {
+    return ulCount;
+  }
+  dFeedbackOffset += (dFeedbackHz * __builtin_popcount(ulShed) -
+                      dFeedbackOffset) *
+                     (1.0 - exp(-dCycleS / simFEEDBACK_TAU_S));
+  return (alt_u32)(simSAMPLING_FREQUENCY /
+                       (1.0 / dCycleS + dFeedbackOffset) +
+                   0.5);
+}
+
+/* Latches the next sample into the analyser register and schedules the one
+after it.  Returns 0 if no interrupt should be raised.  Called with xSimMutex
+held. */
+static int prvNextSample(alt_u64 ullNow) {
+  alt_u32 ulCount;
+
+  if (pulTrace == NULL) {
+    ulSampleCount = prvFeedbackCount(
+        (alt_u32)(simSAMPLING_FREQUENCY / dMainsFrequency + 0.5));
+    ullNextSampleNs +=
+        (alt_u64)((double)simNS_PER_SECOND /
+                  (dIrqRate > 0.0 ? dIrqRate : dMainsFrequency));
+    return 1;
+  }
+
+  if (xTraceNext == 0) {
+    if (xIrqs[FREQUENCY_ANALYSER_IRQ].pxHandler == NULL) {
+      /* Hold the trace until the relay is listening. */
+      ullNextSampleNs = ullNow + simNS_PER_SECOND / 1000;
+      return 0;
+    }
+    ullTraceStartNs = ullNow;
+  }
+  ulSampleCount = prvFeedbackCount(pulTrace[xTraceNext++]);
+
+  if (xTraceNext == xTraceLength) {
+    /* Leave the relay time to drain the queue before reporting. */
+    ullTraceEndNs = ullNow;
+    ullNextSampleNs = simNEVER;
+    if (ullDurationNs == 0 || ullDurationNs > ullNow + simTRACE_DRAIN_NS) {
+      ullDurationNs = ullNow + simTRACE_DRAIN_NS;
+    }
+  } else if (dTraceSpeed == 0.0) {
+    ullNextSampleNs = ullNow;
+  } else {
+    ulCount = pulTrace[xTraceNext];
+    ullNextSampleNs += (alt_u64)((double)ulCount * simNS_PER_SECOND /
+                                 simSAMPLING_FREQUENCY / dTraceSpeed);
+  }
+  return 1;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvReport(void) {
+  struct timespec xNow;
+  double dHostMs, dSimMs;
+
+  clock_gettime(CLOCK_MONOTONIC, &xNow);
+  dHostMs = (double)(prvHostNs(&xNow) - prvHostNs(&xHostStart)) / 1e6;
+  dSimMs = (double)ullSimTimeNs() / 1e6;
+
+  fprintf(stderr, "[sim] %.1f ms simulated in %.1f ms host (%.1fx)\n", dSimMs,
+          dHostMs, dHostMs > 0 ? dSimMs / dHostMs : 0.0);
+  fprintf(stderr, "[sim] tick irqs %llu, frequency analyser irqs %llu\n",
+          (unsigned long long)xIrqs[TIMER1MS_IRQ].ullCount,
+          (unsigned long long)xIrqs[FREQUENCY_ANALYSER_IRQ].ullCount);
+  fprintf(stderr,
+          "[sim] red leds 0x%02lx, green leds 0x%02lx, led writes %llu, "
+          "pixel writes %llu\n",
+          (unsigned long)prvFindPio(RED_LEDS_BASE)->ulRegister[0],
+          (unsigned long)prvFindPio(GREEN_LEDS_BASE)->ulRegister[0],
+          (unsigned long long)ullLedWrites,
+          (unsigned long long)ullSimPixelWrites());
+  fprintf(stderr, "[sim] jtag uart irqs %llu, %llu bytes written\n",
+          (unsigned long long)xIrqs[JTAG_UART_IRQ].ullCount,
+          (unsigned long long)xJtagUart.ullBytes);
+  fprintf(stderr,
+          "[sim] flash: %llu bytes programmed, %llu blocks erased, at most "
+          "%lu times each\n",
+          (unsigned long long)ullSimFlashBytesProgrammed(),
+          (unsigned long long)ullSimFlashErases(),
+          (unsigned long)ulSimFlashMostErases());
+
+  if (pulTrace != NULL) {
+    double dReplayS = (double)ullSimTraceNs() / 1e9;
+
+    fprintf(stderr,
+            "[sim] trace: %lu of %lu samples replayed in %.3f s, "
+            "offered %.1f samples/s\n",
+            (unsigned long)xTraceNext, (unsigned long)xTraceLength, dReplayS,
+            dReplayS > 0 ? (double)xTraceNext / dReplayS : 0.0);
+  }
+
+  if (vApplicationSimReport != NULL) {
+    vApplicationSimReport();
+  }
+}
+
+static void *prvSimThread(void *pvParameters) {
+  struct timespec xDeadline;
+  alt_u64 ullNow, ullNext, ullJtagNs;
+  xSimTimer *pxDue;
+  alt_u32 ulIrq;
+  unsigned int i;
+
+  (void)pvParameters;
+
+  pthread_mutex_lock(&xSimMutex);
+  for (;;) {
+    ullNow = ullSimTimeNs();
+
+    /* Find the earliest pending event. */
+    ullNext = ullNextSampleNs;
+    pxDue = NULL;
+    for (i = 0; i < simNUM_TIMERS; i++) {
+      if (xTimers[i].xRunning && xTimers[i].ullExpiryNs < ullNext) {
+        ullNext = xTimers[i].ullExpiryNs;
+        pxDue = &xTimers[i];
+      }
+    }
+    ullJtagNs = prvJtagUartIrqNs(ullNow);
+    if (ullJtagNs < ullNext) {
+      ullNext = ullJtagNs;
+      pxDue = NULL;
+    }
+    if (ullDurationNs != 0 && ullDurationNs <= ullNext) {
+      ullNext = ullDurationNs;
+      pxDue = NULL;
+    }
+
+    if (ullNext > ullNow) {
+      prvHostDeadline(ullNext, &xDeadline);
+      pthread_cond_timedwait(&xSimCond, &xSimMutex, &xDeadline);
+      continue;
+    }
+
+    if (ullDurationNs != 0 && ullNext == ullDurationNs) {
+      pthread_mutex_unlock(&xSimMutex);
+
+      /* Stop the CPU at an instruction boundary before reporting. */
+      vPortEnterInterrupt();
+      prvReport();
+      exit(EXIT_SUCCESS);
+    }
+
+    if (pxDue != NULL) {
+      pxDue->ulStatus |= ALTERA_AVALON_TIMER_STATUS_TO_MSK;
+      if (pxDue->ulControl & ALTERA_AVALON_TIMER_CONTROL_CONT_MSK) {
+        pxDue->ullExpiryNs += prvCyclesToNs((alt_u64)pxDue->ulPeriod + 1,
+                                            pxDue->ullFrequency);
+      } else {
+        pxDue->xRunning = 0;
+      }
+      if (!(pxDue->ulControl & ALTERA_AVALON_TIMER_CONTROL_ITO_MSK)) {
+        continue;
+      }
+      ulIrq = pxDue->ulIrq;
+    } else if (ullNext == ullJtagNs) {
+      ulIrq = JTAG_UART_IRQ;
+    } else {
+      if (!prvNextSample(ullNow)) {
+        continue;
+      }
+      ulIrq = FREQUENCY_ANALYSER_IRQ;
+    }
+
+    pthread_mutex_unlock(&xSimMutex);
+    prvRaiseIrq(ulIrq);
+    if (ulIrq == JTAG_UART_IRQ) {
+      fflush(stdout);
+    }
+    if (ulIrq == FREQUENCY_ANALYSER_IRQ && dTraceSpeed == 0.0) {
+      /* Back-to-back samples, but let the tasks reach the CPU mutex. */
+      sched_yield();
+    }
+    pthread_mutex_lock(&xSimMutex);
+  }
+
+  return NULL;
+}
+
+/*-----------------------------------------------------------*/
+
+static double prvEnvDouble(const char *pcName, double dDefault) {
+  const char *pcValue = getenv(pcName);
+
+  return pcValue != NULL ? strtod(pcValue, NULL) : dDefault;
+}
+
+/* Runs before main(), in the same place alt_sys_init() initialises the
+hardware on the target. */
+__attribute__((constructor)) static void prvSimInit(void) {
+  pthread_condattr_t xAttr;
+  pthread_t xThread;
+  const char *pcTrace, *pcSpeed;
+
+  dSpeedup = prvEnvDouble("LCFR_SIM_SPEEDUP", 1.0);
+  if (dSpeedup <= 0.0) {
+    dSpeedup = 1.0;
+  }
+  ullDurationNs =
+      (alt_u64)(prvEnvDouble("LCFR_SIM_DURATION_MS", 0.0) * 1e6);
+  dMainsFrequency = prvEnvDouble("LCFR_SIM_FREQ_HZ", 50.0);
+  dIrqRate = prvEnvDouble("LCFR_SIM_IRQ_RATE_HZ", 0.0);
+  dFeedbackHz = prvEnvDouble("LCFR_SIM_FEEDBACK_HZ", 0.0);
+#if (ALT_TIMESTAMP_CLK_BASE != none_BASE)
+  /* What ALTERA_AVALON_TIMER_INIT does for the timestamp timer. */
+  altera_avalon_timer_ts_base = (void *)ALT_TIMESTAMP_CLK_BASE;
+  altera_avalon_timer_ts_freq = TIMER1US_FREQ;
+#endif
+  prvFindPio(SLIDE_SWITCH_BASE)->ulRegister[0] =
+      (alt_u32)prvEnvDouble("LCFR_SIM_SWITCHES", 0x1f);
+
+  pcTrace = getenv("LCFR_SIM_TRACE");
+  if (pcTrace != NULL) {
+    if (prvLoadTrace(pcTrace) != 0) {
+      fprintf(stderr, "[sim] could not read trace %s\n", pcTrace);
+      exit(EXIT_FAILURE);
+    }
+    pcSpeed = getenv("LCFR_SIM_TRACE_SPEED");
+    if (pcSpeed != NULL && strcmp(pcSpeed, "max") == 0) {
+      dTraceSpeed = 0.0;
+    } else {
+      dTraceSpeed = prvEnvDouble("LCFR_SIM_TRACE_SPEED", 1.0);
+      if (dTraceSpeed <= 0.0) {
+        dTraceSpeed = 1.0;
+      }
+    }
+  }
+
+  pthread_condattr_init(&xAttr);
+  pthread_condattr_setclock(&xAttr, CLOCK_MONOTONIC);
+  pthread_cond_init(&xSimCond, &xAttr);
+  pthread_condattr_destroy(&xAttr);
+
+  clock_gettime(CLOCK_MONOTONIC, &xHostStart);
+  if (pulTrace != NULL) {
+    ullNextSampleNs = dTraceSpeed == 0.0
+                          ? 0
+                          : (alt_u64)((double)pulTrace[0] * simNS_PER_SECOND /
+                                      simSAMPLING_FREQUENCY / dTraceSpeed);
+  } else {
+    ullNextSampleNs =
+        (alt_u64)((double)simNS_PER_SECOND /
+                  (dIrqRate > 0.0 ? dIrqRate : dMainsFrequency));
+  }
+
+  pthread_create(&xThread, NULL, prvSimThread, NULL);
+  pthread_detach(xThread);
+}
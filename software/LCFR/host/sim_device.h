@@ -0,0 +1,53 @@
+#ifndef SIM_DEVICE_H
+#define SIM_DEVICE_H
+
+/*
+ * Simulated DE2-115 peripherals for the host build.  See sim_device.c for the
+ * register map and the environment variables that configure a run.
+ */
+
+#include "alt_types.h"
+
+/* The load_timer interval timer LCFR_HW_LOAD_TIMER builds time load
+management with, see load_timer.h.  The DE2-115 system.h has none, so the
+simulator adds one at a free address and interrupt. */
+#ifndef LOAD_TIMER_BASE
+#define LOAD_TIMER_BASE 0x43140
+#define LOAD_TIMER_IRQ 4
+#define LOAD_TIMER_FREQ 100000000
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/* Simulated nanoseconds since power-on.  Advances at LCFR_SIM_SPEEDUP times
+host wall-clock time. */
+extern alt_u64 ullSimTimeNs( void );
+
+/* Total pixels written through the pixel buffer stand-in, reported at the end
+of a run. */
+extern alt_u64 ullSimPixelWrites( void );
+
+/* Bytes programmed into and blocks erased in the simulated CFI flash, and the
+most times any one block was erased, all since the run started.  See
+altera_avalon_cfi_flash.c. */
+extern alt_u64 ullSimFlashBytesProgrammed( void );
+extern alt_u64 ullSimFlashErases( void );
+extern alt_u32 ulSimFlashMostErases( void );
+
+/* Simulated nanoseconds between the first and last sample of a replayed
+trace, up to now if the run ended first, or 0 when no trace was replayed. */
+extern alt_u64 ullSimTraceNs( void );
+
+/* Optional hook the application can define to add its own counters to the
+report printed when a timed run ends.  Runs in interrupt context with the
+scheduler frozen. */
+extern void vApplicationSimReport( void ) __attribute__( ( weak ) );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_DEVICE_H */
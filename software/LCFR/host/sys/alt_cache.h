@@ -0,0 +1,27 @@
+#ifndef __ALT_CACHE_H__
+#define __ALT_CACHE_H__
+
+/*
+ * Host stand-in for the Nios II HAL sys/alt_cache.h.
+ *
+ * The host has no cache to bypass, so flushing is a no-op.
+ */
+
+#include "alt_types.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+static inline void alt_dcache_flush (void* start, alt_u32 len)
+{
+	(void)start;
+	(void)len;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ALT_CACHE_H__ */
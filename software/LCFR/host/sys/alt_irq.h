@@ -0,0 +1,30 @@
+#ifndef __ALT_IRQ_H__
+#define __ALT_IRQ_H__
+
+/*
+ * Host stand-in for the Nios II HAL sys/alt_irq.h.
+ *
+ * Only the legacy registration API used by the LCFR is provided.  Handlers
+ * are stored by sim_device.c and called from the simulator thread whenever
+ * the matching simulated peripheral raises its interrupt.
+ */
+
+#include "alt_types.h"
+#include "system.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+#define ALT_NIRQ 32
+
+typedef void (*alt_isr_func)(void* isr_context, alt_u32 id);
+
+extern int alt_irq_register (alt_u32 id, void* context, alt_isr_func handler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ALT_IRQ_H__ */
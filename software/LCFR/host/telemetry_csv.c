@@ -0,0 +1,69 @@
+/*
+ * CSV rows for telemetry records.  See telemetry_csv.h.
+ */
+
+#include "telemetry_csv.h"
+
+const char *const pcTelemetrySourceNames[TELEMETRY_NUM_SOURCES] = {
+    "frequency analyser", "load manager", "maintenance"};
+
+static const char *const pcEventNames[TELEMETRY_NUM_EVENTS] = {
+    "stability", "shed",        "reconnect", "timer reset", "management exit",
+    "maintenance", "sample"};
+
+static const char *const pcResetNames[] = {"already active", "unstable",
+                                           "reconnecting"};
+
+int xTelemetryEventSource(uint8_t ucEvent) {
+  switch (ucEvent) {
+  case TELEMETRY_STABILITY:
+  case TELEMETRY_SAMPLE:
+    return TELEMETRY_FREQUENCY_ANALYSER;
+  case TELEMETRY_SHED:
+  case TELEMETRY_RECONNECT:
+  case TELEMETRY_TIMER_RESET:
+  case TELEMETRY_MANAGEMENT_EXIT:
+    return TELEMETRY_LOAD_MANAGER;
+  case TELEMETRY_MAINTENANCE_TOGGLE:
+    return TELEMETRY_MAINTENANCE;
+  default:
+    return TELEMETRY_NUM_SOURCES;
+  }
+}
+
+void vTelemetryCsvRecord(double dTime, int xSource,
+                         const TelemetryRecord *pxRecord) {
+  unsigned long long ullLoads =
+      pxRecord->value[0] | (unsigned long long)pxRecord->value[1] << 32;
+
+  printf("%.6f,%s,", dTime,
+         xSource < TELEMETRY_NUM_SOURCES ? pcTelemetrySourceNames[xSource]
+                                         : "unknown");
+  if (pxRecord->event >= TELEMETRY_NUM_EVENTS) {
+    printf("%u,,,,,\n", pxRecord->event);
+    return;
+  }
+  printf("%s,", pcEventNames[pxRecord->event]);
+
+  switch (pxRecord->event) {
+  case TELEMETRY_STABILITY:
+  case TELEMETRY_SAMPLE:
+    printf("%u,,,%.4f,%.4f\n", pxRecord->detail,
+           (int32_t)pxRecord->value[0] / 65536.0,
+           (int32_t)pxRecord->value[1] / 65536.0);
+    break;
+  case TELEMETRY_SHED:
+    printf("%u,%u,0x%llx,,\n", pxRecord->detail, pxRecord->count, ullLoads);
+    break;
+  case TELEMETRY_RECONNECT:
+    printf("%u,,0x%llx,,\n", pxRecord->detail, ullLoads);
+    break;
+  case TELEMETRY_TIMER_RESET:
+    printf("%s,,,,\n", pxRecord->detail < 3 ? pcResetNames[pxRecord->detail]
+                                            : "unknown");
+    break;
+  default:
+    printf("%u,,,,\n", pxRecord->detail);
+    break;
+  }
+}
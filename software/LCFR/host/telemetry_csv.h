@@ -0,0 +1,26 @@
+#ifndef TELEMETRY_CSV_H
+#define TELEMETRY_CSV_H
+
+/*
+ * CSV rows for telemetry records, shared by telemetry_decode.c and
+ * flash_log_read.c.
+ */
+
+#include <stdio.h>
+
+#include "telemetry.h"
+
+/* Column names after any the caller puts first, without the newline. */
+#define telemetryCSV_COLUMNS \
+  "time_s,source,event,detail,count,loads,frequency_hz,roc_hz_per_s"
+
+extern const char *const pcTelemetrySourceNames[TELEMETRY_NUM_SOURCES];
+
+/* The source that logs ucEvent, or TELEMETRY_NUM_SOURCES if it is unknown. */
+extern int xTelemetryEventSource(uint8_t ucEvent);
+
+/* Prints one row from the time column on. */
+extern void vTelemetryCsvRecord(double dTime, int xSource,
+                                const TelemetryRecord *pxRecord);
+
+#endif /* TELEMETRY_CSV_H */
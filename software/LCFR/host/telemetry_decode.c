@@ -0,0 +1,140 @@
+/*
+ * Decoder for the binary event log written by ../telemetry.c.
+ *
+ * Reads a telemetry stream from the file named on the command line, or stdin,
+ * and prints every record as a CSV row.  The stream may be a JTAG UART capture
+ * with text between the frames: anything that is not a whole frame starting
+ * with the magic is skipped.
+ *
+ * Times are seconds on the alt_timestamp() clock, unwrapped across the 32-bit
+ * counter overflowing as long as no two consecutive records are a full wrap
+ * apart.  Rows are in drain order, one source's frame at a time, so records of
+ * different sources within one drain period can be out of time order.  A row
+ * with the event "dropped" is written wherever a source's dropped count went
+ * up since its previous frame.
+ *
+ * Frames are read in the host's byte order, which is the Nios II's.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "read_all.h"
+#include "telemetry.h"
+#include "telemetry_csv.h"
+
+typedef struct DECODER {
+  int xStarted;
+  uint32_t ulLastTimestamp;
+  long long llTime; // unwrapped timestamp ticks
+  double dTime;     // llTime in seconds
+  uint32_t ulDropped[TELEMETRY_NUM_SOURCES];
+  unsigned long ulFrames;
+  unsigned long ulRecords;
+  unsigned long ulSkipped; // bytes outside frames
+} xDecoder;
+
+static double prvTime(xDecoder *pxDecoder, uint32_t ulTimestamp,
+                      uint32_t ulFreq) {
+  if (!pxDecoder->xStarted) {
+    pxDecoder->llTime = ulTimestamp;
+    pxDecoder->xStarted = 1;
+  } else {
+    pxDecoder->llTime += (int32_t)(ulTimestamp - pxDecoder->ulLastTimestamp);
+  }
+  pxDecoder->ulLastTimestamp = ulTimestamp;
+  pxDecoder->dTime = ulFreq == 0 ? 0.0 : (double)pxDecoder->llTime / ulFreq;
+  return pxDecoder->dTime;
+}
+
+static void prvPrintRecord(xDecoder *pxDecoder,
+                           const TelemetryFrameHeader *pxHeader,
+                           const TelemetryRecord *pxRecord) {
+  vTelemetryCsvRecord(
+      prvTime(pxDecoder, pxRecord->timestamp, pxHeader->timestampFreq),
+      pxHeader->source, pxRecord);
+}
+
+/*
+ * Returns the size of the frame at pucData, or 0 if there is no whole frame
+ * there.
+ */
+static size_t prvDecodeFrame(xDecoder *pxDecoder, const unsigned char *pucData,
+                             size_t xSize) {
+  TelemetryFrameHeader xHeader;
+  TelemetryRecord xRecord;
+  size_t xFrameSize;
+  unsigned int i;
+
+  if (xSize < sizeof(xHeader)) {
+    return 0;
+  }
+  memcpy(&xHeader, pucData, sizeof(xHeader));
+  if (xHeader.magic != TELEMETRY_MAGIC ||
+      xHeader.version != TELEMETRY_VERSION ||
+      xHeader.source >= TELEMETRY_NUM_SOURCES ||
+      xHeader.count > TELEMETRY_RING_SIZE) {
+    return 0;
+  }
+  xFrameSize = sizeof(xHeader) + xHeader.count * sizeof(xRecord);
+  if (xSize < xFrameSize) {
+    return 0;
+  }
+
+  if (xHeader.dropped != pxDecoder->ulDropped[xHeader.source]) {
+    printf("%.6f,%s,dropped,,%lu,,,\n", pxDecoder->dTime,
+           pcTelemetrySourceNames[xHeader.source],
+           (unsigned long)(xHeader.dropped -
+                           pxDecoder->ulDropped[xHeader.source]));
+    pxDecoder->ulDropped[xHeader.source] = xHeader.dropped;
+  }
+
+  for (i = 0; i < xHeader.count; i++) {
+    memcpy(&xRecord, pucData + sizeof(xHeader) + i * sizeof(xRecord),
+           sizeof(xRecord));
+    prvPrintRecord(pxDecoder, &xHeader, &xRecord);
+  }
+  pxDecoder->ulFrames++;
+  pxDecoder->ulRecords += xHeader.count;
+  return xFrameSize;
+}
+
+int main(int argc, char **argv) {
+  xDecoder xState = {0};
+  FILE *pxFile = stdin;
+  unsigned char *pucData;
+  size_t xSize, xOffset = 0;
+
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [telemetry file]\n", argv[0]);
+    return 2;
+  }
+  if (argc == 2 && (pxFile = fopen(argv[1], "rb")) == NULL) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  pucData = pucReadAll(pxFile, &xSize);
+  if (pucData == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+
+  printf(telemetryCSV_COLUMNS "\n");
+  while (xOffset < xSize) {
+    size_t xFrameSize =
+        prvDecodeFrame(&xState, pucData + xOffset, xSize - xOffset);
+
+    if (xFrameSize == 0) {
+      xState.ulSkipped++;
+      xOffset++;
+    } else {
+      xOffset += xFrameSize;
+    }
+  }
+
+  fprintf(stderr, "%lu frames, %lu records, %lu bytes skipped\n",
+          xState.ulFrames, xState.ulRecords, xState.ulSkipped);
+  free(pucData);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,413 @@
+/*
+ * Converter from the trace recorder's dumps (../trace_recorder.c) to Chrome
+ * trace-event JSON, for chrome://tracing or ui.perfetto.dev.
+ *
+ * Reads the frames from the file named on the command line, or stdin, which
+ * may be a JTAG UART capture with text and telemetry between them, and prints
+ * one JSON document.  Each dump is a process of its own.  Each task is a
+ * thread, ordered by priority, with a slice for every stretch it ran; each
+ * interrupt is a thread above them with a slice per handler run.  Queue,
+ * semaphore, notification and timer events are instants on whatever was
+ * running, and the trigger is an instant across the whole dump.
+ *
+ * Times are microseconds on the alt_timestamp() clock from the dump's first
+ * record, unwrapped as telemetry_decode does.
+ *
+ * Frames are read in the host's byte order, which is the Nios II's.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "system.h"
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/timers.h"
+
+#include "trace_recorder.h"
+
+#include "read_all.h"
+
+#define jsonISR_TID_BASE 100
+#define jsonMAX_NESTING 8
+
+typedef struct ISR_RUN {
+  uint8_t ucIrq;
+  double dStart;
+} xIsrRun;
+
+typedef struct CONVERTER {
+  int xInDump;
+  uint32_t ulDump;
+  uint32_t ulFreq;
+  TraceName xTasks[TRACE_RECORDER_MAX_TASKS + 1]; // by number, 0 unknown
+  TraceName xQueues[TRACE_RECORDER_MAX_QUEUES + 1];
+  uint32_t ulIsrsNamed; // bit per IRQ given a thread in this dump
+  int xStarted;
+  uint32_t ulLastTimestamp;
+  long long llTime; // unwrapped timestamp ticks since the first record
+  double dTime;     // llTime in microseconds
+  int xRunning;     // task number, or -1 before the first switch
+  double dRunStart;
+  xIsrRun xIsrs[jsonMAX_NESTING];
+  int xIsrDepth;
+  int xFirstEvent;
+  unsigned long ulDumps;
+  unsigned long ulRecords;
+} xConverter;
+
+static const char *const pcEventNames[TRACE_NUM_EVENTS] = {
+    [TRACE_TASK_SWITCHED_IN] = "switched in",
+    [TRACE_TASK_READY] = "ready",
+    [TRACE_TASK_DELAY] = "delay",
+    [TRACE_ISR_ENTER] = "isr enter",
+    [TRACE_ISR_EXIT] = "isr exit",
+    [TRACE_QUEUE_SEND] = "queue send",
+    [TRACE_QUEUE_SEND_FROM_ISR] = "queue send from isr",
+    [TRACE_QUEUE_SEND_FAILED] = "queue send failed",
+    [TRACE_QUEUE_RECEIVE] = "queue receive",
+    [TRACE_QUEUE_RECEIVE_FROM_ISR] = "queue receive from isr",
+    [TRACE_QUEUE_BLOCK_SEND] = "blocked on queue send",
+    [TRACE_QUEUE_BLOCK_RECEIVE] = "blocked on queue receive",
+    [TRACE_NOTIFY] = "notify",
+    [TRACE_NOTIFY_FROM_ISR] = "notify from isr",
+    [TRACE_NOTIFY_BLOCK] = "blocked on notification",
+    [TRACE_NOTIFY_RECEIVE] = "notification taken",
+    [TRACE_TIMER_COMMAND_SEND] = "timer command send",
+    [TRACE_TIMER_COMMAND_RECEIVED] = "timer command received",
+    [TRACE_TIMER_EXPIRED] = "timer expired",
+    [TRACE_TRIGGER] = "trigger",
+};
+
+static const char *const pcQueueTypes[] = {"queue", "mutex",
+                                           "counting semaphore",
+                                           "binary semaphore",
+                                           "recursive mutex"};
+
+static const char *prvIrqName(uint8_t ucIrq) {
+  switch (ucIrq) {
+  case TIMER1MS_IRQ:
+    return "tick";
+  case TIMER1US_IRQ:
+    return "timer1us";
+  case PUSH_BUTTON_IRQ:
+    return "push button";
+  case PS2_IRQ:
+    return "keyboard";
+  case JTAG_UART_IRQ:
+    return "jtag uart";
+  case FREQUENCY_ANALYSER_IRQ:
+    return "frequency analyser";
+  default:
+    return "irq";
+  }
+}
+
+static const char *prvTimerCommandName(uint8_t ucCommand) {
+  switch ((int8_t)ucCommand) {
+  case tmrCOMMAND_EXECUTE_CALLBACK_FROM_ISR:
+  case tmrCOMMAND_EXECUTE_CALLBACK:
+    return "pend function call";
+  case tmrCOMMAND_START_DONT_TRACE:
+  case tmrCOMMAND_START:
+  case tmrCOMMAND_START_FROM_ISR:
+    return "start";
+  case tmrCOMMAND_RESET:
+  case tmrCOMMAND_RESET_FROM_ISR:
+    return "reset";
+  case tmrCOMMAND_STOP:
+  case tmrCOMMAND_STOP_FROM_ISR:
+    return "stop";
+  case tmrCOMMAND_CHANGE_PERIOD:
+  case tmrCOMMAND_CHANGE_PERIOD_FROM_ISR:
+    return "change period";
+  case tmrCOMMAND_DELETE:
+    return "delete";
+  default:
+    return "unknown";
+  }
+}
+
+/* Prints the separator and the fields every event has. */
+static void prvBeginEvent(xConverter *pxConv, const char *pcPhase,
+                          const char *pcName, int xTid, double dTime) {
+  printf("%s\n{\"ph\":\"%s\",\"name\":\"%s\",\"pid\":%lu,\"tid\":%d,"
+         "\"ts\":%.3f",
+         pxConv->xFirstEvent ? "" : ",", pcPhase, pcName,
+         (unsigned long)pxConv->ulDump, xTid, dTime);
+  pxConv->xFirstEvent = 0;
+}
+
+static void prvThreadName(xConverter *pxConv, int xTid, const char *pcName,
+                          int xSortIndex) {
+  prvBeginEvent(pxConv, "M", "thread_name", xTid, 0.0);
+  printf(",\"args\":{\"name\":\"%s\"}}", pcName);
+  prvBeginEvent(pxConv, "M", "thread_sort_index", xTid, 0.0);
+  printf(",\"args\":{\"sort_index\":%d}}", xSortIndex);
+}
+
+static const char *prvTaskName(const xConverter *pxConv, uint8_t ucTask) {
+  if (ucTask <= TRACE_RECORDER_MAX_TASKS &&
+      pxConv->xTasks[ucTask].name[0] != '\0') {
+    return pxConv->xTasks[ucTask].name;
+  }
+  return "unknown task";
+}
+
+static void prvPrintQueueName(const xConverter *pxConv, uint8_t ucQueue) {
+  const TraceName *pxName =
+      ucQueue <= TRACE_RECORDER_MAX_QUEUES ? &pxConv->xQueues[ucQueue] : NULL;
+
+  if (pxName != NULL && pxName->name[0] != '\0') {
+    printf("%.*s", (int)sizeof(pxName->name), pxName->name);
+  } else if (pxName != NULL && pxName->detail < 5) {
+    printf("%s %u", pcQueueTypes[pxName->detail], ucQueue);
+  } else {
+    printf("queue %u", ucQueue);
+  }
+}
+
+/* Closes the running task's slice and any handler still running. */
+static void prvEndDump(xConverter *pxConv) {
+  if (!pxConv->xInDump) {
+    return;
+  }
+  if (pxConv->xRunning >= 0) {
+    prvBeginEvent(pxConv, "X", prvTaskName(pxConv, pxConv->xRunning),
+                  pxConv->xRunning, pxConv->dRunStart);
+    printf(",\"dur\":%.3f}", pxConv->dTime - pxConv->dRunStart);
+  }
+  while (pxConv->xIsrDepth > 0) {
+    xIsrRun *pxRun = &pxConv->xIsrs[--pxConv->xIsrDepth];
+
+    prvBeginEvent(pxConv, "X", prvIrqName(pxRun->ucIrq),
+                  jsonISR_TID_BASE + pxRun->ucIrq, pxRun->dStart);
+    printf(",\"dur\":%.3f}", pxConv->dTime - pxRun->dStart);
+  }
+  pxConv->xInDump = 0;
+}
+
+static void prvBeginDump(xConverter *pxConv, const TraceFrameHeader *pxHeader,
+                         const unsigned char *pucNames) {
+  char pcName[configMAX_TASK_NAME_LEN + 32];
+  unsigned int i;
+  TraceName xName;
+
+  prvEndDump(pxConv);
+  memset(pxConv->xTasks, 0, sizeof(pxConv->xTasks));
+  memset(pxConv->xQueues, 0, sizeof(pxConv->xQueues));
+  pxConv->xInDump = 1;
+  pxConv->ulDump = pxHeader->dump;
+  pxConv->ulFreq = pxHeader->timestampFreq;
+  pxConv->xStarted = 0;
+  pxConv->llTime = 0;
+  pxConv->dTime = 0.0;
+  pxConv->xRunning = -1;
+  pxConv->xIsrDepth = 0;
+  pxConv->ulIsrsNamed = 0;
+  pxConv->ulDumps++;
+
+  prvBeginEvent(pxConv, "M", "process_name", 0, 0.0);
+  printf(",\"args\":{\"name\":\"dump %lu\"}}", (unsigned long)pxHeader->dump);
+
+  for (i = 0; i < pxHeader->count; i++) {
+    memcpy(&xName, pucNames + i * sizeof(xName), sizeof(xName));
+    xName.name[sizeof(xName.name) - 1] = '\0';
+    if (xName.kind == TRACE_NAME_TASK &&
+        xName.number <= TRACE_RECORDER_MAX_TASKS) {
+      pxConv->xTasks[xName.number] = xName;
+      snprintf(pcName, sizeof(pcName), "%s (%u)", xName.name, xName.detail);
+      prvThreadName(pxConv, xName.number, pcName, -(int)xName.detail);
+    } else if (xName.kind == TRACE_NAME_QUEUE &&
+               xName.number <= TRACE_RECORDER_MAX_QUEUES) {
+      pxConv->xQueues[xName.number] = xName;
+    }
+  }
+}
+
+static void prvConvertRecord(xConverter *pxConv, const TraceRecord *pxRecord) {
+  int xTid;
+
+  if (!pxConv->xStarted) {
+    pxConv->xStarted = 1;
+    pxConv->llTime = 0;
+  } else {
+    pxConv->llTime += (int32_t)(pxRecord->timestamp - pxConv->ulLastTimestamp);
+  }
+  pxConv->ulLastTimestamp = pxRecord->timestamp;
+  pxConv->dTime =
+      pxConv->ulFreq == 0 ? 0.0 : (double)pxConv->llTime * 1e6 / pxConv->ulFreq;
+  pxConv->ulRecords++;
+
+  switch (pxRecord->event) {
+  case TRACE_TASK_SWITCHED_IN:
+    if (pxConv->xRunning >= 0) {
+      prvBeginEvent(pxConv, "X", prvTaskName(pxConv, pxConv->xRunning),
+                    pxConv->xRunning, pxConv->dRunStart);
+      printf(",\"dur\":%.3f}", pxConv->dTime - pxConv->dRunStart);
+    }
+    pxConv->xRunning = pxRecord->object;
+    pxConv->dRunStart = pxConv->dTime;
+    return;
+
+  case TRACE_ISR_ENTER:
+    if (pxConv->xIsrDepth < jsonMAX_NESTING) {
+      pxConv->xIsrs[pxConv->xIsrDepth].ucIrq = pxRecord->object;
+      pxConv->xIsrs[pxConv->xIsrDepth].dStart = pxConv->dTime;
+      pxConv->xIsrDepth++;
+    }
+    if (pxRecord->object < 32 &&
+        !(pxConv->ulIsrsNamed & (1UL << pxRecord->object))) {
+      pxConv->ulIsrsNamed |= 1UL << pxRecord->object;
+      prvThreadName(pxConv, jsonISR_TID_BASE + pxRecord->object,
+                    prvIrqName(pxRecord->object),
+                    -(int)jsonISR_TID_BASE - pxRecord->object);
+    }
+    return;
+
+  case TRACE_ISR_EXIT:
+    // an exit whose entry was overwritten has nothing to close
+    if (pxConv->xIsrDepth > 0 &&
+        pxConv->xIsrs[pxConv->xIsrDepth - 1].ucIrq == pxRecord->object) {
+      xIsrRun *pxRun = &pxConv->xIsrs[--pxConv->xIsrDepth];
+
+      prvBeginEvent(pxConv, "X", prvIrqName(pxRun->ucIrq),
+                    jsonISR_TID_BASE + pxRun->ucIrq, pxRun->dStart);
+      printf(",\"dur\":%.3f}", pxConv->dTime - pxRun->dStart);
+    }
+    return;
+
+  case TRACE_TRIGGER:
+    prvBeginEvent(pxConv, "i", "trigger", 0, pxConv->dTime);
+    printf(",\"s\":\"g\",\"args\":{\"reason\":%u}}", pxRecord->value);
+    return;
+
+  default:
+    break;
+  }
+
+  if (pxRecord->event >= TRACE_NUM_EVENTS) {
+    return;
+  }
+
+  // everything else happened in whatever was running
+  xTid = pxConv->xIsrDepth > 0
+             ? jsonISR_TID_BASE + pxConv->xIsrs[pxConv->xIsrDepth - 1].ucIrq
+             : pxConv->xRunning >= 0 ? pxConv->xRunning : 0;
+  prvBeginEvent(pxConv, "i", pcEventNames[pxRecord->event], xTid,
+                pxConv->dTime);
+  printf(",\"s\":\"t\",\"args\":{");
+
+  switch (pxRecord->event) {
+  case TRACE_TASK_READY:
+  case TRACE_TASK_DELAY:
+  case TRACE_NOTIFY:
+  case TRACE_NOTIFY_FROM_ISR:
+  case TRACE_NOTIFY_BLOCK:
+  case TRACE_NOTIFY_RECEIVE:
+    printf("\"task\":\"%s\"", prvTaskName(pxConv, pxRecord->object));
+    break;
+  case TRACE_TIMER_COMMAND_SEND:
+    printf("\"command\":\"%s\",\"sent\":%u",
+           prvTimerCommandName(pxRecord->object), pxRecord->value);
+    break;
+  case TRACE_TIMER_COMMAND_RECEIVED:
+    printf("\"command\":\"%s\"", prvTimerCommandName(pxRecord->object));
+    break;
+  case TRACE_TIMER_EXPIRED:
+    break;
+  default:
+    printf("\"queue\":\"");
+    prvPrintQueueName(pxConv, pxRecord->object);
+    printf("\",\"waiting\":%u", pxRecord->value);
+    break;
+  }
+  printf("}}");
+}
+
+/*
+ * Returns the size of the frame at pucData, or 0 if there is no whole frame
+ * there.
+ */
+static size_t prvConvertFrame(xConverter *pxConv, const unsigned char *pucData,
+                              size_t xSize) {
+  TraceFrameHeader xHeader;
+  TraceRecord xRecord;
+  size_t xEntrySize, xFrameSize;
+  unsigned int i;
+
+  if (xSize < sizeof(xHeader)) {
+    return 0;
+  }
+  memcpy(&xHeader, pucData, sizeof(xHeader));
+  if (xHeader.magic != TRACE_MAGIC || xHeader.version != TRACE_VERSION) {
+    return 0;
+  }
+  if (xHeader.type == TRACE_FRAME_NAMES &&
+      xHeader.count <= TRACE_RECORDER_MAX_TASKS + TRACE_RECORDER_MAX_QUEUES) {
+    xEntrySize = sizeof(TraceName);
+  } else if (xHeader.type == TRACE_FRAME_RECORDS &&
+             xHeader.count <= TRACE_RECORDER_FRAME_RECORDS) {
+    xEntrySize = sizeof(TraceRecord);
+  } else {
+    return 0;
+  }
+  xFrameSize = sizeof(xHeader) + xHeader.count * xEntrySize;
+  if (xSize < xFrameSize) {
+    return 0;
+  }
+
+  if (xHeader.type == TRACE_FRAME_NAMES) {
+    prvBeginDump(pxConv, &xHeader, pucData + sizeof(xHeader));
+    return xFrameSize;
+  }
+
+  // records of a dump whose names were lost are skipped
+  if (!pxConv->xInDump || xHeader.dump != pxConv->ulDump) {
+    return xFrameSize;
+  }
+  for (i = 0; i < xHeader.count; i++) {
+    memcpy(&xRecord, pucData + sizeof(xHeader) + i * sizeof(xRecord),
+           sizeof(xRecord));
+    prvConvertRecord(pxConv, &xRecord);
+  }
+  return xFrameSize;
+}
+
+int main(int argc, char **argv) {
+  xConverter xState = {0};
+  FILE *pxFile = stdin;
+  unsigned char *pucData;
+  size_t xSize, xOffset = 0;
+
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [trace file]\n", argv[0]);
+    return 2;
+  }
+  if (argc == 2 && (pxFile = fopen(argv[1], "rb")) == NULL) {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  pucData = pucReadAll(pxFile, &xSize);
+  if (pucData == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+
+  xState.xFirstEvent = 1;
+  printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  while (xOffset < xSize) {
+    size_t xFrameSize =
+        prvConvertFrame(&xState, pucData + xOffset, xSize - xOffset);
+
+    xOffset += xFrameSize == 0 ? 1 : xFrameSize;
+  }
+  prvEndDump(&xState);
+  printf("\n]}\n");
+
+  fprintf(stderr, "%lu dumps, %lu records\n", xState.ulDumps,
+          xState.ulRecords);
+  free(pucData);
+  return EXIT_SUCCESS;
+}
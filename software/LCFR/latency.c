@@ -0,0 +1,151 @@
+#include "latency.h"
+
+#include <stdbool.h>
+
+#include "altera_avalon_timer.h"
+#include "altera_avalon_timer_regs.h"
+
+#include "loads.h"
+
+/*
+ * Log-linear buckets: values below SUB_BUCKETS get a bucket each, and every
+ * power of two above that is split into SUB_BUCKETS equal buckets. This keeps
+ * a full 32-bit range at 1/16 resolution in 464 counters per stage.
+ */
+#define SUB_BUCKET_BITS 4
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define NUM_BUCKETS ((32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS)
+
+struct latencyHistogram_t {
+  volatile uint32_t count;
+  volatile uint32_t min;
+  volatile uint32_t max;
+  volatile uint32_t buckets[NUM_BUCKETS];
+};
+
+static struct latencyHistogram_t histograms[LATENCY_NUM_STAGES];
+static bool latencyEnabled = false;
+
+static const char *const stageNames[LATENCY_NUM_STAGES] = {
+    "receive", "decision", "shed", "led write"};
+
+static unsigned int bucketOf(uint32_t value) {
+  if (value < SUB_BUCKETS) {
+    return value;
+  }
+
+  // the same highest set bit the load selection uses, see loads.h
+#if LOADS_USE_CLZ_TABLE
+  int shift = loadHighestBit32Table(value) - SUB_BUCKET_BITS;
+#else
+  int shift = loadHighestBit32Clz(value) - SUB_BUCKET_BITS;
+#endif
+  return (shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+// largest value that falls in the bucket
+static uint32_t bucketLimit(unsigned int bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+
+  int shift = bucket / SUB_BUCKETS - 1;
+  uint32_t lower = (uint32_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+  return lower + ((1u << shift) - 1);
+}
+
+void latencyInit(void) {
+  int stage;
+
+  for (stage = 0; stage < LATENCY_NUM_STAGES; stage++) {
+    histograms[stage].min = UINT32_MAX;
+  }
+  latencyEnabled = alt_timestamp_start() >= 0;
+
+  // alt_timestamp_start() leaves the counter to stop after one 43 s period at
+  // 100 MHz, so let it wrap instead. Elapsed times are unsigned differences.
+  if (latencyEnabled) {
+    IOWR_ALTERA_AVALON_TIMER_CONTROL(altera_avalon_timer_ts_base,
+                                     ALTERA_AVALON_TIMER_CONTROL_CONT_MSK |
+                                         ALTERA_AVALON_TIMER_CONTROL_START_MSK);
+  }
+}
+
+void latencyRecord(LatencyStage stage, uint32_t start) {
+  if (!latencyEnabled) {
+    return;
+  }
+
+  // unsigned difference, so a wrap in between is harmless
+  uint32_t elapsed = latencyNow() - start;
+  struct latencyHistogram_t *histogram = &histograms[stage];
+
+  histogram->buckets[bucketOf(elapsed)]++;
+  if (elapsed < histogram->min) {
+    histogram->min = elapsed;
+  }
+  if (elapsed > histogram->max) {
+    histogram->max = elapsed;
+  }
+  histogram->count++;
+}
+
+/**
+ * Value at the given rank (per 1000 samples), from a copy of the buckets.
+ */
+static uint32_t percentile(const uint32_t *buckets, uint32_t count,
+                           uint32_t max, unsigned int perMille) {
+  uint64_t rank = ((uint64_t)count * perMille + 999) / 1000;
+  uint64_t seen = 0;
+  unsigned int bucket;
+
+  for (bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+    seen += buckets[bucket];
+    if (seen >= rank) {
+      uint32_t limit = bucketLimit(bucket);
+      return limit < max ? limit : max;
+    }
+  }
+  return max;
+}
+
+void latencyDump(FILE *out) {
+  static uint32_t buckets[NUM_BUCKETS];
+  double usPerTick;
+  int stage;
+  unsigned int bucket;
+
+  if (!latencyEnabled) {
+    fprintf(out, "latency: no timestamp timer in the BSP\n");
+    return;
+  }
+  usPerTick = 1e6 / (double)alt_timestamp_freq();
+
+  fprintf(out, "latency since frequency ISR (us):\n");
+  fprintf(out, "%-14s %8s %9s %9s %9s %9s %9s\n", "stage", "count", "min",
+          "p50", "p99", "p99.9", "max");
+
+  for (stage = 0; stage < LATENCY_NUM_STAGES; stage++) {
+    struct latencyHistogram_t *histogram = &histograms[stage];
+    uint32_t count = 0;
+
+    // count from the copy so the percentiles agree with the buckets
+    for (bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+      buckets[bucket] = histogram->buckets[bucket];
+      count += buckets[bucket];
+    }
+    if (count == 0) {
+      fprintf(out, "%-14s %8d\n", stageNames[stage], 0);
+      continue;
+    }
+
+    uint32_t max = histogram->max;
+    fprintf(out, "%-14s %8lu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+            stageNames[stage], (unsigned long)count,
+            histogram->min * usPerTick,
+            percentile(buckets, count, max, 500) * usPerTick,
+            percentile(buckets, count, max, 990) * usPerTick,
+            percentile(buckets, count, max, 999) * usPerTick,
+            max * usPerTick);
+  }
+}
@@ -0,0 +1,51 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sys/alt_timestamp.h"
+
+/*
+ * Shed latency instrumentation.
+ *
+ * frequencyDetectorISR() takes an alt_timestamp() when a sample arrives, and
+ * the timestamp travels with the sample through the relay. Each later stage
+ * records the time elapsed since that interrupt into its own histogram.
+ *
+ * Every stage is recorded from a single task, so the histograms need no locks.
+ * A dump taken while a stage is recording can be off by that one sample.
+ */
+
+typedef enum {
+  LATENCY_RECEIVE,   // sample taken off the ring by the analyser task
+  LATENCY_DECISION,  // stability decided for the sample
+  LATENCY_SHED,      // shedLoad() returned for an unstable sample
+  LATENCY_LED_WRITE, // red LEDs written with the shed load
+  LATENCY_NUM_STAGES
+} LatencyStage;
+
+/**
+ * Starts the timestamp timer. Recording is disabled if the BSP has no
+ * timestamp timer (hal.timestamp_timer is none).
+ */
+void latencyInit(void);
+
+/**
+ * Current alt_timestamp() value, taken at ISR entry to start a measurement.
+ */
+static inline uint32_t latencyNow(void) { return (uint32_t)alt_timestamp(); }
+
+/**
+ * Records the time elapsed since start against the given stage.
+ */
+void latencyRecord(LatencyStage stage, uint32_t start);
+
+/**
+ * Prints count, min, p50, p99, p99.9 and max for every stage, in microseconds.
+ * Percentiles are rounded up to their histogram bucket, within 1/16 of the
+ * value.
+ */
+void latencyDump(FILE *out);
+
+#endif /* LATENCY_H */
@@ -0,0 +1,168 @@
+#include "load_timer.h"
+
+#include <math.h>
+
+#include "FreeRTOS/task.h"
+
+#include "latency.h"
+#include "relay_state.h"
+
+#if configUSE_HW_LOAD_TIMER == 1
+#include "altera_avalon_timer_regs.h"
+#include "sys/alt_irq.h"
+#include "system.h"
+
+#ifdef LCFR_POSIX_GCC
+#include "sim_device.h"
+#endif
+
+#ifndef LOAD_TIMER_BASE
+#error "LCFR_HW_LOAD_TIMER needs an interval timer named load_timer in the Qsys system"
+#endif
+#endif
+
+#if configUSE_HW_LOAD_TIMER == 1
+static uint32_t period; // load_timer counts, one less than the interval
+#else
+static TimerHandle_t softwareTimer;
+#endif
+
+/*
+ * Written by the owner only and read without a lock. armed is the
+ * latencyNow() of the last reset, and pending is set from then until the
+ * RELAY_TIMER it leads to is applied or the deadline is stopped.
+ */
+static struct loadTimerStats_t {
+  uint32_t interval; // timestamp ticks
+  uint32_t armed;
+  bool pending;
+  volatile uint32_t deadlines;
+  volatile uint32_t stale; // applied after the deadline was reset again
+  volatile int64_t totalLateness; // timestamp ticks
+  volatile uint64_t totalSquaredLateness;
+  volatile int32_t leastLateness;
+  volatile int32_t mostLateness;
+} stats;
+
+#if configUSE_HW_LOAD_TIMER == 1
+/**
+ * The one-shot timed out. Clearing TO drops the interrupt, and the owner is
+ * notified directly rather than through its command queue, which can be full.
+ */
+static void loadTimerISR(void *context, alt_u32 id) {
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  IOWR_ALTERA_AVALON_TIMER_STATUS(LOAD_TIMER_BASE, 0);
+  relaySignalFromISR(RELAY_SIGNAL_TIMER, &higherPriorityTaskWoken);
+  portEND_SWITCHING_ISR(higherPriorityTaskWoken);
+}
+#endif
+
+void loadTimerInit(TimerHandle_t timer, uint32_t intervalMs) {
+  stats.interval = (uint32_t)((uint64_t)alt_timestamp_freq() * intervalMs /
+                              1000);
+#if configUSE_HW_LOAD_TIMER == 1
+  (void)timer;
+  period = (uint32_t)((uint64_t)LOAD_TIMER_FREQ * intervalMs / 1000) - 1;
+
+  // writing the period stops the counter and loads it
+  IOWR_ALTERA_AVALON_TIMER_PERIODL(LOAD_TIMER_BASE, period & 0xFFFF);
+  IOWR_ALTERA_AVALON_TIMER_PERIODH(LOAD_TIMER_BASE, period >> 16);
+  IOWR_ALTERA_AVALON_TIMER_STATUS(LOAD_TIMER_BASE, 0);
+  alt_irq_register(LOAD_TIMER_IRQ, NULL, loadTimerISR);
+#else
+  softwareTimer = timer;
+#endif
+}
+
+void loadTimerReset(void) {
+  stats.armed = latencyNow();
+  stats.pending = true;
+#if configUSE_HW_LOAD_TIMER == 1
+  // a timeout the ISR has not taken yet must not follow the new deadline
+  taskENTER_CRITICAL();
+  IOWR_ALTERA_AVALON_TIMER_PERIODL(LOAD_TIMER_BASE, period & 0xFFFF);
+  IOWR_ALTERA_AVALON_TIMER_PERIODH(LOAD_TIMER_BASE, period >> 16);
+  IOWR_ALTERA_AVALON_TIMER_STATUS(LOAD_TIMER_BASE, 0);
+  IOWR_ALTERA_AVALON_TIMER_CONTROL(LOAD_TIMER_BASE,
+                                   ALTERA_AVALON_TIMER_CONTROL_ITO_MSK |
+                                       ALTERA_AVALON_TIMER_CONTROL_START_MSK);
+  taskEXIT_CRITICAL();
+#else
+  xTimerReset(softwareTimer, 10);
+#endif
+}
+
+void loadTimerStop(void) {
+#if configUSE_HW_LOAD_TIMER == 1
+  taskENTER_CRITICAL();
+  IOWR_ALTERA_AVALON_TIMER_CONTROL(LOAD_TIMER_BASE,
+                                   ALTERA_AVALON_TIMER_CONTROL_STOP_MSK);
+  IOWR_ALTERA_AVALON_TIMER_STATUS(LOAD_TIMER_BASE, 0);
+  taskEXIT_CRITICAL();
+#else
+  xTimerStop(softwareTimer, 10);
+#endif
+  stats.pending = false;
+}
+
+bool loadTimerIsActive(void) {
+#if configUSE_HW_LOAD_TIMER == 1
+  return (IORD_ALTERA_AVALON_TIMER_STATUS(LOAD_TIMER_BASE) &
+          ALTERA_AVALON_TIMER_STATUS_RUN_MSK) != 0;
+#else
+  return xTimerIsTimerActive(softwareTimer) != pdFALSE;
+#endif
+}
+
+void loadTimerExpired(void) {
+  int32_t lateness;
+
+  if (!stats.pending || loadTimerIsActive()) {
+    stats.stale++;
+    return;
+  }
+
+  lateness = (int32_t)(latencyNow() - stats.armed - stats.interval);
+  stats.pending = false;
+  if (stats.deadlines == 0 || lateness < stats.leastLateness) {
+    stats.leastLateness = lateness;
+  }
+  if (stats.deadlines == 0 || lateness > stats.mostLateness) {
+    stats.mostLateness = lateness;
+  }
+  stats.totalLateness += lateness;
+  stats.totalSquaredLateness += (uint64_t)((int64_t)lateness * lateness);
+  stats.deadlines++;
+}
+
+#if configUSE_TIMERS == 1
+void loadTimerCallback(TimerHandle_t timer) {
+  relaySignal(RELAY_SIGNAL_TIMER);
+}
+#endif
+
+void loadTimerDump(FILE *out) {
+  uint32_t deadlines = stats.deadlines;
+  double usPerTick = 1e6 / alt_timestamp_freq();
+  double mean = 0.0, deviation = 0.0;
+
+  if (deadlines != 0) {
+    mean = (double)stats.totalLateness / deadlines;
+    deviation = (double)stats.totalSquaredLateness / deadlines - mean * mean;
+    deviation = deviation > 0.0 ? sqrt(deviation) : 0.0;
+  }
+
+  fprintf(out,
+          "load timer (%s): %lu deadlines, %lu stale, late by mean %.1f us, "
+          "sd %.1f us, least %.1f us, most %.1f us\n",
+#if configUSE_HW_LOAD_TIMER == 1
+          "hardware",
+#else
+          "software",
+#endif
+          (unsigned long)deadlines, (unsigned long)stats.stale,
+          mean * usPerTick, deviation * usPerTick,
+          deadlines == 0 ? 0.0 : stats.leastLateness * usPerTick,
+          deadlines == 0 ? 0.0 : stats.mostLateness * usPerTick);
+}
@@ -0,0 +1,73 @@
+#ifndef LOAD_TIMER_H
+#define LOAD_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/timers.h"
+
+/*
+ * The load management deadline: the time loadManagerTask() waits after a shed
+ * or reconnect before taking the next step.
+ *
+ * By default a one-shot FreeRTOS software timer keeps it. Each restart goes
+ * through the timer command queue to the timer service task, which runs at
+ * configTIMER_TASK_PRIORITY, below every relay task, and the expiry is only
+ * seen at a tick. Built with LCFR_HW_LOAD_TIMER, the load_timer interval
+ * timer keeps it instead: a restart is a few register writes from the owner,
+ * and the timeout interrupt raises RELAY_SIGNAL_TIMER in the owner's task
+ * notification value directly, bypassing both the timer and the relay
+ * command queues. The DE2-115 system has no spare timer, so the board needs
+ * an interval timer named load_timer added to the Qsys system, with a 32-bit
+ * counter and no fixed period. The host simulator provides one.
+ *
+ * Every function but loadTimerInit() and loadTimerDump() is called by the
+ * relay state's owner only, see relay_state.h. loadTimerDump() reports how
+ * late each deadline reached the owner, from its restart to the RELAY_TIMER
+ * the owner applied: the jitter of the shed and reconnect cadence.
+ */
+
+/**
+ * Sets the deadline intervalMs after each restart. timer is a one-shot
+ * software timer of that period whose callback is loadTimerCallback(), or
+ * NULL when built with LCFR_HW_LOAD_TIMER. Call before the scheduler starts.
+ */
+void loadTimerInit(TimerHandle_t timer, uint32_t intervalMs);
+
+/**
+ * Starts the deadline again from now, whether or not it was running.
+ */
+void loadTimerReset(void);
+
+/**
+ * Cancels the deadline.
+ */
+void loadTimerStop(void);
+
+/**
+ * Returns true while the deadline is running.
+ */
+bool loadTimerIsActive(void);
+
+/**
+ * Records how late the deadline reached the owner. Called as the owner
+ * applies a RELAY_TIMER.
+ */
+void loadTimerExpired(void);
+
+/**
+ * The software timer's callback, which signals RELAY_SIGNAL_TIMER to the
+ * owner.
+ */
+void loadTimerCallback(TimerHandle_t timer);
+
+/**
+ * Prints the mechanism, the deadlines met and reset before they were
+ * applied, and the mean, standard deviation, least and most lateness, in
+ * microseconds.
+ */
+void loadTimerDump(FILE *out);
+
+#endif /* LOAD_TIMER_H */
@@ -0,0 +1,202 @@
+#include "loads.h"
+
+#include <stdlib.h>
+
+const uint8_t loadHighestBitTable[256] = {
+    0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+};
+
+/*
+ * The five loads on the DE2-115 slide switches, least important first.
+ * Dwells default to the load management timer period, so a shed load waits
+ * one period, less LOAD_DWELL_SLACK_MS, before it can be reconnected.
+ */
+LoadDescriptor loadTable[NUM_OF_LOADS] = {
+    {.priority = 0, .nominalKw = 3, .minOnMs = 0, .minOffMs = 500},
+    {.priority = 1, .nominalKw = 5, .minOnMs = 0, .minOffMs = 500},
+    {.priority = 2, .nominalKw = 2, .minOnMs = 0, .minOffMs = 500},
+    {.priority = 3, .nominalKw = 8, .minOnMs = 0, .minOffMs = 500},
+    {.priority = 4, .nominalKw = 6, .minOnMs = 0, .minOffMs = 500},
+};
+
+// load numbers in the order they are shed, and each load's place in it
+static uint8_t rankToLoad[NUM_OF_LOADS];
+static uint8_t loadToRank[NUM_OF_LOADS];
+
+// each nibble value of a load map, as ranks and as combined nominal kW
+#define LOAD_NIBBLES ((NUM_OF_LOADS + 3) / 4)
+static LoadMap nibbleRanks[LOAD_NIBBLES][16];
+static uint32_t nibbleKw[LOAD_NIBBLES][16];
+
+static uint32_t lastSwitchMs[NUM_OF_LOADS];
+
+/*
+ * The loads with a minimum off (0) or on (1) dwell, and the loads switched
+ * since their dwell was last found to have passed. Only those need their
+ * switch time checked.
+ */
+static LoadMap hasDwell[2];
+static LoadMap dwelling[2];
+
+static int compareRanks(const void *a, const void *b) {
+  const LoadDescriptor *loadA = &loadTable[*(const uint8_t *)a];
+  const LoadDescriptor *loadB = &loadTable[*(const uint8_t *)b];
+
+  if (loadA->priority != loadB->priority) {
+    return loadA->priority - loadB->priority;
+  }
+  return *(const uint8_t *)a - *(const uint8_t *)b;
+}
+
+void loadsInit(void) {
+  int i;
+
+  for (i = 0; i < NUM_OF_LOADS; i++) {
+    if (loadTable[i].nominalKw == 0) {
+      loadTable[i].priority = i;
+      loadTable[i].nominalKw = LOAD_DEFAULT_KW;
+    }
+    rankToLoad[i] = i;
+  }
+  qsort(rankToLoad, NUM_OF_LOADS, sizeof(rankToLoad[0]), compareRanks);
+  hasDwell[0] = hasDwell[1] = dwelling[0] = dwelling[1] = 0;
+  for (i = 0; i < NUM_OF_LOADS; i++) {
+    loadToRank[rankToLoad[i]] = i;
+    if (loadTable[i].minOffMs > LOAD_DWELL_SLACK_MS) {
+      hasDwell[0] |= (LoadMap)1 << i;
+    }
+    if (loadTable[i].minOnMs > LOAD_DWELL_SLACK_MS) {
+      hasDwell[1] |= (LoadMap)1 << i;
+    }
+  }
+
+  for (i = 0; i < LOAD_NIBBLES; i++) {
+    int value, bit;
+
+    for (value = 0; value < 16; value++) {
+      nibbleRanks[i][value] = 0;
+      nibbleKw[i][value] = 0;
+      for (bit = 0; bit < 4; bit++) {
+        int load = 4 * i + bit;
+
+        if ((value & (1 << bit)) && load < NUM_OF_LOADS) {
+          nibbleRanks[i][value] |= (LoadMap)1 << loadToRank[load];
+          nibbleKw[i][value] += loadTable[load].nominalKw;
+        }
+      }
+    }
+  }
+}
+
+// the same loads with bit n standing for the load ranked n
+static LoadMap toRanks(LoadMap loads) {
+  LoadMap ranks = 0;
+  int i;
+
+  for (i = 0; i < LOAD_NIBBLES; i++) {
+    ranks |= nibbleRanks[i][(loads >> (4 * i)) & 0xF];
+  }
+  return ranks;
+}
+
+uint32_t loadsCount(LoadMap loads) {
+  uint32_t count = 0;
+
+  while (loads != 0) {
+    loads &= loads - 1;
+    count++;
+  }
+  return count;
+}
+
+uint32_t loadsKw(LoadMap loads) {
+  uint32_t kw = 0;
+  int i;
+
+  for (i = 0; i < LOAD_NIBBLES; i++) {
+    kw += nibbleKw[i][(loads >> (4 * i)) & 0xF];
+  }
+  return kw;
+}
+
+LoadMap loadsSelectShed(LoadMap candidates, uint32_t deficitKw) {
+  LoadMap ranks = toRanks(candidates);
+  LoadMap shed = 0;
+  uint32_t kw = 0;
+
+  do {
+    if (ranks == 0) {
+      break;
+    }
+    int load = rankToLoad[loadIndexOfHighest(loadLeastImportant(ranks))];
+    ranks &= ranks - 1;
+    shed |= (LoadMap)1 << load;
+    kw += loadTable[load].nominalKw;
+  } while (kw < deficitKw);
+
+  return shed;
+}
+
+LoadMap loadsSelectShedCount(LoadMap candidates, uint32_t count) {
+  LoadMap ranks = toRanks(candidates);
+  LoadMap shed = 0;
+
+  while (ranks != 0 && count-- != 0) {
+    int load = rankToLoad[loadIndexOfHighest(loadLeastImportant(ranks))];
+    ranks &= ranks - 1;
+    shed |= (LoadMap)1 << load;
+  }
+  return shed;
+}
+
+LoadMap loadsSelectReconnect(LoadMap candidates) {
+  LoadMap ranks = toRanks(candidates);
+
+  if (ranks == 0) {
+    return 0;
+  }
+  return (LoadMap)1 << rankToLoad[loadIndexOfHighest(ranks)];
+}
+
+LoadMap loadsPastDwell(LoadMap loads, bool isOn, uint32_t nowMs) {
+  LoadMap unknown = loads & dwelling[isOn];
+  LoadMap past = loads & ~unknown;
+
+  while (unknown != 0) {
+    int load = loadIndexOfHighest(unknown);
+    uint32_t dwell = isOn ? loadTable[load].minOnMs : loadTable[load].minOffMs;
+
+    if (nowMs - lastSwitchMs[load] + LOAD_DWELL_SLACK_MS >= dwell) {
+      past |= (LoadMap)1 << load;
+      dwelling[isOn] &= ~((LoadMap)1 << load);
+    }
+    unknown &= ~((LoadMap)1 << load);
+  }
+  return past;
+}
+
+void loadsSwitched(LoadMap loads, uint32_t nowMs) {
+  dwelling[0] |= loads & hasDwell[0];
+  dwelling[1] |= loads & hasDwell[1];
+  while (loads != 0) {
+    int load = loadIndexOfHighest(loads);
+
+    lastSwitchMs[load] = nowMs;
+    loads &= ~((LoadMap)1 << load);
+  }
+}
@@ -0,0 +1,172 @@
+#ifndef LOADS_H
+#define LOADS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Load bitmaps. Bit n stands for load n, relay n and slide switch n. How
+ * important each load is comes from loadTable; loadLeastImportant() and
+ * loadMostImportant() go by bit position alone.
+ *
+ * NUM_OF_LOADS sets the width of a LoadMap, 32 bits for up to 32 loads and 64
+ * bits beyond that. Finding the highest or lowest set bit takes a fixed number
+ * of steps whatever the width. Selecting by priority also puts the candidates
+ * in rank order and sums their kW, which takes a table lookup per four loads
+ * of width, and checks the switch time of only those loads switched since
+ * their dwell was last found to have passed. No step is taken per candidate.
+ */
+
+#ifndef NUM_OF_LOADS
+#define NUM_OF_LOADS 5
+#endif
+
+#if NUM_OF_LOADS <= 32
+typedef uint32_t LoadMap;
+#define LOAD_MAP_BITS 32
+#elif NUM_OF_LOADS <= 64
+typedef uint64_t LoadMap;
+#define LOAD_MAP_BITS 64
+#else
+#error "NUM_OF_LOADS must be 64 or less"
+#endif
+
+#define LOAD_MASK (~(LoadMap)0 >> (LOAD_MAP_BITS - NUM_OF_LOADS))
+
+/*
+ * The Nios II has no count leading zeros instruction, so __builtin_clz() is a
+ * libgcc call there and a byte lookup is cheaper.
+ */
+#ifndef LOADS_USE_CLZ_TABLE
+#ifdef __nios2__
+#define LOADS_USE_CLZ_TABLE 1
+#else
+#define LOADS_USE_CLZ_TABLE 0
+#endif
+#endif
+
+// index of the highest set bit of each byte value, 0 for 0
+extern const uint8_t loadHighestBitTable[256];
+
+static inline int loadHighestBit32Table(uint32_t x) {
+  if (x >> 16) {
+    return x >> 24 ? 24 + loadHighestBitTable[x >> 24]
+                   : 16 + loadHighestBitTable[x >> 16];
+  }
+  return x >> 8 ? 8 + loadHighestBitTable[x >> 8] : loadHighestBitTable[x];
+}
+
+static inline int loadHighestBit32Clz(uint32_t x) {
+  return 31 - __builtin_clz(x);
+}
+
+/**
+ * Index of the highest set bit of loads, which must not be empty.
+ */
+static inline int loadIndexOfHighest(LoadMap loads) {
+#if LOAD_MAP_BITS == 64
+  if (loads >> 32) {
+#if LOADS_USE_CLZ_TABLE
+    return 32 + loadHighestBit32Table((uint32_t)(loads >> 32));
+#else
+    return 32 + loadHighestBit32Clz((uint32_t)(loads >> 32));
+#endif
+  }
+#endif
+#if LOADS_USE_CLZ_TABLE
+  return loadHighestBit32Table((uint32_t)loads);
+#else
+  return loadHighestBit32Clz((uint32_t)loads);
+#endif
+}
+
+/**
+ * Least important load in loads as a single bit map, or 0 if loads is empty.
+ */
+static inline LoadMap loadLeastImportant(LoadMap loads) {
+  return loads & (~loads + 1);
+}
+
+/**
+ * Most important load in loads as a single bit map, or 0 if loads is empty.
+ */
+static inline LoadMap loadMostImportant(LoadMap loads) {
+  return loads == 0 ? 0 : (LoadMap)1 << loadIndexOfHighest(loads);
+}
+
+/*
+ * Load descriptors. Loads with a lower priority are shed first and reconnected
+ * last; equal priorities go by load number. A load is not switched again by
+ * the relay until it has been on for minOnMs or off for minOffMs.
+ */
+typedef struct {
+  uint8_t priority;
+  uint16_t nominalKw;
+  uint16_t minOnMs;
+  uint16_t minOffMs;
+} LoadDescriptor;
+
+// loads after the ones listed get priority by number and LOAD_DEFAULT_KW
+#define LOAD_DEFAULT_KW 4
+
+/*
+ * Switch times are read from the scheduler tick, and the load management
+ * deadline that ends a dwell need not fall on a tick boundary (see
+ * load_timer.h), so a dwell of exactly one deadline can read a tick short.
+ * A dwell is taken as served up to LOAD_DWELL_SLACK_MS early rather than
+ * waiting a whole further deadline.
+ */
+#ifndef LOAD_DWELL_SLACK_MS
+#define LOAD_DWELL_SLACK_MS 1 // one tick at configTICK_RATE_HZ 1000
+#endif
+
+extern LoadDescriptor loadTable[NUM_OF_LOADS];
+
+/**
+ * Fills in unlisted loads, ranks the table by priority and builds the lookup
+ * tables selection uses. Call before any of the functions below, and again if
+ * loadTable changes.
+ */
+void loadsInit(void);
+
+/**
+ * Number of loads in loads.
+ */
+uint32_t loadsCount(LoadMap loads);
+
+/**
+ * Combined nominal kW of loads.
+ */
+uint32_t loadsKw(LoadMap loads);
+
+/**
+ * The lowest priority loads out of candidates whose combined kW covers
+ * deficitKw, or all of them if they do not. Always at least one load if there
+ * are any candidates. Costs one step per load selected.
+ */
+LoadMap loadsSelectShed(LoadMap candidates, uint32_t deficitKw);
+
+/**
+ * The count lowest priority loads out of candidates, or all of them if there
+ * are fewer.
+ */
+LoadMap loadsSelectShedCount(LoadMap candidates, uint32_t count);
+
+/**
+ * Highest priority load out of candidates, or 0 if there are none.
+ */
+LoadMap loadsSelectReconnect(LoadMap candidates);
+
+/**
+ * The loads out of loads that have been on (isOn) or off for their minimum
+ * dwell at nowMs, less LOAD_DWELL_SLACK_MS. A load found past its dwell stays
+ * past it until it is switched again, so nowMs must not go backwards.
+ */
+LoadMap loadsPastDwell(LoadMap loads, bool isOn, uint32_t nowMs);
+
+/**
+ * Records that the relay switched loads at nowMs.
+ */
+void loadsSwitched(LoadMap loads, uint32_t nowMs);
+
+#endif /* LOADS_H */
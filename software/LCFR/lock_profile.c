@@ -0,0 +1,255 @@
+#include "lock_profile.h"
+
+#include <string.h>
+
+#include "latency.h"
+
+typedef struct {
+  const char *lock;
+  char holder[configMAX_TASK_NAME_LEN];
+  UBaseType_t priority; // the holder's when the wait began
+} ChainLink;
+
+typedef struct {
+  uint32_t wait; // timestamp ticks
+  char waiter[configMAX_TASK_NAME_LEN];
+  UBaseType_t priority;
+  uint32_t length;
+  ChainLink links[LOCK_PROFILE_MAX_CHAIN];
+} InversionChain;
+
+static ProfiledLock *locks[LOCK_PROFILE_MAX_LOCKS];
+static uint32_t numLocks;
+
+// the lock each waiting task waits for, changed in a critical section
+static struct {
+  TaskHandle_t task;
+  const ProfiledLock *lock;
+} waiting[LOCK_PROFILE_MAX_TASKS];
+
+// longest first, recorded in a critical section and read without a lock
+static InversionChain worstChains[LOCK_PROFILE_WORST_CHAINS];
+
+void lockProfileInit(ProfiledLock *lock, const char *name,
+                     SemaphoreHandle_t handle) {
+  configASSERT(numLocks < LOCK_PROFILE_MAX_LOCKS);
+
+  memset(lock, 0, sizeof(*lock));
+  lock->name = name;
+  lock->handle = handle;
+  locks[numLocks++] = lock;
+}
+
+static void copyName(char *name, TaskHandle_t task) {
+  strncpy(name, pcTaskGetTaskName(task), configMAX_TASK_NAME_LEN - 1);
+  name[configMAX_TASK_NAME_LEN - 1] = '\0';
+}
+
+static const ProfiledLock *waitingFor(TaskHandle_t task) {
+  uint32_t i;
+
+  for (i = 0; i < LOCK_PROFILE_MAX_TASKS; i++) {
+    if (waiting[i].task == task) {
+      return waiting[i].lock;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Sets the lock task waits for, NULL once it stops waiting. Called in a
+ * critical section.
+ */
+static void setWaiting(TaskHandle_t task, const ProfiledLock *lock) {
+  uint32_t i;
+  uint32_t free = LOCK_PROFILE_MAX_TASKS;
+
+  for (i = 0; i < LOCK_PROFILE_MAX_TASKS; i++) {
+    if (waiting[i].task == task) {
+      break;
+    }
+    if (waiting[i].task == NULL && free == LOCK_PROFILE_MAX_TASKS) {
+      free = i;
+    }
+  }
+  if (i == LOCK_PROFILE_MAX_TASKS) {
+    configASSERT(free < LOCK_PROFILE_MAX_TASKS);
+    i = free;
+  }
+
+  waiting[i].task = lock != NULL ? task : NULL;
+  waiting[i].lock = lock;
+}
+
+/**
+ * Fills in chain's holders from lock on, and returns true if any of them runs
+ * below chain's waiter. Called in a critical section.
+ */
+static bool followChain(const ProfiledLock *lock, InversionChain *chain) {
+  bool inverted = false;
+
+  chain->length = 0;
+  while (lock != NULL && chain->length < LOCK_PROFILE_MAX_CHAIN) {
+    TaskHandle_t holder = lock->holder;
+
+    if (holder == NULL) {
+      break;
+    }
+
+    ChainLink *link = &chain->links[chain->length++];
+
+    link->lock = lock->name;
+    copyName(link->holder, holder);
+    link->priority = uxTaskPriorityGet(holder);
+    if (link->priority < chain->priority) {
+      inverted = true;
+    }
+    lock = waitingFor(holder);
+  }
+  return inverted;
+}
+
+/*
+ * Keeps chain if it waited longer than one of the worst. Called in a critical
+ * section.
+ */
+static void recordChain(const InversionChain *chain) {
+  uint32_t i = LOCK_PROFILE_WORST_CHAINS - 1;
+
+  if (chain->wait <= worstChains[i].wait) {
+    return;
+  }
+  while (i > 0 && worstChains[i - 1].wait < chain->wait) {
+    worstChains[i] = worstChains[i - 1];
+    i--;
+  }
+  worstChains[i] = *chain;
+}
+
+bool lockProfileTake(ProfiledLock *lock, TickType_t timeout) {
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  InversionChain chain;
+  bool waited = false;
+  bool inverted = false;
+  uint32_t start = latencyNow();
+
+  if (xSemaphoreTake(lock->handle, 0) != pdTRUE) {
+    waited = true;
+
+    taskENTER_CRITICAL();
+    copyName(chain.waiter, self);
+    chain.priority = uxTaskPriorityGet(self);
+    inverted = followChain(lock, &chain);
+    setWaiting(self, lock);
+    taskEXIT_CRITICAL();
+
+    bool taken = xSemaphoreTake(lock->handle, timeout) == pdTRUE;
+
+    taskENTER_CRITICAL();
+    setWaiting(self, NULL);
+    if (!taken) {
+      lock->stats.timeouts++;
+    }
+    taskEXIT_CRITICAL();
+    if (!taken) {
+      return false;
+    }
+  }
+
+  uint32_t now = latencyNow();
+  uint32_t wait = now - start;
+
+  lock->holder = self;
+  lock->taken = now;
+
+  taskENTER_CRITICAL();
+  lock->stats.takes++;
+  if (waited) {
+    lock->stats.waits++;
+    lock->stats.totalWait += wait;
+    if (wait > lock->stats.worstWait) {
+      lock->stats.worstWait = wait;
+    }
+  }
+  if (inverted) {
+    lock->stats.inversions++;
+    chain.wait = wait;
+    recordChain(&chain);
+  }
+  taskEXIT_CRITICAL();
+  return true;
+}
+
+void lockProfileGive(ProfiledLock *lock) {
+  uint32_t held = latencyNow() - lock->taken;
+
+  lock->stats.totalHold += held;
+  if (held > lock->stats.worstHold) {
+    lock->stats.worstHold = held;
+  }
+  lock->holder = NULL;
+  xSemaphoreGive(lock->handle);
+}
+
+static const char *lockKind(const ProfiledLock *lock) {
+  switch (ucQueueGetQueueType(lock->handle)) {
+  case queueQUEUE_TYPE_MUTEX:
+    return "mutex";
+  case queueQUEUE_TYPE_RECURSIVE_MUTEX:
+    return "recursive mutex";
+  case queueQUEUE_TYPE_BINARY_SEMAPHORE:
+    return "binary semaphore";
+  default:
+    return "semaphore";
+  }
+}
+
+static void dumpChain(FILE *out, const InversionChain *chain,
+                      double ticksPerUs) {
+  uint32_t i;
+
+  fprintf(out, "locks: %.1f us inversion: %s (%lu)", chain->wait / ticksPerUs,
+          chain->waiter, (unsigned long)chain->priority);
+  for (i = 0; i < chain->length; i++) {
+    fprintf(out, "%s %s held by %s (%lu)",
+            i == 0 ? " waited on" : ", waiting on", chain->links[i].lock,
+            chain->links[i].holder, (unsigned long)chain->links[i].priority);
+  }
+  fprintf(out, "\n");
+}
+
+void lockProfileDump(FILE *out) {
+  double ticksPerUs = alt_timestamp_freq() / 1e6;
+  uint32_t i;
+
+  for (i = 0; i < numLocks; i++) {
+    const ProfiledLock *lock = locks[i];
+    uint32_t takes = lock->stats.takes;
+    uint32_t waits = lock->stats.waits;
+
+    fprintf(out,
+            "locks: %s (%s) %lu takes, %lu waited, %lu inverted, %lu timed "
+            "out\n",
+            lock->name, lockKind(lock), (unsigned long)takes,
+            (unsigned long)waits, (unsigned long)lock->stats.inversions,
+            (unsigned long)lock->stats.timeouts);
+    if (ticksPerUs > 0) {
+      fprintf(out,
+              "locks: %s waits %.1f us mean, %.1f us worst; held %.1f us "
+              "mean, %.1f us worst\n",
+              lock->name,
+              waits == 0 ? 0.0 : lock->stats.totalWait / ticksPerUs / waits,
+              lock->stats.worstWait / ticksPerUs,
+              takes == 0 ? 0.0 : lock->stats.totalHold / ticksPerUs / takes,
+              lock->stats.worstHold / ticksPerUs);
+    }
+  }
+
+  if (ticksPerUs > 0) {
+    for (i = 0; i < LOCK_PROFILE_WORST_CHAINS; i++) {
+      if (worstChains[i].length > 0) {
+        dumpChain(out, &worstChains[i], ticksPerUs);
+      }
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#ifndef LOCK_PROFILE_H
+#define LOCK_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/semphr.h"
+#include "FreeRTOS/task.h"
+
+/*
+ * Lock contention profiling.
+ *
+ * A ProfiledLock wraps a FreeRTOS semaphore used as a lock.
+ * lockProfileTake() and lockProfileGive() take and give it as xSemaphoreTake()
+ * and xSemaphoreGive() do, and record for each lock how often a take had to
+ * wait, how long it waited and how long the lock was then held.
+ *
+ * A take that has to wait follows the chain of waits from the lock: its
+ * holder, the lock that holder is waiting for, that lock's holder and so on.
+ * If a holder on the chain runs below the waiter's priority, the wait is a
+ * priority inversion, and any task between the two priorities can preempt
+ * that holder and hold up the waiter for as long as it runs.
+ * lockProfileDump() prints the inversions that waited longest with their
+ * chains.
+ *
+ * A binary semaphore leaves the holder at its own priority. A mutex from
+ * xSemaphoreCreateMutex() raises its holder to the highest priority waiting
+ * for it until it gives it back, which bounds the wait by the holder's time
+ * with the lock. The kernel only raises the holder of the lock waited for,
+ * not the holders further down a chain.
+ *
+ * ../host/lock_bench.c replays the six state locks the relay took before it
+ * gave its state a single owner (see relay_state.h), once with binary
+ * semaphores and once with mutexes.
+ */
+
+#define LOCK_PROFILE_MAX_LOCKS 8
+#define LOCK_PROFILE_MAX_TASKS 16
+#define LOCK_PROFILE_MAX_CHAIN 4 // holders followed from a waiter
+#define LOCK_PROFILE_WORST_CHAINS 4
+
+/*
+ * Takes are recorded in a critical section, as several tasks take a lock.
+ * Holds are recorded by the holder, which the lock itself keeps to one task.
+ * All of it is read without a lock.
+ */
+struct lockProfileStats_t {
+  volatile uint32_t takes;
+  volatile uint32_t waits;      // takes that found the lock held
+  volatile uint32_t inversions; // waits with a lower priority holder
+  volatile uint32_t timeouts;
+  volatile uint64_t totalWait; // timestamp ticks
+  volatile uint32_t worstWait;
+  volatile uint64_t totalHold;
+  volatile uint32_t worstHold;
+};
+
+typedef struct {
+  const char *name;
+  SemaphoreHandle_t handle;
+  volatile TaskHandle_t holder; // NULL while the lock is free
+  uint32_t taken;               // latencyNow() when the holder took it
+  struct lockProfileStats_t stats;
+} ProfiledLock;
+
+/**
+ * Profiles handle, a mutex or a binary semaphore that has been given once, as
+ * lock under name. At most LOCK_PROFILE_MAX_LOCKS locks are profiled.
+ */
+void lockProfileInit(ProfiledLock *lock, const char *name,
+                     SemaphoreHandle_t handle);
+
+/**
+ * Waits up to timeout to take lock. Returns false if it timed out. Called
+ * from tasks, at most LOCK_PROFILE_MAX_TASKS of which wait at once.
+ */
+bool lockProfileTake(ProfiledLock *lock, TickType_t timeout);
+
+/**
+ * Gives lock back. Called by the task that took it.
+ */
+void lockProfileGive(ProfiledLock *lock);
+
+/**
+ * Prints each lock's takes, waits, inversions and wait and hold times, then
+ * the LOCK_PROFILE_WORST_CHAINS inversions that waited longest.
+ */
+void lockProfileDump(FILE *out);
+
+#endif /* LOCK_PROFILE_H */
@@ -1,171 +1,1187 @@
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "sys/alt_irq.h"
-#include "system.h"
-#include "io.h"
+#include <string.h>
+
+#include "altera_avalon_pio_regs.h"
 #include "altera_up_avalon_video_character_buffer_with_dma.h"
 #include "altera_up_avalon_video_pixel_buffer_dma.h"
-
+#include "io.h"
+#include "sys/alt_cache.h"
+#include "sys/alt_irq.h"
+#include "system.h"
 
 #include "FreeRTOS/FreeRTOS.h"
-#include "FreeRTOS/task.h"
 #include "FreeRTOS/queue.h"
+#include "FreeRTOS/task.h"
+#include "FreeRTOS/timers.h"
+
+#include "console.h"
+#include "cpu_load.h"
+#include "flash_log.h"
+#include "frequency.h"
+#include "latency.h"
+#include "load_timer.h"
+#include "loads.h"
+#include "plot.h"
+#include "relay_state.h"
+#include "seqlock.h"
+#include "shedding.h"
+#include "spsc_ring.h"
+#include "task_events.h"
+#include "task_stats.h"
+#include "telemetry.h"
+#include "trace_recorder.h"
+
+#ifdef LCFR_POSIX_GCC
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sim_device.h"
+#endif
+
+/*
+ * CONSTANT VARIABLES
+ */
+#define LOAD_MANAGEMENT_TIMER_INTERVAL 500
+#define FREQUENCY_HISTORY_SIZE 100
+#define SAMPLE_RING_SIZE 128 // must be a power of two
+#define LOAD_CONTROL_QUEUE_LENGTH 10
+#define TASK_STATS_PERIOD_MS 5000
 
-//For frequency plot
-#define FREQPLT_ORI_X 101		//x axis pixel position at the plot origin
-#define FREQPLT_GRID_SIZE_X 5	//pixel separation in the x axis between two data points
-#define FREQPLT_ORI_Y 199.0		//y axis pixel position at the plot origin
-#define FREQPLT_FREQ_RES 20.0	//number of pixels per Hz (y axis scale)
+#define DEFAULT_FREQUENCY_THRESHOLD 49.0 // Hz
+#define DEFAULT_ROC_THRESHOLD 8.0        // Hz/s
+
+#define NOMINAL_FREQUENCY 50.0 // Hz
+#define SHED_KW_PER_HZ 10      // load deficit per Hz below nominal
+
+// Task priorities
+#define FREQUENCY_TASK_PRIORITY 10
+#define LED_MANAGER_TASK_PRIORITY 9
+#define LOAD_MANAGER_TASK_PRIORITY 8
+#define SWITCH_MONITOR_TASK_PRIORITY 5
+#define VGA_DISPLAY_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#define LATENCY_REPORT_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#define TELEMETRY_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#define FLASH_LOG_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#define TRACE_RECORDER_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+
+// For frequency plot
+#define FREQPLT_ORI_X 101     // x axis pixel position at the plot origin
+#define FREQPLT_GRID_SIZE_X 5 // pixel separation in the x axis between two data points
+#define FREQPLT_ORI_Y 199.0   // y axis pixel position at the plot origin
+#define FREQPLT_FREQ_RES 20.0 // number of pixels per Hz (y axis scale)
 
 #define ROCPLT_ORI_X 101
 #define ROCPLT_GRID_SIZE_X 5
 #define ROCPLT_ORI_Y 259.0
-#define ROCPLT_ROC_RES 0.5		//number of pixels per Hz/s (y axis scale)
+#define ROCPLT_ROC_RES 0.5 // number of pixels per Hz/s (y axis scale)
+
+#define MIN_FREQ 45.0 // minimum frequency to draw
+
+// Events posted to tasks, see task_events.h
+#define EVENT_REPORT 0x01 // to latencyReportTask(), from push button 1
+
+struct LoadStatus {
+  LoadMap activatedLoads;
+  LoadMap blockedLoads;
+  bool isShed;           // sent for a shed caused by an unstable sample
+  uint32_t isrTimestamp; // latencyNow() when that sample arrived
+};
+
+struct RawSample {
+  uint32_t samples; // FREQUENCY_ANALYSER count for one mains cycle
+  uint32_t isrTimestamp;
+};
+
+static void frequencyAnalyserTask(void *pvParameters);
+static void loadManagerTask(void *pvParameters);
+static void vgaRefreshTask(void *pvParameters);
+static void ledManagerTask(void *pvParameters);
+static void switchPollTask(void *pvParameters);
+static void latencyReportTask(void *pvParameters);
+
+static void pushButtonISR(void *context, alt_u32 id);
+static void frequencyDetectorISR(void *context, alt_u32 id);
+
+/*
+ * Shared state. Everything but the frequency history belongs to
+ * loadManagerTask(), and other tasks post commands to change it and read
+ * snapshots of it, see relay_state.h.
+ *
+ * The frequency history has a single writer, frequencyAnalyserTask(), and is
+ * guarded by a seqlock so that readers never hold it up; take copies with
+ * readFrequencyHistory().
+ */
+struct frequencyHistoryState_t {
+  Seqlock seqlock;
+  volatile uint32_t readRetries; // copies a write overlapped
+  frequency_t freqHistory[FREQUENCY_HISTORY_SIZE];
+  frequency_t freqRocHistory[FREQUENCY_HISTORY_SIZE];
+  int i; // points to the next (oldest) entry to be overwritten
+} frequencyHistoryState;
+
+// how loadManagerTask() sheds, cycled by push button 2
+static volatile ShedMode shedMode = SHED_MODE_DEFAULT;
+
+// raw samples from frequencyDetectorISR() to frequencyAnalyserTask()
+static struct RawSample sampleRingBuffer[SAMPLE_RING_SIZE];
+static SpscRing sampleRing;
+
+/*
+ * Sample ring headroom. Written by frequencyDetectorISR() and read without a
+ * lock, so a report may be a sample out of date.
+ */
+struct sampleRingStats_t {
+  volatile uint32_t sent;
+  volatile uint32_t overflows;
+  volatile uint32_t peakDepth;
+  volatile TickType_t firstOverflowTick;
+} sampleRingStats;
+
+/*
+ * How much work each analyser wakeup does. Written by frequencyAnalyserTask()
+ * only and read without a lock.
+ */
+struct analyserStats_t {
+  volatile uint32_t wakeups; // returns from the ring notification
+  volatile uint32_t batches; // non-empty pops
+  volatile uint32_t samples;
+  volatile uint32_t largestBatch;
+} analyserStats;
+
+/*
+ * Second frame for the VGA pixel buffer. In XY addressing mode a 640x480 frame
+ * of 32-bit pixels is laid out as 512 rows of 1024.
+ */
+#define VGA_FRAME_BYTES (512 * 1024 * 4)
+static uint32_t vgaBackBuffer[VGA_FRAME_BYTES / sizeof(uint32_t)];
+
+/*
+ * Pixels written to the plots per frame. Written by vgaRefreshTask() only and
+ * read without a lock.
+ */
+struct vgaStats_t {
+  volatile uint32_t frames;
+  volatile uint32_t lastFramePixels;
+  volatile uint32_t peakFramePixels;
+  volatile uint64_t totalPixels;
+} vgaStats;
+
+static QueueHandle_t loadControlQueue;
+static QueueHandle_t relayCommandQueue;
+
+static TaskHandle_t frequencyAnalyserTaskHandle;
+static TaskHandle_t loadManagerTaskHandle;
+static TaskHandle_t latencyReportTaskHandle;
+
+#if configSUPPORT_STATIC_ALLOCATION == 1
+/*
+ * Storage for every kernel object the relay creates when built with
+ * LCFR_STATIC_ALLOCATION, sized for exactly what the setup functions below
+ * ask for. Running out is a configASSERT(), not a failed allocation.
+ */
+#if configUSE_TRACE_RECORDER == 1
+#define NUM_OF_TASKS 9
+#else
+#define NUM_OF_TASKS 8
+#endif
+
+static StaticTask_t taskBuffers[NUM_OF_TASKS];
+static StackType_t taskStacks[NUM_OF_TASKS][configMINIMAL_STACK_SIZE];
+static int tasksCreated;
+
+static StaticQueue_t loadControlQueueBuffer;
+static uint8_t loadControlQueueStorage[LOAD_CONTROL_QUEUE_LENGTH *
+                                       sizeof(struct LoadStatus)];
+static StaticQueue_t relayCommandQueueBuffer;
+static uint8_t relayCommandQueueStorage[RELAY_QUEUE_LENGTH *
+                                        sizeof(RelayCommand)];
 
-#define MIN_FREQ 45.0 //minimum frequency to draw
+#if configUSE_TIMERS == 1
+static StaticTimer_t loadManagementTimerBuffer;
+static StaticTask_t timerTaskBuffer;
+static StackType_t timerTaskStack[configTIMER_TASK_STACK_DEPTH];
+#endif
 
-#define PRVGADraw_Task_P      (tskIDLE_PRIORITY+1)
-TaskHandle_t PRVGADraw;
+static StaticTask_t idleTaskBuffer;
+static StackType_t idleTaskStack[configMINIMAL_STACK_SIZE];
 
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint16_t *pusIdleTaskStackSize) {
+  *ppxIdleTaskTCBBuffer = &idleTaskBuffer;
+  *ppxIdleTaskStackBuffer = idleTaskStack;
+  *pusIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
 
-static QueueHandle_t Q_freq_data;
+#if configUSE_TIMERS == 1
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+                                    StackType_t **ppxTimerTaskStackBuffer,
+                                    uint16_t *pusTimerTaskStackSize) {
+  *ppxTimerTaskTCBBuffer = &timerTaskBuffer;
+  *ppxTimerTaskStackBuffer = timerTaskStack;
+  *pusTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
+#endif
 
-typedef struct{
-	unsigned int x1;
-	unsigned int y1;
-	unsigned int x2;
-	unsigned int y2;
-}Line;
+static void createTask(TaskFunction_t code, const char *name,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+#if configSUPPORT_STATIC_ALLOCATION == 1
+  TaskHandle_t created;
 
+  configASSERT(tasksCreated < NUM_OF_TASKS);
+  created = xTaskCreateStatic(code, name, configMINIMAL_STACK_SIZE, NULL,
+                              priority, taskStacks[tasksCreated],
+                              &taskBuffers[tasksCreated]);
+  tasksCreated++;
+  if (handle != NULL) {
+    *handle = created;
+  }
+#else
+  xTaskCreate(code, name, configMINIMAL_STACK_SIZE, NULL, priority, handle);
+#endif
+}
 
-/****** VGA display ******/
+void setupStates() {
+  RelayState initial = {
+      .frequencyThreshold = FREQUENCY_CONSTANT(DEFAULT_FREQUENCY_THRESHOLD),
+      .rocThreshold = FREQUENCY_CONSTANT(DEFAULT_ROC_THRESHOLD),
+      .isStable = true,
+  };
 
-void PRVGADraw_Task(void *pvParameters ){
+  // an unstable edge can reach the owner before switchPollTask() first
+  // posts, and managing loads from no switches would never shed any
+  initial.switches = IORD_ALTERA_AVALON_PIO_DATA(SLIDE_SWITCH_BASE) & LOAD_MASK;
+  initial.activatedLoads = initial.switches;
 
+  seqlockInit(&frequencyHistoryState.seqlock);
+  frequencyHistoryState.i = 0;
 
-	//initialize VGA controllers
-	alt_up_pixel_buffer_dma_dev *pixel_buf;
-	pixel_buf = alt_up_pixel_buffer_dma_open_dev(VIDEO_PIXEL_BUFFER_DMA_NAME);
-	if(pixel_buf == NULL){
-		printf("can't find pixel buffer device\n");
-	}
-	alt_up_pixel_buffer_dma_clear_screen(pixel_buf, 0);
+  relayStateInit(relayCommandQueue, &initial);
+}
 
-	alt_up_char_buffer_dev *char_buf;
-	char_buf = alt_up_char_buffer_open_dev("/dev/video_character_buffer_with_dma");
-	if(char_buf == NULL){
-		printf("can't find char buffer device\n");
-	}
-	alt_up_char_buffer_clear(char_buf);
+void setupQueues() {
+#if configSUPPORT_STATIC_ALLOCATION == 1
+  loadControlQueue =
+      xQueueCreateStatic(LOAD_CONTROL_QUEUE_LENGTH, sizeof(struct LoadStatus),
+                         loadControlQueueStorage, &loadControlQueueBuffer);
+  relayCommandQueue =
+      xQueueCreateStatic(RELAY_QUEUE_LENGTH, sizeof(RelayCommand),
+                         relayCommandQueueStorage, &relayCommandQueueBuffer);
+#else
+  loadControlQueue =
+      xQueueCreate(LOAD_CONTROL_QUEUE_LENGTH, sizeof(struct LoadStatus));
+  relayCommandQueue = xQueueCreate(RELAY_QUEUE_LENGTH, sizeof(RelayCommand));
+#endif
+#if configUSE_TRACE_RECORDER == 1
+  traceRecorderNameQueue(loadControlQueue, "Load Control");
+  traceRecorderNameQueue(relayCommandQueue, "Relay Commands");
+#endif
+  spscRingInit(&sampleRing, sampleRingBuffer, SAMPLE_RING_SIZE,
+               sizeof(struct RawSample));
+}
 
+void setupTimers() {
+  TimerHandle_t loadManagementTimer = NULL;
+
+#if configUSE_HW_LOAD_TIMER == 1
+  // load_timer keeps the deadline, see load_timer.h
+#elif configSUPPORT_STATIC_ALLOCATION == 1
+  loadManagementTimer = xTimerCreateStatic(
+      "Load Management Timer", pdMS_TO_TICKS(LOAD_MANAGEMENT_TIMER_INTERVAL),
+      pdFALSE, NULL, loadTimerCallback, &loadManagementTimerBuffer);
+#else
+  loadManagementTimer = xTimerCreate(
+      "Load Management Timer", pdMS_TO_TICKS(LOAD_MANAGEMENT_TIMER_INTERVAL),
+      pdFALSE, NULL, loadTimerCallback);
+#endif
+  loadTimerInit(loadManagementTimer, LOAD_MANAGEMENT_TIMER_INTERVAL);
+}
+
+void setupTasks() {
+  createTask(frequencyAnalyserTask, "Frequency Analyser Task",
+             FREQUENCY_TASK_PRIORITY, &frequencyAnalyserTaskHandle);
+  spscRingSetConsumer(&sampleRing, frequencyAnalyserTaskHandle);
+  createTask(loadManagerTask, "Load Manager Task", LOAD_MANAGER_TASK_PRIORITY,
+             &loadManagerTaskHandle);
+  relaySetOwner(loadManagerTaskHandle);
+  createTask(vgaRefreshTask, "VGA Display Task", VGA_DISPLAY_TASK_PRIORITY,
+             NULL);
+  createTask(ledManagerTask, "LED Manager Task", LED_MANAGER_TASK_PRIORITY,
+             NULL);
+  createTask(switchPollTask, "Switch Monitor Task",
+             SWITCH_MONITOR_TASK_PRIORITY, NULL);
+  createTask(latencyReportTask, "Latency Report Task",
+             LATENCY_REPORT_TASK_PRIORITY, &latencyReportTaskHandle);
+  createTask(telemetryTask, "Telemetry Task", TELEMETRY_TASK_PRIORITY, NULL);
+  createTask(flashLogTask, "Flash Log Task", FLASH_LOG_TASK_PRIORITY, NULL);
+#if configUSE_TRACE_RECORDER == 1
+  createTask(traceRecorderTask, "Trace Task", TRACE_RECORDER_TASK_PRIORITY,
+             NULL);
+#endif
+}
 
+void setupISRs() {
+  // clears the edge capture register. Writing 1 to bit clears pending
+  // interrupt for corresponding button.
+  IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PUSH_BUTTON_BASE, 0x7);
+  // enable interrupts for all buttons
+  IOWR_ALTERA_AVALON_PIO_IRQ_MASK(PUSH_BUTTON_BASE, 0x7);
 
-	//Set up plot axes
-	alt_up_pixel_buffer_dma_draw_hline(pixel_buf, 100, 590, 200, ((0x3ff << 20) + (0x3ff << 10) + (0x3ff)), 0);
-	alt_up_pixel_buffer_dma_draw_hline(pixel_buf, 100, 590, 300, ((0x3ff << 20) + (0x3ff << 10) + (0x3ff)), 0);
-	alt_up_pixel_buffer_dma_draw_vline(pixel_buf, 100, 50, 200, ((0x3ff << 20) + (0x3ff << 10) + (0x3ff)), 0);
-	alt_up_pixel_buffer_dma_draw_vline(pixel_buf, 100, 220, 300, ((0x3ff << 20) + (0x3ff << 10) + (0x3ff)), 0);
+  IOWR_ALTERA_AVALON_PIO_DATA(RED_LEDS_BASE, 0x0);
+  IOWR_ALTERA_AVALON_PIO_DATA(GREEN_LEDS_BASE, 0x0);
 
-	alt_up_char_buffer_string(char_buf, "Frequency(Hz)", 4, 4);
-	alt_up_char_buffer_string(char_buf, "52", 10, 7);
-	alt_up_char_buffer_string(char_buf, "50", 10, 12);
-	alt_up_char_buffer_string(char_buf, "48", 10, 17);
-	alt_up_char_buffer_string(char_buf, "46", 10, 22);
+  alt_irq_register(PUSH_BUTTON_IRQ, NULL, pushButtonISR);
+  alt_irq_register(FREQUENCY_ANALYSER_IRQ, NULL, frequencyDetectorISR);
+}
 
-	alt_up_char_buffer_string(char_buf, "df/dt(Hz/s)", 4, 26);
-	alt_up_char_buffer_string(char_buf, "60", 10, 28);
-	alt_up_char_buffer_string(char_buf, "30", 10, 30);
-	alt_up_char_buffer_string(char_buf, "0", 10, 32);
-	alt_up_char_buffer_string(char_buf, "-30", 9, 34);
-	alt_up_char_buffer_string(char_buf, "-60", 9, 36);
+static void frequencyAnalyserTask(void *pvParameters) {
+  frequency_t *freq = frequencyHistoryState.freqHistory;
+  frequency_t *dfreq = frequencyHistoryState.freqRocHistory;
+  static struct RawSample batch[SAMPLE_RING_SIZE];
+  uint32_t count, k;
+  uint32_t sinceLogged = 0; // samples since the last TELEMETRY_SAMPLE
+  bool wasStable = true;     // the verdict last queued for loadManagerTask()
+  RelayState state;
+  RelayCommand command = {.type = RELAY_STABILITY};
 
+  while (1) {
+    // take everything pending at once, and sleep until the ISR finds the ring
+    // empty and pushes a sample
+    count = spscRingPopN(&sampleRing, batch, SAMPLE_RING_SIZE);
+    if (count == 0) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      analyserStats.wakeups++;
+      continue;
+    }
 
-	double freq[100], dfreq[100];
-	int i = 99, j = 0;
-	Line line_freq, line_roc;
+    analyserStats.batches++;
+    analyserStats.samples += count;
+    if (count > analyserStats.largestBatch) {
+      analyserStats.largestBatch = count;
+    }
 
-	while(1){
-		printf("reading from queue\n");
-		//receive frequency data from queue
-		while(uxQueueMessagesWaiting( Q_freq_data ) != 0){
-			xQueueReceive( Q_freq_data, freq+i, 0 );
+    relaySnapshot(&state);
 
-			//calculate frequency RoC
+    for (k = 0; k < count; k++) {
+      int i = frequencyHistoryState.i;
+      int previous = (i + FREQUENCY_HISTORY_SIZE - 1) % FREQUENCY_HISTORY_SIZE;
 
-			if(i==0){
-				dfreq[0] = (freq[0]-freq[99]) * 2.0 * freq[0] * freq[99] / (freq[0]+freq[99]);
-			}
-			else{
-				dfreq[i] = (freq[i]-freq[i-1]) * 2.0 * freq[i]* freq[i-1] / (freq[i]+freq[i-1]);
-			}
+      latencyRecord(LATENCY_RECEIVE, batch[k].isrTimestamp);
 
-			if (dfreq[i] > 100.0){
-				dfreq[i] = 100.0;
-			}
+      // nothing in here may block, see seqlock.h
+      seqlockWriteBegin(&frequencyHistoryState.seqlock);
+      freq[i] = frequencyFromSamples(batch[k].samples);
 
+      // calculate frequency RoC
+      dfreq[i] = frequencyRoc(freq[i], freq[previous]);
 
-			i =	++i%100; //point to the next data (oldest) to be overwritten
+      // point to the next data (oldest) to be overwritten
+      frequencyHistoryState.i = (i + 1) % FREQUENCY_HISTORY_SIZE;
+      seqlockWriteEnd(&frequencyHistoryState.seqlock);
 
-		}
-		printf("printing to screen \n");
-		//clear old graph to draw new graph
-		alt_up_pixel_buffer_dma_draw_box(pixel_buf, 101, 0, 639, 199, 0, 0);
-		alt_up_pixel_buffer_dma_draw_box(pixel_buf, 101, 201, 639, 299, 0, 0);
+      bool isStable = freq[i] >= state.frequencyThreshold &&
+                      frequencyAbs(dfreq[i]) <= state.rocThreshold;
+      latencyRecord(LATENCY_DECISION, batch[k].isrTimestamp);
 
-		for(j=0;j<99;++j){ //i here points to the oldest data, j loops through all the data to be drawn on VGA
-			if (((int)(freq[(i+j)%100]) > MIN_FREQ) && ((int)(freq[(i+j+1)%100]) > MIN_FREQ)){
-				//Calculate coordinates of the two data points to draw a line in between
-				//Frequency plot
-				line_freq.x1 = FREQPLT_ORI_X + FREQPLT_GRID_SIZE_X * j;
-				line_freq.y1 = (int)(FREQPLT_ORI_Y - FREQPLT_FREQ_RES * (freq[(i+j)%100] - MIN_FREQ));
+      // a dropped edge is sent again with the next sample
+      if (isStable != wasStable) {
+        command.isStable = isStable;
+        command.isrTimestamp = batch[k].isrTimestamp;
+        if (relayPost(&command)) {
+          telemetryLog(TELEMETRY_FREQUENCY_ANALYSER, TELEMETRY_STABILITY,
+                       isStable, 0, frequencyToQ16(freq[i]),
+                       frequencyToQ16(dfreq[i]));
+          wasStable = isStable;
+        }
+      }
+      // every sample while unstable, for the flash log
+      if (!isStable || ++sinceLogged >= FLASH_LOG_SAMPLE_DECIMATION) {
+        telemetryLog(TELEMETRY_FREQUENCY_ANALYSER, TELEMETRY_SAMPLE, isStable,
+                     0, frequencyToQ16(freq[i]), frequencyToQ16(dfreq[i]));
+        sinceLogged = 0;
+      }
+      if (!state.inMaintenance) {
+        shedEventSample(shedMode, isStable, batch[k].isrTimestamp);
+      }
+    }
+  }
+}
 
-				line_freq.x2 = FREQPLT_ORI_X + FREQPLT_GRID_SIZE_X * (j + 1);
-				line_freq.y2 = (int)(FREQPLT_ORI_Y - FREQPLT_FREQ_RES * (freq[(i+j+1)%100] - MIN_FREQ));
+static uint32_t nowMs() { return xTaskGetTickCount() * portTICK_PERIOD_MS; }
 
-				//Frequency RoC plot
-				line_roc.x1 = ROCPLT_ORI_X + ROCPLT_GRID_SIZE_X * j;
-				line_roc.y1 = (int)(ROCPLT_ORI_Y - ROCPLT_ROC_RES * dfreq[(i+j)%100]);
+/**
+ * Copies the frequency and rate of change of the newest sample. Never holds
+ * up frequencyAnalyserTask(), which must outrank the caller.
+ */
+static void readLatestSample(frequency_t *frequency, frequency_t *roc) {
+  uint32_t sequence;
 
-				line_roc.x2 = ROCPLT_ORI_X + ROCPLT_GRID_SIZE_X * (j + 1);
-				line_roc.y2 = (int)(ROCPLT_ORI_Y - ROCPLT_ROC_RES * dfreq[(i+j+1)%100]);
+  while (1) {
+    sequence = seqlockReadBegin(&frequencyHistoryState.seqlock);
+    int newest = (frequencyHistoryState.i + FREQUENCY_HISTORY_SIZE - 1) %
+                 FREQUENCY_HISTORY_SIZE;
+    *frequency = frequencyHistoryState.freqHistory[newest];
+    *roc = frequencyHistoryState.freqRocHistory[newest];
+    if (!seqlockReadRetry(&frequencyHistoryState.seqlock, sequence)) {
+      return;
+    }
+    frequencyHistoryState.readRetries++;
+  }
+}
 
-				//Draw
-				alt_up_pixel_buffer_dma_draw_line(pixel_buf, line_freq.x1, line_freq.y1, line_freq.x2, line_freq.y2, 0x3ff << 0, 0);
-				alt_up_pixel_buffer_dma_draw_line(pixel_buf, line_roc.x1, line_roc.y1, line_roc.x2, line_roc.y2, 0x3ff << 0, 0);
-			}
-		}
-		vTaskDelay(10);
+/**
+ * Load still to shed to bring the frequency back to nominal, going by how far
+ * below it the latest sample is, less shedKw already shed in this event. The
+ * frequency lags a shed, so the latest sample does not show it yet.
+ */
+static uint32_t estimateDeficitKw(frequency_t deviation, uint32_t shedKw) {
+  uint32_t deficitKw;
 
-	}
+  if (deviation <= 0) {
+    return 0;
+  }
+  deficitKw = (uint32_t)(deviation * SHED_KW_PER_HZ / FREQUENCY_CONSTANT(1));
+  return deficitKw > shedKw ? deficitKw - shedKw : 0;
 }
 
-void freq_relay(){
-	#define SAMPLING_FREQ 16000.0
-	double temp = SAMPLING_FREQ/(double)IORD(FREQUENCY_ANALYSER_BASE, 0);
+/**
+ * Sheds the lowest priority loads, as many as shedMode asks for. The first
+ * decision of an under-frequency event, isFirst, sheds at least one; later
+ * ones in deficit mode shed none once the loads shed cover the deficit.
+ */
+static void shedLoad(RelayState *state, bool isFirst) {
+  uint32_t now = nowMs();
+  LoadMap candidates = loadsPastDwell(
+      state->activatedLoads & ~state->blockedLoads & LOAD_MASK, true, now);
+  ShedMode mode = shedMode;
+  frequency_t frequency, roc;
+  uint32_t deficitKw;
+  LoadMap loads;
 
-	xQueueSendToBackFromISR( Q_freq_data, &temp, pdFALSE );
+  readLatestSample(&frequency, &roc);
+  // how far below nominal the latest sample is
+  frequency_t deviation = FREQUENCY_CONSTANT(NOMINAL_FREQUENCY) - frequency;
 
-	return;
+  switch (mode) {
+  case SHED_MODE_SINGLE:
+    loads = loadsSelectShed(candidates, 0);
+    break;
+  case SHED_MODE_ROC:
+    // the steeper and deeper the fall, the more go at once; the timer
+    // takes the rest one at a time
+    loads = loadsSelectShedCount(
+        candidates, isFirst ? shedTableLoads(roc, deviation) : 1);
+    break;
+  default:
+    // state->blockedLoads holds every load shed in this event
+    deficitKw = estimateDeficitKw(deviation, loadsKw(state->blockedLoads));
+    loads = isFirst || deficitKw != 0 ? loadsSelectShed(candidates, deficitKw)
+                                      : 0;
+    break;
+  }
+
+  if (loads != 0) {
+    state->blockedLoads |= loads;
+    loadsSwitched(loads, now);
+    // frequencyAnalyserTask() outranks this task and follows the same event
+    taskENTER_CRITICAL();
+    shedEventShed(loadsCount(loads));
+    taskEXIT_CRITICAL();
+    telemetryLog(TELEMETRY_LOAD_MANAGER, TELEMETRY_SHED, mode, loadsKw(loads),
+                 (uint32_t)loads, (uint32_t)((uint64_t)loads >> 32));
+#if configUSE_TRACE_RECORDER == 1
+    // keep the trace either side of the first shed of an event
+    if (isFirst) {
+      traceRecorderTrigger(loadsCount(loads));
+    }
+#endif
+  }
 }
 
+/**
+ *	 Find most important load to turn on inside of the shed loads.
+ */
+static void activateLoad(RelayState *state) {
+  uint32_t now = nowMs();
+  LoadMap load =
+      loadsSelectReconnect(loadsPastDwell(state->blockedLoads, false, now));
 
+  if (load != 0) {
+    state->blockedLoads &= ~load;
+    loadsSwitched(load, now);
+    telemetryLog(TELEMETRY_LOAD_MANAGER, TELEMETRY_RECONNECT,
+                 loadIndexOfHighest(load), 0, (uint32_t)load,
+                 (uint32_t)((uint64_t)load >> 32));
+  }
+}
 
-int main()
-{
-	printf("main");
-	Q_freq_data = xQueueCreate( 100, sizeof(double) );
+/**
+ * Push button 0 toggles maintenance, which stops load management and
+ * reconnects every shed load.
+ */
+static void toggleMaintenance(RelayState *state) {
+  if (loadTimerIsActive()) {
+    loadTimerStop();
+  }
 
+  // toggle maintenance state and set managing loads to false
+  state->inMaintenance = !state->inMaintenance;
+  state->isManagingLoads = false;
+  telemetryLog(TELEMETRY_MAINTENANCE, TELEMETRY_MAINTENANCE_TOGGLE,
+               state->inMaintenance, 0, 0, 0);
 
-	alt_irq_register(FREQUENCY_ANALYSER_IRQ, 0, freq_relay);
+  // remove all blocked loads
+  state->blockedLoads = 0;
+}
+
+/**
+ * Takes the loads from the slide switches. While managing, switches can only
+ * turn loads off.
+ */
+static void applySwitches(RelayState *state) {
+  if (!state->isManagingLoads) {
+    state->activatedLoads = state->switches;
+  } else {
+    // only allow loads to be turned off and not on
+    state->activatedLoads &= state->switches;
+    state->blockedLoads &= state->switches;
+  }
+}
 
-	xTaskCreate( PRVGADraw_Task, "DrawTsk", configMINIMAL_STACK_SIZE, NULL, PRVGADraw_Task_P, &PRVGADraw );
+/**
+ * Sheds or reconnects a load as the stability calls for. Sets loads->isShed
+ * and loads->isrTimestamp for the first shed after an unstable sample.
+ * Returns true if load management ended.
+ */
+static bool manageLoads(RelayState *state, struct LoadStatus *loads) {
+  // if timer is active, reset and do no computation
+  if (loadTimerIsActive()) {
+    telemetryLog(TELEMETRY_LOAD_MANAGER, TELEMETRY_TIMER_RESET,
+                 TELEMETRY_RESET_ALREADY_ACTIVE, 0, 0, 0);
+    loadTimerReset();
+    return false;
+  }
 
+  if (!state->isStable) {
+    shedLoad(state, !state->isManagingLoads);
+    state->isManagingLoads = true;
 
+    // the first shed after an unstable sample closes its measurement
+    if (state->hasUnstableSample) {
+      state->hasUnstableSample = false;
+      loads->isShed = true;
+      loads->isrTimestamp = state->unstableTimestamp;
+      latencyRecord(LATENCY_SHED, loads->isrTimestamp);
+    }
 
-	vTaskStartScheduler();
+    telemetryLog(TELEMETRY_LOAD_MANAGER, TELEMETRY_TIMER_RESET,
+                 TELEMETRY_RESET_UNSTABLE, 0, 0, 0);
+    loadTimerReset();
+  } else if (state->isManagingLoads) {
+    activateLoad(state);
 
-	while(1)
+    // reset timer if more loads to unblock, else exit control state
+    if (state->blockedLoads > 0) {
+      telemetryLog(TELEMETRY_LOAD_MANAGER, TELEMETRY_TIMER_RESET,
+                   TELEMETRY_RESET_RECONNECTING, 0, 0, 0);
+      loadTimerReset();
+    } else {
+      telemetryLog(TELEMETRY_LOAD_MANAGER, TELEMETRY_MANAGEMENT_EXIT, 0, 0,
+                   0, 0);
+      state->isManagingLoads = false;
+      return true;
+    }
+  }
+  return false;
+}
 
-  return 0;
+static void applyCommand(RelayState *state, const RelayCommand *command,
+                         struct LoadStatus *loads) {
+  switch (command->type) {
+  case RELAY_STABILITY:
+    state->isStable = command->isStable;
+    if (state->inMaintenance) {
+      break;
+    }
+    if (!command->isStable) {
+      state->hasUnstableSample = true;
+      state->unstableTimestamp = command->isrTimestamp;
+    }
+    // loads switched on while managing were held off until it ended
+    if (manageLoads(state, loads)) {
+      applySwitches(state);
+    }
+    break;
+  case RELAY_TIMER:
+    loadTimerExpired();
+    if (manageLoads(state, loads)) {
+      applySwitches(state);
+    }
+    break;
+  case RELAY_MAINTENANCE:
+    toggleMaintenance(state);
+    applySwitches(state);
+    break;
+  case RELAY_SWITCHES:
+    state->switches = command->switches;
+    applySwitches(state);
+    break;
+  }
 }
 
+/**
+ * Owns the relay state, see relay_state.h. Applies every signal raised and
+ * every command waiting, then publishes the state and sends the loads to the
+ * LEDs once.
+ */
+static void loadManagerTask(void *pvParameters) {
+  RelayState state;
+  RelayCommand command;
+  struct LoadStatus loads;
+
+  relaySnapshot(&state);
+  while (1) {
+    uint32_t signals = relayWait(portMAX_DELAY);
+
+    if (signals == 0) {
+      continue;
+    }
+
+    loads.isShed = false;
+    loads.isrTimestamp = 0;
+    if (signals & RELAY_SIGNAL_MAINTENANCE) {
+      command.type = RELAY_MAINTENANCE;
+      applyCommand(&state, &command, &loads);
+    }
+    if (signals & RELAY_SIGNAL_TIMER) {
+      command.type = RELAY_TIMER;
+      applyCommand(&state, &command, &loads);
+    }
+    while (relayReceive(&command)) {
+      applyCommand(&state, &command, &loads);
+    }
+    relayPublish(&state);
+
+    loads.activatedLoads = state.activatedLoads & ~state.blockedLoads;
+    loads.blockedLoads = state.blockedLoads;
+    xQueueSendToBack(loadControlQueue, &loads, 0);
+  }
+}
+
+static void drawAxes(alt_up_pixel_buffer_dma_dev *pixel_buf, int backbuffer) {
+  alt_up_pixel_buffer_dma_draw_hline(
+      pixel_buf, 100, 590, 200, ((0x3ff << 20) + (0x3ff << 10) + (0x3ff)),
+      backbuffer);
+  alt_up_pixel_buffer_dma_draw_hline(
+      pixel_buf, 100, 590, 300, ((0x3ff << 20) + (0x3ff << 10) + (0x3ff)),
+      backbuffer);
+  alt_up_pixel_buffer_dma_draw_vline(
+      pixel_buf, 100, 50, 200, ((0x3ff << 20) + (0x3ff << 10) + (0x3ff)),
+      backbuffer);
+  alt_up_pixel_buffer_dma_draw_vline(
+      pixel_buf, 100, 220, 300, ((0x3ff << 20) + (0x3ff << 10) + (0x3ff)),
+      backbuffer);
+}
+
+/**
+ * Copies the frequency history and the index of its oldest entry. Never holds
+ * up frequencyAnalyserTask(), which must outrank the caller.
+ */
+static int readFrequencyHistory(frequency_t *freq, frequency_t *dfreq) {
+  uint32_t sequence;
+  int i;
+
+  while (1) {
+    sequence = seqlockReadBegin(&frequencyHistoryState.seqlock);
+    memcpy(freq, frequencyHistoryState.freqHistory,
+           sizeof(frequencyHistoryState.freqHistory));
+    memcpy(dfreq, frequencyHistoryState.freqRocHistory,
+           sizeof(frequencyHistoryState.freqRocHistory));
+    i = frequencyHistoryState.i;
+    if (!seqlockReadRetry(&frequencyHistoryState.seqlock, sequence)) {
+      return i;
+    }
+    frequencyHistoryState.readRetries++;
+  }
+}
+
+/**
+ * Double buffered: each frame is drawn from a snapshot of the history into
+ * the back buffer, which is then swapped in at the next vertical refresh.
+ */
+static void vgaRefreshTask(void *pvParameters) {
+  FILE *console = consoleOpen(CONSOLE_DISPLAY);
+
+  if (console == NULL) {
+    console = stdout;
+  }
+
+  // initialize VGA controllers
+  alt_up_pixel_buffer_dma_dev *pixel_buf;
+  pixel_buf = alt_up_pixel_buffer_dma_open_dev(VIDEO_PIXEL_BUFFER_DMA_NAME);
+  if (pixel_buf == NULL) {
+    fprintf(console, "can't find pixel buffer device\n");
+    fflush(console);
+  }
+  // drawing bypasses the data cache, so write the zeroed .bss lines back
+  // first rather than let them be evicted over the frame later
+  alt_dcache_flush(vgaBackBuffer, sizeof(vgaBackBuffer));
+  alt_up_pixel_buffer_dma_change_back_buffer_address(
+      pixel_buf, (unsigned int)(uintptr_t)vgaBackBuffer);
+  alt_up_pixel_buffer_dma_clear_screen(pixel_buf, 0);
+  alt_up_pixel_buffer_dma_clear_screen(pixel_buf, 1);
+
+  alt_up_char_buffer_dev *char_buf;
+  char_buf =
+      alt_up_char_buffer_open_dev("/dev/video_character_buffer_with_dma");
+  if (char_buf == NULL) {
+    fprintf(console, "can't find char buffer device\n");
+    fflush(console);
+  }
+  alt_up_char_buffer_clear(char_buf);
+
+  // Set up plot axes
+  drawAxes(pixel_buf, 0);
+  drawAxes(pixel_buf, 1);
+
+  alt_up_char_buffer_string(char_buf, "Frequency(Hz)", 4, 4);
+  alt_up_char_buffer_string(char_buf, "52", 10, 7);
+  alt_up_char_buffer_string(char_buf, "50", 10, 12);
+  alt_up_char_buffer_string(char_buf, "48", 10, 17);
+  alt_up_char_buffer_string(char_buf, "46", 10, 22);
+
+  alt_up_char_buffer_string(char_buf, "df/dt(Hz/s)", 4, 26);
+  alt_up_char_buffer_string(char_buf, "60", 10, 28);
+  alt_up_char_buffer_string(char_buf, "30", 10, 30);
+  alt_up_char_buffer_string(char_buf, "0", 10, 32);
+  alt_up_char_buffer_string(char_buf, "-30", 9, 34);
+  alt_up_char_buffer_string(char_buf, "-60", 9, 36);
+
+  static frequency_t freq[FREQUENCY_HISTORY_SIZE];
+  static frequency_t dfreq[FREQUENCY_HISTORY_SIZE];
+  char text[32];
+  int j;
+  RelayState state;
+  // one pair of plots per buffer, the pair in use alternates with each swap
+  static Plot freqPlots[2], rocPlots[2];
+  static PlotSegment freqSegments[FREQUENCY_HISTORY_SIZE - 1];
+  static PlotSegment rocSegments[FREQUENCY_HISTORY_SIZE - 1];
+  int back = 0;
+
+  for (j = 0; j < 2; j++) {
+    plotInit(&freqPlots[j], pixel_buf, 1, FREQPLT_ORI_X, FREQPLT_GRID_SIZE_X,
+             0, 199, 0x3ff << 0, FREQUENCY_HISTORY_SIZE - 1);
+    plotInit(&rocPlots[j], pixel_buf, 1, ROCPLT_ORI_X, ROCPLT_GRID_SIZE_X, 201,
+             299, 0x3ff << 0, FREQUENCY_HISTORY_SIZE - 1);
+  }
+
+  while (1) {
+    int i = readFrequencyHistory(freq, dfreq);
+
+    relaySnapshot(&state);
+
+    alt_up_char_buffer_string(char_buf, "Lower threshold:", 9, 40);
+    snprintf(text, sizeof(text), "%.1f Hz    ",
+             frequencyToDouble(state.frequencyThreshold));
+    alt_up_char_buffer_string(char_buf, text, 28, 40);
+
+    alt_up_char_buffer_string(char_buf, "RoC threshold:", 9, 42);
+    snprintf(text, sizeof(text), "%.1f Hz/sec    ",
+             frequencyToDouble(state.rocThreshold));
+    alt_up_char_buffer_string(char_buf, text, 28, 42);
+
+    alt_up_char_buffer_string(char_buf, "System status", 50, 40);
+    alt_up_char_buffer_string(char_buf,
+                              state.isStable ? "Stable  " : "Unstable",
+                              54, 42);
+
+    // i here points to the oldest data, j loops through all the data to be
+    // drawn on VGA
+    for (j = 0; j < FREQUENCY_HISTORY_SIZE - 1; ++j) {
+      int k1 = (i + j) % FREQUENCY_HISTORY_SIZE;
+      int k2 = (i + j + 1) % FREQUENCY_HISTORY_SIZE;
+      // the plot is the one place the history goes back to floating point
+      double freq1 = frequencyToDouble(freq[k1]);
+      double freq2 = frequencyToDouble(freq[k2]);
+      double roc1 = frequencyToDouble(dfreq[k1]);
+      double roc2 = frequencyToDouble(dfreq[k2]);
+      bool isVisible = ((int)freq1 > MIN_FREQ) && ((int)freq2 > MIN_FREQ);
+
+      plotSegment(freqSegments, j, isVisible,
+                  (int)(FREQPLT_ORI_Y - FREQPLT_FREQ_RES * (freq1 - MIN_FREQ)),
+                  (int)(FREQPLT_ORI_Y - FREQPLT_FREQ_RES * (freq2 - MIN_FREQ)));
+      plotSegment(rocSegments, j, isVisible,
+                  (int)(ROCPLT_ORI_Y - ROCPLT_ROC_RES * roc1),
+                  (int)(ROCPLT_ORI_Y - ROCPLT_ROC_RES * roc2));
+    }
+
+    // only the segments that moved since this buffer was last drawn are
+    // redrawn
+    uint32_t pixels = plotUpdate(&freqPlots[back], freqSegments) +
+                      plotUpdate(&rocPlots[back], rocSegments);
+    vgaStats.frames++;
+    vgaStats.lastFramePixels = pixels;
+    vgaStats.totalPixels += pixels;
+    if (pixels > vgaStats.peakFramePixels) {
+      vgaStats.peakFramePixels = pixels;
+    }
+
+    // the old front buffer is still being scanned out until the swap lands
+    alt_up_pixel_buffer_dma_swap_buffers(pixel_buf);
+    while (alt_up_pixel_buffer_dma_check_swap_buffers_status(pixel_buf)) {
+      vTaskDelay(1);
+    }
+    back = !back;
+
+    vTaskDelay(10);
+  }
+}
+
+static void ledManagerTask(void *pvParameters) {
+  struct LoadStatus loads;
+  while (1) {
+    if (xQueueReceive(loadControlQueue, &loads, portMAX_DELAY) == pdTRUE) {
+      // the LEDs show as many of the first loads as there are LEDs
+      IOWR_ALTERA_AVALON_PIO_DATA(RED_LEDS_BASE,
+                                  (uint32_t)loads.activatedLoads);
+      if (loads.isShed) {
+        latencyRecord(LATENCY_LED_WRITE, loads.isrTimestamp);
+      }
+      IOWR_ALTERA_AVALON_PIO_DATA(GREEN_LEDS_BASE,
+                                  (uint32_t)loads.blockedLoads);
+    }
+  }
+}
+
+/**
+ * Tells loadManagerTask() when the slide switches change, and once at start.
+ */
+static void switchPollTask(void *pvParameters) {
+  RelayCommand command = {.type = RELAY_SWITCHES};
+  bool pending = true;
+
+  while (1) {
+    LoadMap switchValue = IORD_ALTERA_AVALON_PIO_DATA(SLIDE_SWITCH_BASE);
+    switchValue &= LOAD_MASK;
+
+    // a dropped command is sent again on the next poll
+    if (pending || switchValue != command.switches) {
+      command.switches = switchValue;
+      pending = !relayPost(&command);
+    }
+
+    vTaskDelay(100);
+  }
+}
+
+static void pushButtonISR(void *context, alt_u32 id) {
+  unsigned int buttonValue = IORD_ALTERA_AVALON_PIO_EDGE_CAP(PUSH_BUTTON_BASE);
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  // clears the edge capture register
+  IOWR_ALTERA_AVALON_PIO_EDGE_CAP(PUSH_BUTTON_BASE, 0x7);
+
+  // This logic is in place of actual relay for now.
+  if (buttonValue & 0x1) {
+    relaySignalFromISR(RELAY_SIGNAL_MAINTENANCE, &higherPriorityTaskWoken);
+  }
+  if (buttonValue & 0x2) {
+    taskEventsPostFromISR(latencyReportTaskHandle, EVENT_REPORT,
+                          &higherPriorityTaskWoken);
+  }
+  if (buttonValue & 0x4) {
+    shedMode = (shedMode + 1) % SHED_NUM_MODES;
+  }
+
+  portEND_SWITCHING_ISR(higherPriorityTaskWoken);
+}
+
+/**
+ * Only reads the analyser and queues the raw count; frequencyAnalyserTask()
+ * does the conversion.
+ */
+static void frequencyDetectorISR(void *context, alt_u32 id) {
+  struct RawSample sample;
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+  sample.isrTimestamp = latencyNow();
+  sample.samples = IORD(FREQUENCY_ANALYSER_BASE, 0);
+
+  if (!spscRingPushFromISR(&sampleRing, &sample, &higherPriorityTaskWoken)) {
+    if (sampleRingStats.overflows++ == 0) {
+      sampleRingStats.firstOverflowTick = xTaskGetTickCountFromISR();
+    }
+    return;
+  }
+
+  sampleRingStats.sent++;
+  uint32_t depth = spscRingCount(&sampleRing);
+  if (depth > sampleRingStats.peakDepth) {
+    sampleRingStats.peakDepth = depth;
+  }
+
+  portEND_SWITCHING_ISR(higherPriorityTaskWoken);
+}
+
+static void analyserStatsDump(FILE *out) {
+  uint32_t batches = analyserStats.batches;
+
+  fprintf(out,
+          "analyser: %lu wakeups, %lu batches, %.1f samples per batch, "
+          "largest %lu\n",
+          (unsigned long)analyserStats.wakeups, (unsigned long)batches,
+          batches == 0 ? 0.0 : (double)analyserStats.samples / batches,
+          (unsigned long)analyserStats.largestBatch);
+  fprintf(out, "analyser: %lu history reads retried\n",
+          (unsigned long)frequencyHistoryState.readRetries);
+}
+
+#if configSUPPORT_DYNAMIC_ALLOCATION == 1
+/*
+ * The heap as setup left it. Nothing allocates once the scheduler starts, and
+ * the simulator report runs in interrupt context where the heap cannot be
+ * walked, so it prints this instead of reading the heap again.
+ */
+static HeapStats_t heapStatsAtStart;
+
+static void heapStatsDump(FILE *out, const HeapStats_t *stats) {
+  fprintf(out,
+          "heap: %lu of %lu bytes free in %lu blocks, largest %lu, "
+          "high-water mark %lu bytes used\n",
+          (unsigned long)stats->xAvailableHeapSpaceInBytes,
+          (unsigned long)configTOTAL_HEAP_SIZE,
+          (unsigned long)stats->xNumberOfFreeBlocks,
+          (unsigned long)stats->xSizeOfLargestFreeBlockInBytes,
+          (unsigned long)(configTOTAL_HEAP_SIZE -
+                          stats->xMinimumEverFreeBytesRemaining));
+}
+#endif
+
+#if configUSE_TICKLESS_IDLE == 1
+static void ticklessStatsDump(FILE *out) {
+  TicklessStats_t stats;
+  TickType_t ticks = xTaskGetTickCount();
+
+  vPortGetTicklessStats(&stats);
+  fprintf(out,
+          "tickless: %lu sleeps, %lu aborted, %lu of %lu ticks suppressed "
+          "(%.1f%%), longest sleep %lu ticks\n",
+          (unsigned long)stats.ulSleeps, (unsigned long)stats.ulAborted,
+          (unsigned long)stats.ulTicksSuppressed, (unsigned long)ticks,
+          ticks == 0 ? 0.0 : 100.0 * stats.ulTicksSuppressed / ticks,
+          (unsigned long)stats.ulLongestSleep);
+}
+#endif
+
+static void vgaStatsDump(FILE *out) {
+  uint32_t frames = vgaStats.frames;
+
+  fprintf(out,
+          "vga: %lu frames, %.0f pixels per frame, last %lu, peak %lu\n",
+          (unsigned long)frames,
+          frames == 0 ? 0.0 : (double)vgaStats.totalPixels / frames,
+          (unsigned long)vgaStats.lastFramePixels,
+          (unsigned long)vgaStats.peakFramePixels);
+}
+
+/**
+ * Prints each task's CPU time and stack use every TASK_STATS_PERIOD_MS. When
+ * push button 1 is pressed, also prints the shed latency histograms, the CPU
+ * utilisation, the ticks tickless idle suppressed, the load management
+ * deadline lateness, the VGA pixel counts, the time-to-stable of each shed
+ * mode, the task event signalling costs, the telemetry, flash log, console
+ * and trace recorder counts and the heap fragmentation.
+ * Everything goes out through the console, see console.h.
+ */
+static void latencyReportTask(void *pvParameters) {
+  CpuLoad load;
+#if configSUPPORT_DYNAMIC_ALLOCATION == 1
+  HeapStats_t heapStats;
+#endif
+  FILE *out = consoleOpen(CONSOLE_REPORT);
+
+  if (out == NULL) {
+    out = stdout;
+  }
+
+  while (1) {
+    uint32_t events = taskEventsWait(pdMS_TO_TICKS(TASK_STATS_PERIOD_MS));
+
+    taskStatsSample();
+    taskStatsDump(out);
+    if (events & EVENT_REPORT) {
+      latencyDump(out);
+      cpuLoadGet(&load);
+      cpuLoadDump(out, &load);
+#if configUSE_TICKLESS_IDLE == 1
+      ticklessStatsDump(out);
+#endif
+      analyserStatsDump(out);
+      relayStateDump(out);
+      loadTimerDump(out);
+      vgaStatsDump(out);
+      shedStatsDump(out, shedMode);
+      taskEventsDump(out);
+      telemetryDump(out);
+      flashLogDump(out);
+      consoleDump(out);
+#if configUSE_TRACE_RECORDER == 1
+      traceRecorderDump(out);
+#endif
+#if configSUPPORT_DYNAMIC_ALLOCATION == 1
+      vPortGetHeapStats(&heapStats);
+      heapStatsDump(out, &heapStats);
+#endif
+    }
+    fflush(out);
+  }
+}
+
+#ifdef LCFR_POSIX_GCC
+void vApplicationSimReport(void) {
+  CpuLoad load;
+
+  fprintf(stderr,
+          "[lcfr] sample ring: %lu queued, %lu overflowed, peak depth "
+          "%lu/%d",
+          (unsigned long)sampleRingStats.sent,
+          (unsigned long)sampleRingStats.overflows,
+          (unsigned long)sampleRingStats.peakDepth, SAMPLE_RING_SIZE);
+  if (sampleRingStats.overflows != 0) {
+    fprintf(stderr, ", first overflow at tick %lu",
+            (unsigned long)sampleRingStats.firstOverflowTick);
+  }
+  fprintf(stderr, "\n");
+
+  if (ullSimTraceNs() != 0) {
+    fprintf(stderr, "[lcfr] frequency analyser absorbed %.1f samples/s\n",
+            sampleRingStats.sent * 1e9 / (double)ullSimTraceNs());
+  }
+
+  latencyDump(stderr);
+  cpuLoadGetFromISR(&load);
+  cpuLoadDump(stderr, &load);
+#if configUSE_TICKLESS_IDLE == 1
+  ticklessStatsDump(stderr);
+#endif
+  analyserStatsDump(stderr);
+  relayStateDump(stderr);
+  loadTimerDump(stderr);
+  vgaStatsDump(stderr);
+  shedStatsDump(stderr, shedMode);
+  taskEventsDump(stderr);
+  telemetryDump(stderr);
+  flashLogDump(stderr);
+  consoleDump(stderr);
+#if configUSE_TRACE_RECORDER == 1
+  traceRecorderDump(stderr);
+#endif
+#if configSUPPORT_DYNAMIC_ALLOCATION == 1
+  heapStatsDump(stderr, &heapStatsAtStart);
+#endif
+  taskStatsDump(stderr);
+}
+#endif
+
+#ifdef LCFR_POSIX_GCC
+static int telemetryFd = -1;
+static int traceFd = -1;
+#endif
+
+/**
+ * Keeps every telemetry frame's records in the flash log, and writes the
+ * frame to the console, or on the host to the LCFR_SIM_TELEMETRY file if
+ * there is one.
+ */
+static bool telemetryOut(const void *frame, size_t size) {
+  const TelemetryFrameHeader *header = frame;
+
+  flashLogWrite((const TelemetryRecord *)(header + 1), header->count);
+#ifdef LCFR_POSIX_GCC
+  return telemetryFd >= 0 && write(telemetryFd, frame, size) == (ssize_t)size;
+#else
+  return consoleWrite(CONSOLE_TELEMETRY, frame, size);
+#endif
+}
+
+#if configUSE_TRACE_RECORDER == 1
+/**
+ * Writes a trace recorder frame to the console, or on the host to the
+ * LCFR_SIM_RECORDER file.
+ */
+static bool traceOut(const void *frame, size_t size) {
+#ifdef LCFR_POSIX_GCC
+  return write(traceFd, frame, size) == (ssize_t)size;
+#else
+  return consoleWrite(CONSOLE_TRACE, frame, size);
+#endif
+}
+#endif
+
+int main() {
+#ifdef LCFR_POSIX_GCC
+  // the host build picks the shed mode per run, see host/readme.txt
+  const char *mode = getenv("LCFR_SHED_MODE");
+  ShedMode parsed;
+
+  if (mode != NULL) {
+    if (!shedModeParse(mode, &parsed)) {
+      fprintf(stderr, "unknown LCFR_SHED_MODE %s\n", mode);
+      return EXIT_FAILURE;
+    }
+    shedMode = parsed;
+  }
+
+  // and writes telemetry to a file rather than the simulated UART
+  const char *telemetryPath = getenv("LCFR_SIM_TELEMETRY");
+
+  if (telemetryPath != NULL) {
+    telemetryFd = open(telemetryPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (telemetryFd < 0) {
+      perror(telemetryPath);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // and the trace recorder's dumps, which are otherwise discarded
+  const char *tracePath = getenv("LCFR_SIM_RECORDER");
+
+  if (tracePath != NULL) {
+    traceFd = open(tracePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (traceFd < 0) {
+      perror(tracePath);
+      return EXIT_FAILURE;
+    }
+  }
+#endif
+
+  latencyInit();
+  consoleInit();
+  flashLogInit();
+  telemetryInit(telemetryOut);
+#if configUSE_TRACE_RECORDER == 1
+#ifdef LCFR_POSIX_GCC
+  traceRecorderInit(traceFd >= 0 ? traceOut : NULL);
+#else
+  traceRecorderInit(traceOut);
+#endif
+#endif
+  loadsInit();
+  setupQueues();
+  setupStates();
+  setupTimers();
+  setupTasks();
+  setupISRs();
+#if configSUPPORT_DYNAMIC_ALLOCATION == 1
+  vPortGetHeapStats(&heapStatsAtStart);
+#endif
+
+  vTaskStartScheduler();
+
+  while (true)
+    ;
+}
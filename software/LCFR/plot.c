@@ -0,0 +1,74 @@
+#include "plot.h"
+
+#include <stdlib.h>
+
+static int clamp(int y, int top, int bottom) {
+  return y < top ? top : (y > bottom ? bottom : y);
+}
+
+static bool sameSegment(const PlotSegment *a, const PlotSegment *b) {
+  return a->isVisible == b->isVisible && a->y1 == b->y1 && a->y2 == b->y2;
+}
+
+// draws segment j and returns the pixels written, one per step of the longer
+// axis as in the driver's Bresenham walk
+static uint32_t drawSegment(const Plot *plot, int j, const PlotSegment *segment,
+                            int colour) {
+  int x1 = plot->originX + plot->gridSizeX * j;
+  int x2 = x1 + plot->gridSizeX;
+  int dy = abs(segment->y2 - segment->y1);
+
+  alt_up_pixel_buffer_dma_draw_line(plot->pixelBuffer, x1, segment->y1, x2,
+                                    segment->y2, colour, plot->backbuffer);
+  return (uint32_t)(dy > plot->gridSizeX ? dy : plot->gridSizeX) + 1;
+}
+
+void plotInit(Plot *plot, alt_up_pixel_buffer_dma_dev *pixelBuffer,
+              int backbuffer, int originX, int gridSizeX, int top, int bottom,
+              int colour, int numSegments) {
+  int j;
+
+  plot->pixelBuffer = pixelBuffer;
+  plot->backbuffer = backbuffer;
+  plot->originX = originX;
+  plot->gridSizeX = gridSizeX;
+  plot->top = top;
+  plot->bottom = bottom;
+  plot->colour = colour;
+  plot->numSegments =
+      numSegments < PLOT_MAX_SEGMENTS ? numSegments : PLOT_MAX_SEGMENTS;
+  for (j = 0; j < PLOT_MAX_SEGMENTS; j++) {
+    plotSegment(plot->drawn, j, false, 0, 0);
+  }
+}
+
+uint32_t plotUpdate(Plot *plot, const PlotSegment *next) {
+  bool erased[PLOT_MAX_SEGMENTS + 2] = {false}; // offset by one, for j +/- 1
+  PlotSegment segment;
+  uint32_t pixels = 0;
+  int j;
+
+  for (j = 0; j < plot->numSegments; j++) {
+    segment = next[j];
+    segment.y1 = clamp(segment.y1, plot->top, plot->bottom);
+    segment.y2 = clamp(segment.y2, plot->top, plot->bottom);
+    if (!sameSegment(&plot->drawn[j], &segment) && plot->drawn[j].isVisible) {
+      pixels += drawSegment(plot, j, &plot->drawn[j], 0);
+      erased[j + 1] = true;
+    }
+  }
+
+  for (j = 0; j < plot->numSegments; j++) {
+    segment = next[j];
+    segment.y1 = clamp(segment.y1, plot->top, plot->bottom);
+    segment.y2 = clamp(segment.y2, plot->top, plot->bottom);
+    if (segment.isVisible &&
+        (!sameSegment(&plot->drawn[j], &segment) || erased[j] ||
+         erased[j + 2])) {
+      pixels += drawSegment(plot, j, &segment, plot->colour);
+    }
+    plot->drawn[j] = segment;
+  }
+
+  return pixels;
+}
@@ -0,0 +1,71 @@
+#ifndef PLOT_H
+#define PLOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "altera_up_avalon_video_pixel_buffer_dma.h"
+
+/*
+ * Incremental polyline renderer for the VGA plots.
+ *
+ * A plot remembers the segments it last drew. Each update erases only the
+ * segments whose end points moved and draws only their replacements, instead
+ * of clearing the plot area and redrawing everything. Neighbouring segments
+ * share an end column, so an unchanged neighbour of an erased segment is drawn
+ * again to repair it. Segments never overlap otherwise, as each one spans its
+ * own gridSizeX columns.
+ *
+ * Pixel writes go uncached to SDRAM and compete with the CPU for the bus, so
+ * every update returns how many pixels it wrote.
+ */
+
+#define PLOT_MAX_SEGMENTS 128
+
+typedef struct {
+  int y1; // left end, clamped to the plot area
+  int y2; // right end
+  bool isVisible;
+} PlotSegment;
+
+typedef struct {
+  alt_up_pixel_buffer_dma_dev *pixelBuffer;
+  int backbuffer; // as for the driver's draw calls
+  int originX; // x of the left end of the first segment
+  int gridSizeX;
+  int top;
+  int bottom;
+  int colour;
+  int numSegments;
+  PlotSegment drawn[PLOT_MAX_SEGMENTS];
+} Plot;
+
+/**
+ * Sets up an empty plot of numSegments segments between rows top and bottom,
+ * inclusive. The area must already be clear.
+ *
+ * A plot tracks what is on one frame, so with double buffering each buffer
+ * needs its own Plot, used while that buffer is the back buffer.
+ */
+void plotInit(Plot *plot, alt_up_pixel_buffer_dma_dev *pixelBuffer,
+              int backbuffer, int originX, int gridSizeX, int top, int bottom,
+              int colour, int numSegments);
+
+/**
+ * Sets segment j to run from y1 to y2, or hides it. Takes effect on the next
+ * plotUpdate().
+ */
+static inline void plotSegment(PlotSegment *segments, int j, bool isVisible,
+                               int y1, int y2) {
+  segments[j].isVisible = isVisible;
+  segments[j].y1 = isVisible ? y1 : 0;
+  segments[j].y2 = isVisible ? y2 : 0;
+}
+
+/**
+ * Brings the screen from the drawn segments to next, numSegments long, and
+ * returns the number of pixels written.
+ */
+uint32_t plotUpdate(Plot *plot, const PlotSegment *next);
+
+#endif /* PLOT_H */
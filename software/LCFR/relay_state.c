@@ -0,0 +1,183 @@
+#include "relay_state.h"
+
+#include "latency.h"
+#include "task_events.h"
+
+static QueueHandle_t commandQueue;
+static TaskHandle_t ownerTask;
+
+static RelayState slots[2];
+static volatile uint32_t published; // version of the newest snapshot
+
+// set by the owner from the first signal it takes until it publishes
+static volatile bool updating;
+
+/*
+ * The owner records what it receives and publishes. Tasks record their posts
+ * and reads in a critical section, and ISRs, which do not nest, record
+ * theirs without one. All of it is read without a lock.
+ */
+static struct relayStats_t {
+  volatile uint32_t posts;
+  volatile uint32_t isrPosts;
+  volatile uint32_t dropped;
+  volatile uint32_t isrDropped;
+  volatile uint32_t signals;
+  volatile uint32_t isrSignals;
+  volatile uint32_t received;
+  volatile uint64_t totalLatency; // timestamp ticks from post to receive
+  volatile uint32_t worstLatency;
+  volatile uint32_t reads;
+  volatile uint32_t readRetries;
+  volatile uint32_t readsDuringUpdate;
+  volatile uint32_t postsDuringUpdate;
+} relayStats;
+
+void relayStateInit(QueueHandle_t queue, const RelayState *initial) {
+  RelayState state = *initial;
+
+  commandQueue = queue;
+  relayPublish(&state);
+}
+
+void relaySetOwner(TaskHandle_t owner) { ownerTask = owner; }
+
+bool relayPost(RelayCommand *command) {
+  bool duringUpdate = updating;
+
+  command->posted = latencyNow();
+  bool sent = xQueueSendToBack(commandQueue, command, 0) == pdTRUE;
+
+  if (sent) {
+    taskEventsPost(ownerTask, RELAY_SIGNAL_COMMAND);
+  }
+  taskENTER_CRITICAL();
+  relayStats.posts++;
+  if (!sent) {
+    relayStats.dropped++;
+  }
+  if (duringUpdate) {
+    relayStats.postsDuringUpdate++;
+  }
+  taskEXIT_CRITICAL();
+  return sent;
+}
+
+bool relayPostFromISR(RelayCommand *command,
+                      BaseType_t *higherPriorityTaskWoken) {
+  command->posted = latencyNow();
+  bool sent = xQueueSendToBackFromISR(commandQueue, command,
+                                      higherPriorityTaskWoken) == pdTRUE;
+
+  if (sent) {
+    taskEventsPostFromISR(ownerTask, RELAY_SIGNAL_COMMAND,
+                          higherPriorityTaskWoken);
+  }
+  relayStats.isrPosts++;
+  if (!sent) {
+    relayStats.isrDropped++;
+  }
+  return sent;
+}
+
+void relaySignal(uint32_t signals) {
+  taskEventsPost(ownerTask, signals);
+
+  taskENTER_CRITICAL();
+  relayStats.signals++;
+  taskEXIT_CRITICAL();
+}
+
+void relaySignalFromISR(uint32_t signals,
+                        BaseType_t *higherPriorityTaskWoken) {
+  taskEventsPostFromISR(ownerTask, signals, higherPriorityTaskWoken);
+  relayStats.isrSignals++;
+}
+
+uint32_t relayWait(TickType_t timeout) {
+  uint32_t signals = taskEventsWait(timeout);
+
+  if (signals != 0) {
+    updating = true;
+  }
+  return signals;
+}
+
+bool relayReceive(RelayCommand *command) {
+  if (xQueueReceive(commandQueue, command, 0) != pdTRUE) {
+    return false;
+  }
+
+  uint32_t latency = latencyNow() - command->posted;
+
+  relayStats.received++;
+  relayStats.totalLatency += latency;
+  if (latency > relayStats.worstLatency) {
+    relayStats.worstLatency = latency;
+  }
+  return true;
+}
+
+void relayPublish(RelayState *state) {
+  uint32_t version = published + 1;
+
+  // the slot readers of the newest snapshot are not using
+  state->version = version;
+  slots[version & 1] = *state;
+  __atomic_store_n(&published, version, __ATOMIC_RELEASE);
+
+  updating = false;
+}
+
+void relaySnapshot(RelayState *state) {
+  bool duringUpdate = updating;
+  uint32_t retries = 0;
+  uint32_t version;
+
+  while (1) {
+    version = __atomic_load_n(&published, __ATOMIC_ACQUIRE);
+    *state = slots[version & 1];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    // the slot is only written again by the second publication after it
+    if (__atomic_load_n(&published, __ATOMIC_RELAXED) - version < 2) {
+      break;
+    }
+    retries++;
+  }
+
+  taskENTER_CRITICAL();
+  relayStats.reads++;
+  relayStats.readRetries += retries;
+  if (duringUpdate) {
+    relayStats.readsDuringUpdate++;
+  }
+  taskEXIT_CRITICAL();
+}
+
+void relayStateDump(FILE *out) {
+  uint32_t received = relayStats.received;
+  double ticksPerUs = alt_timestamp_freq() / 1e6;
+
+  fprintf(out,
+          "relay: %lu commands from tasks and %lu from isrs, %lu dropped; "
+          "%lu applied; %lu signals from tasks and %lu from isrs\n",
+          (unsigned long)relayStats.posts, (unsigned long)relayStats.isrPosts,
+          (unsigned long)(relayStats.dropped + relayStats.isrDropped),
+          (unsigned long)received, (unsigned long)relayStats.signals,
+          (unsigned long)relayStats.isrSignals);
+  if (ticksPerUs > 0) {
+    fprintf(out, "relay: command latency %.1f us mean, %.1f us worst\n",
+            received == 0 ? 0.0
+                          : relayStats.totalLatency / ticksPerUs / received,
+            relayStats.worstLatency / ticksPerUs);
+  }
+  fprintf(out,
+          "relay: snapshot version %lu, %lu reads, %lu retried; %lu lock "
+          "waits saved (%lu reads and %lu posts during an update)\n",
+          (unsigned long)published, (unsigned long)relayStats.reads,
+          (unsigned long)relayStats.readRetries,
+          (unsigned long)(relayStats.readsDuringUpdate +
+                          relayStats.postsDuringUpdate),
+          (unsigned long)relayStats.readsDuringUpdate,
+          (unsigned long)relayStats.postsDuringUpdate);
+}
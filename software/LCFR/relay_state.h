@@ -0,0 +1,146 @@
+#ifndef RELAY_STATE_H
+#define RELAY_STATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/queue.h"
+#include "FreeRTOS/task.h"
+
+#include "frequency.h"
+#include "loads.h"
+
+/*
+ * The relay's state, owned by one task.
+ *
+ * Only the owner changes the state. Every other task and ISR asks it to with
+ * a RelayCommand posted to its queue, which never blocks. A post to a full
+ * queue is dropped, so the load management deadline and the maintenance
+ * button, which are sent once and never again, do not queue: they raise a
+ * RelaySignal bit in the owner's task notification value instead (see
+ * task_events.h), which cannot overflow. The owner applies every signal
+ * raised and then every command waiting, then publishes a copy of the state
+ * with relayPublish(). Readers take a copy with relaySnapshot(), so no task
+ * ever waits on a lock to read or change the state.
+ *
+ * A snapshot is published into whichever of two slots the last one did not
+ * use. A reader that outranks the owner always copies a complete snapshot.
+ * A lower priority reader whose copy is overwritten by two later
+ * publications takes it again, and the owner, which outranks it, is done by
+ * then.
+ *
+ * relayStateDump() counts the lock waits this saves: reads and posts made
+ * while the owner was part way through applying commands. Under a mutex per
+ * part of the state, each of those would have waited for the owner.
+ */
+
+#define RELAY_QUEUE_LENGTH 16
+
+typedef struct {
+  uint32_t version;  // publications up to and including this one
+  LoadMap switches;  // slide switches as last posted
+  LoadMap activatedLoads;
+  LoadMap blockedLoads; // shed
+  frequency_t frequencyThreshold;
+  frequency_t rocThreshold;
+  bool isStable;
+  bool inMaintenance;
+  bool isManagingLoads;
+  bool hasUnstableSample; // unstableTimestamp waiting for its shed
+  uint32_t unstableTimestamp;
+} RelayState;
+
+typedef enum {
+  RELAY_STABILITY,   // the analyser's verdict changed
+  RELAY_TIMER,       // the load management timer expired, signalled
+  RELAY_MAINTENANCE, // push button 0 toggled maintenance, signalled
+  RELAY_SWITCHES,    // the slide switches changed
+} RelayCommandType;
+
+/*
+ * Bits of the owner's task notification value. A signal raised again before
+ * the owner takes it is taken once.
+ */
+#define RELAY_SIGNAL_COMMAND 0x01     // a command was queued
+#define RELAY_SIGNAL_TIMER 0x02       // applied as a RELAY_TIMER
+#define RELAY_SIGNAL_MAINTENANCE 0x04 // applied as a RELAY_MAINTENANCE
+
+typedef struct {
+  RelayCommandType type;
+  bool isStable;         // RELAY_STABILITY
+  uint32_t isrTimestamp; // RELAY_STABILITY, of the sample that changed it
+  LoadMap switches;      // RELAY_SWITCHES
+  uint32_t posted;       // latencyNow(), set when posted
+} RelayCommand;
+
+/**
+ * Takes queue, created for RELAY_QUEUE_LENGTH RelayCommands, as the owner's
+ * queue and publishes initial as the first snapshot.
+ */
+void relayStateInit(QueueHandle_t queue, const RelayState *initial);
+
+/**
+ * Sets the task that owns the state, which is signalled with each post.
+ * Call before the scheduler starts.
+ */
+void relaySetOwner(TaskHandle_t owner);
+
+/**
+ * Posts command to the owner. Returns false, and drops it, if the queue is
+ * full. Never blocks.
+ */
+bool relayPost(RelayCommand *command);
+
+/**
+ * Posts command to the owner from an ISR. higherPriorityTaskWoken is set as
+ * for xQueueSendToBackFromISR(). ISRs must not nest.
+ */
+bool relayPostFromISR(RelayCommand *command,
+                      BaseType_t *higherPriorityTaskWoken);
+
+/**
+ * Raises signals, RELAY_SIGNAL_TIMER or RELAY_SIGNAL_MAINTENANCE, to the
+ * owner. Never blocks and is never dropped.
+ */
+void relaySignal(uint32_t signals);
+
+/**
+ * Raises signals to the owner from an ISR. higherPriorityTaskWoken is set as
+ * for xTaskNotifyFromISR(). ISRs must not nest.
+ */
+void relaySignalFromISR(uint32_t signals,
+                        BaseType_t *higherPriorityTaskWoken);
+
+/**
+ * Waits up to timeout for signals, and returns and clears them, or returns 0
+ * if none came. Called by the owner only, which applies the signals, then
+ * every command relayReceive() returns, then must relayPublish().
+ */
+uint32_t relayWait(TickType_t timeout);
+
+/**
+ * Takes the next command waiting, or returns false if there is none. Called
+ * by the owner only.
+ */
+bool relayReceive(RelayCommand *command);
+
+/**
+ * Sets state's version and publishes a copy of it. Called by the owner only.
+ */
+void relayPublish(RelayState *state);
+
+/**
+ * Copies the newest snapshot into state. Called from tasks.
+ */
+void relaySnapshot(RelayState *state);
+
+/**
+ * Prints the commands posted and dropped, the signals raised, the commands'
+ * latency to the owner, the snapshots published and read and the lock waits
+ * saved.
+ */
+void relayStateDump(FILE *out);
+
+#endif /* RELAY_STATE_H */
@@ -0,0 +1,53 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Sequence lock for state with one writer and any number of readers.
+ *
+ * The writer never waits: it makes the sequence odd, updates the state and
+ * makes it even again. A reader copies the state between seqlockReadBegin()
+ * and seqlockReadRetry() and starts over if the sequence was odd or moved in
+ * between, so it only ever keeps a copy no write overlapped.
+ *
+ * The writer must not block between seqlockWriteBegin() and seqlockWriteEnd(),
+ * and readers must not outrank it. Otherwise a reader could preempt a write
+ * half way through and retry until the writer gets to run again, which it
+ * never would.
+ */
+
+typedef struct {
+  uint32_t sequence;
+} Seqlock;
+
+static inline void seqlockInit(Seqlock *lock) { lock->sequence = 0; }
+
+static inline void seqlockWriteBegin(Seqlock *lock) {
+  __atomic_store_n(&lock->sequence, lock->sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seqlockWriteEnd(Seqlock *lock) {
+  __atomic_store_n(&lock->sequence, lock->sequence + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Returns the sequence to pass to seqlockReadRetry() once the copy is taken.
+ */
+static inline uint32_t seqlockReadBegin(const Seqlock *lock) {
+  return __atomic_load_n(&lock->sequence, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * True if a write overlapped the copy taken since seqlockReadBegin() returned
+ * sequence, and the copy has to be taken again.
+ */
+static inline bool seqlockReadRetry(const Seqlock *lock, uint32_t sequence) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return (sequence & 1) != 0 ||
+         __atomic_load_n(&lock->sequence, __ATOMIC_RELAXED) != sequence;
+}
+
+#endif /* SEQLOCK_H */
@@ -0,0 +1,141 @@
+#include "shedding.h"
+
+#include <string.h>
+
+#include "sys/alt_timestamp.h"
+
+static const char *const modeNames[SHED_NUM_MODES] = {"single", "deficit",
+                                                      "roc"};
+
+/*
+ * Rows go with rocEdges and columns with deviationEdges. The first RoC edge
+ * past 0 is the default RoC threshold, so a sample that is unstable on RoC
+ * alone sheds at least one load more than the frequency threshold would.
+ */
+ShedTable shedTable = {
+    .rocEdges = {FREQUENCY_CONSTANT(0), FREQUENCY_CONSTANT(8),
+                 FREQUENCY_CONSTANT(15), FREQUENCY_CONSTANT(25)},
+    .deviationEdges = {FREQUENCY_CONSTANT(0), FREQUENCY_CONSTANT(0.5),
+                       FREQUENCY_CONSTANT(1), FREQUENCY_CONSTANT(2)},
+    .loads = {{1, 1, 2, 3}, {2, 2, 3, 4}, {3, 3, 4, 5}, {4, 4, 5, 5}},
+};
+
+struct shedStats_t {
+  volatile uint32_t events;
+  volatile uint32_t stabilised; // events that reached the stable state
+  volatile uint32_t loadsShed;
+  // time-to-stable of the stabilised events, in timestamp ticks
+  volatile uint64_t totalTicks;
+  volatile uint32_t worstTicks;
+};
+
+static struct shedStats_t shedStats[SHED_NUM_MODES];
+
+// the event in progress
+static struct {
+  bool isOpen;
+  ShedMode mode;
+  uint32_t start;
+  uint32_t stableSince;
+  uint32_t stableSamples;
+} event;
+
+const char *shedModeName(ShedMode mode) {
+  return mode < SHED_NUM_MODES ? modeNames[mode] : "?";
+}
+
+bool shedModeParse(const char *name, ShedMode *mode) {
+  int i;
+
+  for (i = 0; i < SHED_NUM_MODES; i++) {
+    if (strcmp(name, modeNames[i]) == 0) {
+      *mode = (ShedMode)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static int bandOf(const frequency_t *edges, int bands, frequency_t value) {
+  int band = 0;
+
+  while (band + 1 < bands && value >= edges[band + 1]) {
+    band++;
+  }
+  return band;
+}
+
+uint32_t shedTableLoads(frequency_t roc, frequency_t deviation) {
+  int row = bandOf(shedTable.rocEdges, SHED_ROC_BANDS, -roc);
+  int column =
+      bandOf(shedTable.deviationEdges, SHED_DEVIATION_BANDS, deviation);
+
+  return shedTable.loads[row][column];
+}
+
+void shedEventSample(ShedMode mode, bool isStable, uint32_t timestamp) {
+  if (!event.isOpen) {
+    if (!isStable) {
+      event.isOpen = true;
+      event.mode = mode;
+      event.start = timestamp;
+      event.stableSamples = 0;
+      shedStats[mode].events++;
+    }
+    return;
+  }
+
+  if (!isStable) {
+    event.stableSamples = 0;
+    return;
+  }
+  if (event.stableSamples++ == 0) {
+    event.stableSince = timestamp;
+  }
+  if (event.stableSamples == SHED_STABLE_SAMPLES) {
+    struct shedStats_t *stats = &shedStats[event.mode];
+    uint32_t ticks = event.stableSince - event.start;
+
+    event.isOpen = false;
+    stats->stabilised++;
+    stats->totalTicks += ticks;
+    if (ticks > stats->worstTicks) {
+      stats->worstTicks = ticks;
+    }
+  }
+}
+
+void shedEventShed(uint32_t loads) {
+  if (event.isOpen) {
+    shedStats[event.mode].loadsShed += loads;
+  }
+}
+
+void shedStatsDump(FILE *out, ShedMode mode) {
+  double ticksPerMs = alt_timestamp_freq() / 1e3;
+  int i;
+
+  fprintf(out, "shed: %s mode\n", shedModeName(mode));
+  for (i = 0; i < SHED_NUM_MODES; i++) {
+    struct shedStats_t *stats = &shedStats[i];
+    uint32_t events = stats->events;
+    uint32_t stabilised = stats->stabilised;
+
+    if (events == 0) {
+      continue;
+    }
+    fprintf(out, "shed: %-7s %lu events, %.1f loads shed per event",
+            modeNames[i], (unsigned long)events,
+            (double)stats->loadsShed / events);
+    if (stabilised != 0 && ticksPerMs > 0) {
+      fprintf(out, ", time-to-stable %.1f ms mean, %.1f ms worst",
+              stats->totalTicks / ticksPerMs / stabilised,
+              stats->worstTicks / ticksPerMs);
+    }
+    if (stabilised != events) {
+      fprintf(out, ", %lu not stable yet",
+              (unsigned long)(events - stabilised));
+    }
+    fprintf(out, "\n");
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef SHEDDING_H
+#define SHEDDING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "frequency.h"
+
+/*
+ * How many loads the relay sheds per decision, and how long each
+ * under-frequency event takes to settle.
+ *
+ * The first decision of an event comes from the unstable sample itself; while
+ * the frequency stays unstable the load management timer makes one more
+ * decision every period.
+ */
+
+typedef enum {
+  SHED_MODE_SINGLE,  // one load per decision
+  SHED_MODE_DEFICIT, // loads covering the kW deficit below nominal
+  SHED_MODE_ROC,     // shedTable loads in the first decision, then one
+  SHED_NUM_MODES
+} ShedMode;
+
+#ifndef SHED_MODE_DEFAULT
+#define SHED_MODE_DEFAULT SHED_MODE_DEFICIT
+#endif
+
+/**
+ * Name of mode as accepted by shedModeParse().
+ */
+const char *shedModeName(ShedMode mode);
+
+/**
+ * Sets *mode from its name, "single", "deficit" or "roc". Returns false and
+ * leaves *mode alone if name is none of them.
+ */
+bool shedModeParse(const char *name, ShedMode *mode);
+
+/*
+ * Loads to shed in the first decision of an SHED_MODE_ROC event. A value
+ * falls in the last band whose edge it reaches; the first edges are 0, so
+ * anything not falling, or not below nominal, is in band 0.
+ */
+#define SHED_ROC_BANDS 4
+#define SHED_DEVIATION_BANDS 4
+
+typedef struct {
+  frequency_t rocEdges[SHED_ROC_BANDS];             // Hz/s falling
+  frequency_t deviationEdges[SHED_DEVIATION_BANDS]; // Hz below nominal
+  uint8_t loads[SHED_ROC_BANDS][SHED_DEVIATION_BANDS];
+} ShedTable;
+
+extern ShedTable shedTable;
+
+/**
+ * Loads shedTable gives for a rate of change and a frequency below nominal by
+ * deviation.
+ */
+uint32_t shedTableLoads(frequency_t roc, frequency_t deviation);
+
+/*
+ * Time-to-stable per mode, from the sample that leaves the stable state to
+ * the first of SHED_STABLE_SAMPLES stable samples in a row. An event belongs
+ * to the mode in use when it started.
+ *
+ * shedEventSample() and shedEventShed() must not preempt each other; the
+ * dump reads without a lock.
+ */
+#define SHED_STABLE_SAMPLES 10
+
+/**
+ * Follows the stability of one sample, with the latencyNow() time it
+ * arrived.
+ */
+void shedEventSample(ShedMode mode, bool isStable, uint32_t timestamp);
+
+/**
+ * Counts loads shed against the event in progress.
+ */
+void shedEventShed(uint32_t loads);
+
+/**
+ * Prints the mode in use and, for every mode that has seen an event, the
+ * mean and worst time-to-stable in milliseconds and the loads shed per event.
+ */
+void shedStatsDump(FILE *out, ShedMode mode);
+
+#endif /* SHEDDING_H */
@@ -0,0 +1,111 @@
+#include "spsc_ring.h"
+
+#include <string.h>
+
+bool spscRingInit(SpscRing *ring, void *buffer, uint32_t capacity,
+                  size_t itemSize) {
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    return false;
+  }
+
+  ring->buffer = buffer;
+  ring->itemSize = itemSize;
+  ring->mask = capacity - 1;
+  ring->head = 0;
+  ring->tail = 0;
+  ring->consumer = NULL;
+  return true;
+}
+
+void spscRingSetConsumer(SpscRing *ring, TaskHandle_t consumer) {
+  ring->consumer = consumer;
+}
+
+/*
+ * Both sides publish their own index and then read the other one with a full
+ * barrier in between. Either the consumer's last look before blocking sees the
+ * new item, or the producer sees the ring as empty apart from that item and
+ * notifies. On the single core Nios II the ISR cannot interleave with the task
+ * anyway; the barriers matter for the host build, where it can.
+ */
+bool spscRingPushFromISR(SpscRing *ring, const void *item,
+                         BaseType_t *higherPriorityTaskWoken) {
+  uint32_t head = ring->head;
+
+  if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > ring->mask) {
+    return false;
+  }
+
+  memcpy(ring->buffer + (head & ring->mask) * ring->itemSize, item,
+         ring->itemSize);
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  if (ring->consumer != NULL &&
+      head + 1 - __atomic_load_n(&ring->tail, __ATOMIC_RELAXED) == 1) {
+    vTaskNotifyGiveFromISR(ring->consumer, higherPriorityTaskWoken);
+  }
+  return true;
+}
+
+bool spscRingPushNFromISR(SpscRing *ring, const void *items, uint32_t count,
+                          BaseType_t *higherPriorityTaskWoken) {
+  uint32_t head = ring->head;
+  uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+  if (count > ring->mask + 1 - (head - tail)) {
+    return false;
+  }
+  if (count == 0) {
+    return true;
+  }
+
+  // at most two copies, as in spscRingPopN()
+  uint32_t first = ring->mask + 1 - (head & ring->mask);
+  if (first > count) {
+    first = count;
+  }
+  memcpy(ring->buffer + (head & ring->mask) * ring->itemSize, items,
+         first * ring->itemSize);
+  memcpy(ring->buffer, (const uint8_t *)items + first * ring->itemSize,
+         (count - first) * ring->itemSize);
+  __atomic_store_n(&ring->head, head + count, __ATOMIC_RELEASE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  if (ring->consumer != NULL &&
+      head + count - __atomic_load_n(&ring->tail, __ATOMIC_RELAXED) == count) {
+    vTaskNotifyGiveFromISR(ring->consumer, higherPriorityTaskWoken);
+  }
+  return true;
+}
+
+uint32_t spscRingPopN(SpscRing *ring, void *items, uint32_t max) {
+  uint32_t tail = ring->tail;
+  uint32_t count = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+
+  if (count > max) {
+    count = max;
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  // at most two copies, the second one after wrapping to the start
+  uint32_t first = ring->mask + 1 - (tail & ring->mask);
+  if (first > count) {
+    first = count;
+  }
+  memcpy(items, ring->buffer + (tail & ring->mask) * ring->itemSize,
+         first * ring->itemSize);
+  memcpy((uint8_t *)items + first * ring->itemSize, ring->buffer,
+         (count - first) * ring->itemSize);
+
+  __atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  return count;
+}
+
+uint32_t spscRingCount(const SpscRing *ring) {
+  return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) -
+         __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
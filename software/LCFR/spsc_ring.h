@@ -0,0 +1,70 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+
+/*
+ * Lock-free single-producer/single-consumer ring buffer.
+ *
+ * For passing fixed-size items from one ISR to one task without a critical
+ * section: the producer only writes head and the consumer only writes tail.
+ * The capacity must be a power of two so the free-running indices can be
+ * masked. When a push finds the ring empty the consumer task, if set, gets a
+ * task notification, so it can block in ulTaskNotifyTake() whenever
+ * spscRingPopN() returns 0 and never miss an item.
+ */
+
+typedef struct {
+  uint8_t *buffer;
+  size_t itemSize;
+  uint32_t mask;
+  uint32_t head; // next slot to write, producer only
+  uint32_t tail; // next slot to read, consumer only
+  TaskHandle_t consumer;
+} SpscRing;
+
+/**
+ * Sets up a ring over a caller-provided buffer of capacity * itemSize bytes.
+ * Returns false if capacity is not a power of two.
+ */
+bool spscRingInit(SpscRing *ring, void *buffer, uint32_t capacity,
+                  size_t itemSize);
+
+/**
+ * Task to notify when the ring goes from empty to non-empty, or NULL.
+ */
+void spscRingSetConsumer(SpscRing *ring, TaskHandle_t consumer);
+
+/**
+ * Copies item into the ring. Producer side, safe from an ISR. Returns false
+ * and drops the item if the ring is full. higherPriorityTaskWoken is set as
+ * for vTaskNotifyGiveFromISR().
+ */
+bool spscRingPushFromISR(SpscRing *ring, const void *item,
+                         BaseType_t *higherPriorityTaskWoken);
+
+/**
+ * Copies all count items into the ring, or none and returns false if there is
+ * not room for all of them. Producer side, safe from an ISR, and notifies the
+ * consumer as spscRingPushFromISR() does.
+ */
+bool spscRingPushNFromISR(SpscRing *ring, const void *items, uint32_t count,
+                          BaseType_t *higherPriorityTaskWoken);
+
+/**
+ * Copies up to max items out of the ring, oldest first, and returns how many.
+ * Consumer side.
+ */
+uint32_t spscRingPopN(SpscRing *ring, void *items, uint32_t max);
+
+/**
+ * Number of items waiting. Exact on either side, a snapshot anywhere else.
+ */
+uint32_t spscRingCount(const SpscRing *ring);
+
+#endif /* SPSC_RING_H */
@@ -0,0 +1,93 @@
+#include "task_events.h"
+
+#include "latency.h"
+
+struct taskEventsPostStats_t {
+  volatile uint32_t posts;
+  volatile uint64_t total; // timestamp ticks in the notify calls
+  volatile uint32_t worst;
+};
+
+/*
+ * Task posts are recorded in a critical section, as several tasks post.
+ * ISRs do not nest and cannot run inside one, so the ISR figures need no
+ * lock. Both are read without a lock.
+ */
+static struct taskEventsPostStats_t taskPosts;
+static struct taskEventsPostStats_t isrPosts;
+
+// recorded in a critical section and read without a lock
+static volatile uint32_t wakeups;
+static volatile uint32_t eventsReturned;
+
+static void record(struct taskEventsPostStats_t *stats, uint32_t elapsed) {
+  stats->posts++;
+  stats->total += elapsed;
+  if (elapsed > stats->worst) {
+    stats->worst = elapsed;
+  }
+}
+
+void taskEventsPost(TaskHandle_t task, uint32_t events) {
+  // a task woken at a higher priority runs on xTaskResumeAll(), outside the
+  // time taken
+  vTaskSuspendAll();
+  uint32_t start = latencyNow();
+
+  xTaskNotify(task, events, eSetBits);
+
+  uint32_t elapsed = latencyNow() - start;
+
+  taskENTER_CRITICAL();
+  record(&taskPosts, elapsed);
+  taskEXIT_CRITICAL();
+  xTaskResumeAll();
+}
+
+void taskEventsPostFromISR(TaskHandle_t task, uint32_t events,
+                           BaseType_t *higherPriorityTaskWoken) {
+  uint32_t start = latencyNow();
+
+  xTaskNotifyFromISR(task, events, eSetBits, higherPriorityTaskWoken);
+  record(&isrPosts, latencyNow() - start);
+}
+
+uint32_t taskEventsWait(TickType_t timeout) {
+  uint32_t events, bits, count = 0;
+
+  if (xTaskNotifyWait(0, UINT32_MAX, &events, timeout) != pdTRUE) {
+    return 0;
+  }
+
+  // __builtin_popcount() is a libgcc call on the Nios II, and only a few
+  // events are set
+  for (bits = events; bits != 0; bits &= bits - 1) {
+    count++;
+  }
+
+  taskENTER_CRITICAL();
+  wakeups++;
+  eventsReturned += count;
+  taskEXIT_CRITICAL();
+  return events;
+}
+
+static void dumpPosts(FILE *out, const char *from,
+                      const struct taskEventsPostStats_t *stats) {
+  uint32_t posts = stats->posts;
+
+  fprintf(out, "events: %lu posts from %s, %.0f ticks mean, %lu worst\n",
+          (unsigned long)posts, from,
+          posts == 0 ? 0.0 : (double)stats->total / posts,
+          (unsigned long)stats->worst);
+}
+
+void taskEventsDump(FILE *out) {
+  uint32_t woken = wakeups;
+
+  dumpPosts(out, "tasks", &taskPosts);
+  dumpPosts(out, "isrs", &isrPosts);
+  fprintf(out, "events: %lu wakeups, %.2f events each\n",
+          (unsigned long)woken,
+          woken == 0 ? 0.0 : (double)eventsReturned / woken);
+}
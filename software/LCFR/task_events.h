@@ -0,0 +1,53 @@
+#ifndef TASK_EVENTS_H
+#define TASK_EVENTS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+
+/*
+ * Waking a task with bits in its task notification value, instead of with a
+ * binary semaphore per reason.
+ *
+ * A post ORs its bits into the task's value and readies the task if it is
+ * waiting. There is no queue to lock and no event list for the poster to
+ * walk. taskEventsWait() returns and clears every bit posted since the last
+ * wait, so a task that is woken for several reasons handles them all after
+ * one wait. A bit posted twice before the task runs wakes it once.
+ *
+ * The notification value must have no other use. The consumer of an
+ * spsc_ring.h ring counts notifications, so it cannot wait here as well.
+ *
+ * Each post is timed on the alt_timestamp() clock. On the Nios II that runs
+ * at the CPU clock, so taskEventsDump() reports CPU cycles per signal.
+ */
+
+/**
+ * Sets events in task's notification value. Called from a task or a timer
+ * callback.
+ */
+void taskEventsPost(TaskHandle_t task, uint32_t events);
+
+/**
+ * Sets events in task's notification value from an ISR.
+ * higherPriorityTaskWoken is set as for xTaskNotifyFromISR(). ISRs must not
+ * nest.
+ */
+void taskEventsPostFromISR(TaskHandle_t task, uint32_t events,
+                           BaseType_t *higherPriorityTaskWoken);
+
+/**
+ * Waits up to timeout for events to be posted to the calling task. Returns
+ * them and clears them, or returns 0 if none came.
+ */
+uint32_t taskEventsWait(TickType_t timeout);
+
+/**
+ * Prints the posts from tasks and from ISRs with their mean and worst cost,
+ * and the events each wakeup returned.
+ */
+void taskEventsDump(FILE *out);
+
+#endif /* TASK_EVENTS_H */
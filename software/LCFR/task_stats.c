@@ -0,0 +1,114 @@
+#include "task_stats.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+#include "sys/alt_timestamp.h"
+
+typedef struct {
+  char name[configMAX_TASK_NAME_LEN];
+  UBaseType_t number;    // xTaskNumber, unique per task
+  uint32_t lastCounter;  // run-time counter as of the last sample
+  uint64_t runTime;      // widened run-time counter
+  uint32_t lastRunTime;  // run time between the last two samples
+  UBaseType_t stackFree; // words never used
+} TaskStatsEntry;
+
+struct taskStatsState_t {
+  TaskStatsEntry tasks[TASK_STATS_MAX_TASKS];
+  unsigned int count;
+  uint32_t lastTotal; // total run-time counter as of the last sample
+  uint64_t total;
+  uint32_t lastPeriod;
+};
+
+// written by taskStatsSample() only and read without a lock
+static struct taskStatsState_t state;
+
+static TaskStatus_t status[TASK_STATS_MAX_TASKS];
+
+// the entry for a task, kept in task creation order
+static TaskStatsEntry *entryOf(const TaskStatus_t *task) {
+  unsigned int i;
+
+  for (i = 0; i < state.count; i++) {
+    if (state.tasks[i].number == task->xTaskNumber) {
+      return &state.tasks[i];
+    }
+    if (state.tasks[i].number > task->xTaskNumber) {
+      break;
+    }
+  }
+  if (state.count == TASK_STATS_MAX_TASKS) {
+    return NULL;
+  }
+
+  memmove(&state.tasks[i + 1], &state.tasks[i],
+          (state.count - i) * sizeof(state.tasks[0]));
+  state.count++;
+  memset(&state.tasks[i], 0, sizeof(state.tasks[i]));
+  strncpy(state.tasks[i].name, task->pcTaskName, configMAX_TASK_NAME_LEN - 1);
+  state.tasks[i].number = task->xTaskNumber;
+  return &state.tasks[i];
+}
+
+void taskStatsSample(void) {
+  uint32_t total;
+  UBaseType_t count, i;
+
+  // returns 0 if there are more tasks than TASK_STATS_MAX_TASKS
+  count = uxTaskGetSystemState(status, TASK_STATS_MAX_TASKS, &total);
+
+  state.lastPeriod = total - state.lastTotal;
+  state.lastTotal = total;
+  state.total += state.lastPeriod;
+
+  for (i = 0; i < count; i++) {
+    TaskStatsEntry *entry = entryOf(&status[i]);
+
+    if (entry == NULL) {
+      continue;
+    }
+    entry->lastRunTime = status[i].ulRunTimeCounter - entry->lastCounter;
+    entry->lastCounter = status[i].ulRunTimeCounter;
+    entry->runTime += entry->lastRunTime;
+#ifdef LCFR_POSIX_GCC
+    entry->stackFree = uxPortGetThreadStackHighWaterMark(status[i].xHandle);
+#else
+    entry->stackFree = status[i].usStackHighWaterMark;
+#endif
+  }
+}
+
+static double percentOf(uint64_t part, uint64_t whole) {
+  return whole == 0 ? 0.0 : 100.0 * (double)part / whole;
+}
+
+void taskStatsDump(FILE *out) {
+  double freq = (double)alt_timestamp_freq();
+  unsigned int i;
+
+  if (freq == 0.0) {
+    fprintf(out, "tasks: no timestamp timer\n");
+    return;
+  }
+  if (state.count == 0) {
+    fprintf(out, "tasks: not sampled yet\n");
+    return;
+  }
+
+  fprintf(out,
+          "tasks: %% cpu over the last %.1f s and over %.1f s, stack words "
+          "never used\n",
+          state.lastPeriod / freq, state.total / freq);
+  for (i = 0; i < state.count; i++) {
+    const TaskStatsEntry *entry = &state.tasks[i];
+
+    fprintf(out, "  %-*s %5.1f %5.1f %6lu\n", configMAX_TASK_NAME_LEN - 1,
+            entry->name, percentOf(entry->lastRunTime, state.lastPeriod),
+            percentOf(entry->runTime, state.total),
+            (unsigned long)entry->stackFree);
+  }
+}
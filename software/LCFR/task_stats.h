@@ -0,0 +1,34 @@
+#ifndef TASK_STATS_H
+#define TASK_STATS_H
+
+#include <stdio.h>
+
+/*
+ * Per-task CPU time and stack use.
+ *
+ * The kernel counts each task's run time on the alt_timestamp() clock (see
+ * FreeRTOSConfig.h). taskStatsSample() reads those counters and every task's
+ * stack high-water mark into a snapshot, and widens the counters so a total
+ * survives the 32-bit clock wrapping between samples, as long as samples are
+ * taken more often than it wraps.
+ *
+ * On the host a task runs on its own thread stack, so the stack figure there is
+ * that thread's, from uxPortGetThreadStackHighWaterMark().
+ */
+
+#define TASK_STATS_MAX_TASKS 16
+
+/**
+ * Samples every task. Only call from one task.
+ */
+void taskStatsSample(void);
+
+/**
+ * Prints the last sample: each task's share of the CPU since the sample before
+ * it and overall, and the stack words it has never used. Reads the snapshot
+ * without a lock, so it may also be called from an ISR, and a dump taken while
+ * a sample is being written can mix the two.
+ */
+void taskStatsDump(FILE *out);
+
+#endif /* TASK_STATS_H */
@@ -0,0 +1,104 @@
+#include "telemetry.h"
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/task.h"
+
+#include "latency.h"
+#include "spsc_ring.h"
+
+struct telemetryStats_t {
+  volatile uint32_t logged;
+  volatile uint32_t dropped;
+};
+
+// written by the source's producer only and read without a lock
+static struct telemetryStats_t sourceStats[TELEMETRY_NUM_SOURCES];
+
+// written by telemetryTask() only and read without a lock
+static volatile uint32_t framesWritten;
+static volatile uint64_t bytesWritten;
+
+static SpscRing rings[TELEMETRY_NUM_SOURCES];
+static TelemetryRecord ringBuffers[TELEMETRY_NUM_SOURCES][TELEMETRY_RING_SIZE];
+static TelemetrySink outputSink;
+
+// one frame, assembled by telemetryTask()
+static struct {
+  TelemetryFrameHeader header;
+  TelemetryRecord records[TELEMETRY_RING_SIZE];
+} frame;
+
+void telemetryInit(TelemetrySink sink) {
+  int i;
+
+  for (i = 0; i < TELEMETRY_NUM_SOURCES; i++) {
+    spscRingInit(&rings[i], ringBuffers[i], TELEMETRY_RING_SIZE,
+                 sizeof(TelemetryRecord));
+  }
+  outputSink = sink;
+}
+
+void telemetryLog(TelemetrySource source, TelemetryEvent event, uint8_t detail,
+                  uint16_t count, uint32_t value0, uint32_t value1) {
+  TelemetryRecord record = {
+      .timestamp = latencyNow(),
+      .event = event,
+      .detail = detail,
+      .count = count,
+      .value = {value0, value1},
+  };
+
+  // nothing waits on the rings, so there is never a task to wake
+  if (spscRingPushFromISR(&rings[source], &record, NULL)) {
+    sourceStats[source].logged++;
+  } else {
+    sourceStats[source].dropped++;
+  }
+}
+
+void telemetryTask(void *pvParameters) {
+  TickType_t lastWake = xTaskGetTickCount();
+  int i;
+
+  while (1) {
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(TELEMETRY_DRAIN_PERIOD_MS));
+
+    for (i = 0; i < TELEMETRY_NUM_SOURCES; i++) {
+      uint32_t count =
+          spscRingPopN(&rings[i], frame.records, TELEMETRY_RING_SIZE);
+      size_t size;
+
+      if (count == 0 || outputSink == NULL) {
+        continue;
+      }
+
+      frame.header.magic = TELEMETRY_MAGIC;
+      frame.header.version = TELEMETRY_VERSION;
+      frame.header.source = (uint8_t)i;
+      frame.header.count = (uint16_t)count;
+      frame.header.timestampFreq = alt_timestamp_freq();
+      frame.header.dropped = sourceStats[i].dropped;
+      size = sizeof(frame.header) + count * sizeof(frame.records[0]);
+
+      if (outputSink(&frame, size)) {
+        framesWritten++;
+        bytesWritten += size;
+      }
+    }
+  }
+}
+
+void telemetryDump(FILE *out) {
+  uint32_t logged = 0, dropped = 0;
+  int i;
+
+  for (i = 0; i < TELEMETRY_NUM_SOURCES; i++) {
+    logged += sourceStats[i].logged;
+    dropped += sourceStats[i].dropped;
+  }
+  fprintf(out,
+          "telemetry: %lu records logged, %lu dropped, %lu frames of %llu "
+          "bytes written\n",
+          (unsigned long)logged, (unsigned long)dropped,
+          (unsigned long)framesWritten, (unsigned long long)bytesWritten);
+}
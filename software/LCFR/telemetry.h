@@ -0,0 +1,105 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Binary event log.
+ *
+ * Real-time paths log fixed-size records instead of calling printf(), which
+ * formats and then writes through the JTAG UART driver, taking its lock and
+ * blocking when the FIFO is full. Each source has its own spsc_ring.h ring, so
+ * logging is a copy and two index updates and never waits; a full ring drops
+ * the record and counts it.
+ *
+ * telemetryTask() drains every ring each TELEMETRY_DRAIN_PERIOD_MS and hands
+ * each source's records to the sink as one frame. Frames can share a stream
+ * with text, and host/telemetry_decode finds them by their magic and prints
+ * the records as CSV.
+ */
+
+#define TELEMETRY_RING_SIZE 64 // records per source, must be a power of two
+#define TELEMETRY_DRAIN_PERIOD_MS 100
+
+#define TELEMETRY_MAGIC 0x4d4c54a5 // bytes a5 'T' 'L' 'M' on the wire
+#define TELEMETRY_VERSION 1
+
+/**
+ * Each source may only log from one task or ISR at a time.
+ */
+typedef enum {
+  TELEMETRY_FREQUENCY_ANALYSER,
+  TELEMETRY_LOAD_MANAGER,
+  TELEMETRY_MAINTENANCE,
+  TELEMETRY_NUM_SOURCES
+} TelemetrySource;
+
+typedef enum {
+  TELEMETRY_STABILITY,          // detail: stable, value: Hz and Hz/s in Q16.16
+  TELEMETRY_SHED,               // detail: ShedMode, count: kW, value: LoadMap
+  TELEMETRY_RECONNECT,          // detail: load index, value: LoadMap
+  TELEMETRY_TIMER_RESET,        // detail: TelemetryTimerReset
+  TELEMETRY_MANAGEMENT_EXIT,    // load management state left
+  TELEMETRY_MAINTENANCE_TOGGLE, // detail: in maintenance
+  TELEMETRY_SAMPLE,             // detail: stable, value: Hz and Hz/s in Q16.16
+  TELEMETRY_NUM_EVENTS
+} TelemetryEvent;
+
+typedef enum {
+  TELEMETRY_RESET_ALREADY_ACTIVE,
+  TELEMETRY_RESET_UNSTABLE,
+  TELEMETRY_RESET_RECONNECTING
+} TelemetryTimerReset;
+
+/*
+ * Wire format, little-endian as both the Nios II and the host are. A frame is
+ * a TelemetryFrameHeader followed by count records.
+ */
+typedef struct {
+  uint32_t timestamp; // alt_timestamp() when logged
+  uint8_t event;      // TelemetryEvent
+  uint8_t detail;
+  uint16_t count;
+  uint32_t value[2]; // a LoadMap is low word first
+} TelemetryRecord;
+
+typedef struct {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t source; // TelemetrySource
+  uint16_t count;
+  uint32_t timestampFreq; // alt_timestamp_freq()
+  uint32_t dropped;       // records this source has dropped so far
+} TelemetryFrameHeader;
+
+/**
+ * Writes one whole frame, or none of it, and returns false if it was not
+ * written. Called from telemetryTask() only.
+ */
+typedef bool (*TelemetrySink)(const void *frame, size_t size);
+
+/**
+ * Sets up the rings. Frames go to sink, or are discarded if it is NULL.
+ */
+void telemetryInit(TelemetrySink sink);
+
+/**
+ * Logs an event from source. Never blocks, safe from an ISR.
+ */
+void telemetryLog(TelemetrySource source, TelemetryEvent event, uint8_t detail,
+                  uint16_t count, uint32_t value0, uint32_t value1);
+
+/**
+ * Drains the rings every TELEMETRY_DRAIN_PERIOD_MS. Run at a low priority.
+ */
+void telemetryTask(void *pvParameters);
+
+/**
+ * Prints how many records were logged, dropped and written.
+ */
+void telemetryDump(FILE *out);
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,285 @@
+#include "trace_recorder.h"
+
+#if configUSE_TRACE_RECORDER == 1
+
+#include <string.h>
+
+#include "FreeRTOS/task.h"
+
+#include "latency.h"
+
+#ifdef LCFR_POSIX_GCC
+#include <sched.h>
+#endif
+
+/*
+ * Records come from ISRs, and from the kernel and tasks both inside and
+ * outside critical sections, so a record claims its slot with interrupts
+ * masked. On the host, where ISRs run on the simulator thread alongside the
+ * task thread, a spin lock stands in for the mask. The timestamp is taken
+ * before either, as a host register read can switch tasks.
+ */
+#ifdef LCFR_POSIX_GCC
+typedef int RecordContext;
+
+static volatile char recordLock;
+
+static inline RecordContext recordLockTake(void) {
+  while (__atomic_test_and_set(&recordLock, __ATOMIC_ACQUIRE)) {
+    sched_yield();
+  }
+  return 0;
+}
+
+static inline void recordLockGive(RecordContext context) {
+  (void)context;
+  __atomic_clear(&recordLock, __ATOMIC_RELEASE);
+}
+#else
+typedef alt_irq_context RecordContext;
+
+static inline RecordContext recordLockTake(void) {
+  return alt_irq_disable_all();
+}
+
+static inline void recordLockGive(RecordContext context) {
+  alt_irq_enable_all(context);
+}
+#endif
+
+/*
+ * Written under the record lock, read without one. Once frozen is set only
+ * traceRecorderTask() touches the ring, until it clears it again.
+ */
+static struct {
+  uint32_t head; // records kept since the recorder was armed
+  uint32_t remaining; // records until the ring freezes, once triggered
+  bool triggered;
+  volatile bool frozen;
+} recorder;
+
+static TraceRecord ring[TRACE_RECORDER_SIZE];
+
+struct traceRecorderStats_t {
+  volatile uint64_t kept;
+  volatile uint32_t missed; // arrived while frozen
+  volatile uint32_t triggers;
+  volatile uint32_t dumps;     // written whole
+  volatile uint32_t abandoned; // given up on part way
+};
+
+static struct traceRecorderStats_t stats;
+
+// names, written as objects are created and read by traceRecorderTask()
+static TraceName taskNames[TRACE_RECORDER_MAX_TASKS];
+static uint32_t numTasks;
+static TraceName queueNames[TRACE_RECORDER_MAX_QUEUES];
+static uint32_t numQueues;
+
+static struct {
+  alt_isr_func handler;
+  void *context;
+} isrs[ALT_NIRQ];
+
+static TraceRecorderSink outputSink;
+
+// one frame, assembled by traceRecorderTask()
+static struct {
+  TraceFrameHeader header;
+  union {
+    TraceName names[TRACE_RECORDER_MAX_TASKS + TRACE_RECORDER_MAX_QUEUES];
+    TraceRecord records[TRACE_RECORDER_FRAME_RECORDS];
+  } entries;
+} frame;
+
+void traceRecorderInit(TraceRecorderSink sink) { outputSink = sink; }
+
+uint8_t traceRecorderTaskCreated(const char *name, uint32_t priority) {
+  TraceName *entry;
+
+  if (numTasks >= TRACE_RECORDER_MAX_TASKS) {
+    return 0;
+  }
+  entry = &taskNames[numTasks++];
+  entry->kind = TRACE_NAME_TASK;
+  entry->number = (uint8_t)numTasks;
+  entry->detail = (uint8_t)priority;
+  strncpy(entry->name, name, sizeof(entry->name));
+  return entry->number;
+}
+
+uint8_t traceRecorderQueueCreated(uint8_t type) {
+  TraceName *entry;
+
+  if (numQueues >= TRACE_RECORDER_MAX_QUEUES) {
+    return 0;
+  }
+  entry = &queueNames[numQueues++];
+  entry->kind = TRACE_NAME_QUEUE;
+  entry->number = (uint8_t)numQueues;
+  entry->detail = type;
+  return entry->number;
+}
+
+void traceRecorderNameQueue(QueueHandle_t queue, const char *name) {
+  UBaseType_t number = uxQueueGetQueueNumber(queue);
+
+  if (number != 0) {
+    strncpy(queueNames[number - 1].name, name,
+            sizeof(queueNames[number - 1].name));
+  }
+}
+
+/*
+ * Keeps a record in the ring unless it is frozen. Called with the record lock
+ * held.
+ */
+static void recordLocked(uint32_t timestamp, uint8_t event, uint32_t object,
+                         uint32_t value) {
+  TraceRecord *record;
+
+  if (recorder.frozen) {
+    stats.missed++;
+    return;
+  }
+
+  record = &ring[recorder.head & (TRACE_RECORDER_SIZE - 1)];
+  record->timestamp = timestamp;
+  record->event = event;
+  record->object = (uint8_t)object;
+  record->value = (uint16_t)value;
+  recorder.head++;
+  stats.kept++;
+
+  if (recorder.triggered && --recorder.remaining == 0) {
+    recorder.frozen = true;
+  }
+}
+
+void traceRecorderRecord(uint8_t event, uint32_t object, uint32_t value) {
+  uint32_t now = latencyNow();
+  RecordContext context = recordLockTake();
+
+  recordLocked(now, event, object, value);
+  recordLockGive(context);
+}
+
+void traceRecorderTrigger(uint16_t reason) {
+  uint32_t now = latencyNow();
+  RecordContext context = recordLockTake();
+
+  if (!recorder.triggered && !recorder.frozen) {
+    recorder.triggered = true;
+    recorder.remaining = TRACE_RECORDER_POST_TRIGGER;
+    stats.triggers++;
+  }
+  recordLocked(now, TRACE_TRIGGER, 0, reason);
+  recordLockGive(context);
+}
+
+static void recordedIsr(void *context, alt_u32 id) {
+  traceRecorderRecord(TRACE_ISR_ENTER, id, 0);
+  isrs[id].handler(isrs[id].context, id);
+  traceRecorderRecord(TRACE_ISR_EXIT, id, 0);
+}
+
+alt_isr_func traceRecorderWrapIsr(alt_u32 id, void *context,
+                                  alt_isr_func handler) {
+  isrs[id].handler = handler;
+  isrs[id].context = context;
+  return handler != NULL ? recordedIsr : NULL;
+}
+
+/**
+ * Writes the frame of count entries, retrying while the sink is full, and
+ * returns false if it gave up.
+ */
+static bool writeFrame(TraceFrameType type, uint32_t count, size_t entrySize) {
+  size_t size = sizeof(frame.header) + count * entrySize;
+  int tries;
+
+  frame.header.magic = TRACE_MAGIC;
+  frame.header.version = TRACE_VERSION;
+  frame.header.type = (uint8_t)type;
+  frame.header.count = (uint16_t)count;
+  frame.header.timestampFreq = alt_timestamp_freq();
+  frame.header.dump = stats.dumps;
+
+  for (tries = 0; tries < TRACE_RECORDER_RETRIES; tries++) {
+    if (outputSink(&frame, size)) {
+      return true;
+    }
+    vTaskDelay(pdMS_TO_TICKS(TRACE_RECORDER_RETRY_MS));
+  }
+  return false;
+}
+
+/**
+ * Writes the names and the frozen ring, oldest record first, and returns
+ * false if the sink would not take them.
+ */
+static bool writeDump(void) {
+  uint32_t count = recorder.head < TRACE_RECORDER_SIZE ? recorder.head
+                                                       : TRACE_RECORDER_SIZE;
+  uint32_t next = recorder.head - count;
+  uint32_t k;
+
+  memcpy(frame.entries.names, taskNames, numTasks * sizeof(TraceName));
+  memcpy(&frame.entries.names[numTasks], queueNames,
+         numQueues * sizeof(TraceName));
+  if (!writeFrame(TRACE_FRAME_NAMES, numTasks + numQueues, sizeof(TraceName))) {
+    return false;
+  }
+
+  while (count > 0) {
+    uint32_t n = count < TRACE_RECORDER_FRAME_RECORDS
+                     ? count
+                     : TRACE_RECORDER_FRAME_RECORDS;
+
+    for (k = 0; k < n; k++) {
+      frame.entries.records[k] = ring[(next + k) & (TRACE_RECORDER_SIZE - 1)];
+    }
+    if (!writeFrame(TRACE_FRAME_RECORDS, n, sizeof(TraceRecord))) {
+      return false;
+    }
+    next += n;
+    count -= n;
+  }
+  return true;
+}
+
+void traceRecorderTask(void *pvParameters) {
+  RecordContext context;
+
+  while (1) {
+    vTaskDelay(pdMS_TO_TICKS(TRACE_RECORDER_POLL_MS));
+    if (!recorder.frozen) {
+      continue;
+    }
+
+    if (outputSink != NULL) {
+      if (writeDump()) {
+        stats.dumps++;
+      } else {
+        stats.abandoned++;
+      }
+    }
+
+    context = recordLockTake();
+    recorder.head = 0;
+    recorder.triggered = false;
+    recorder.frozen = false;
+    recordLockGive(context);
+  }
+}
+
+void traceRecorderDump(FILE *out) {
+  fprintf(out,
+          "trace: %llu records kept, %lu missed while frozen, %lu triggers, "
+          "%lu dumps written, %lu abandoned\n",
+          (unsigned long long)stats.kept, (unsigned long)stats.missed,
+          (unsigned long)stats.triggers, (unsigned long)stats.dumps,
+          (unsigned long)stats.abandoned);
+}
+
+#endif /* configUSE_TRACE_RECORDER */
@@ -0,0 +1,161 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sys/alt_irq.h"
+
+#include "FreeRTOS/FreeRTOS.h"
+#include "FreeRTOS/queue.h"
+
+/*
+ * Kernel trace recorder, built with LCFR_TRACE_RECORDER.
+ *
+ * The FreeRTOS trace macros (see FreeRTOSConfig.h) and a wrapper around every
+ * handler given to alt_irq_register() log compact records to a RAM ring:
+ * task switches and wakeups, queue and semaphore traffic, task notifications,
+ * timer commands, and interrupt entry and exit. Each is stamped with
+ * alt_timestamp(), which runs at the CPU clock on the Nios II.
+ *
+ * The ring keeps the last TRACE_RECORDER_SIZE records. traceRecorderTrigger()
+ * marks a point of interest, and TRACE_RECORDER_POST_TRIGGER records later
+ * the ring freezes, holding what led up to the trigger and what followed it.
+ * traceRecorderTask() writes a frozen ring to the sink as frames and rearms
+ * the recorder; records that arrive meanwhile are counted, not kept.
+ * host/trace_json turns the frames into Chrome trace-event JSON.
+ */
+
+#define TRACE_RECORDER_SIZE 4096 // records, must be a power of two
+#define TRACE_RECORDER_POST_TRIGGER (TRACE_RECORDER_SIZE / 2)
+#define TRACE_RECORDER_FRAME_RECORDS 64
+#define TRACE_RECORDER_POLL_MS 100
+#define TRACE_RECORDER_RETRY_MS 10
+#define TRACE_RECORDER_RETRIES 100 // per frame, before the dump is abandoned
+#define TRACE_RECORDER_MAX_TASKS 16
+#define TRACE_RECORDER_MAX_QUEUES 16
+
+#define TRACE_MAGIC 0x435254a5 // bytes a5 'T' 'R' 'C' on the wire
+#define TRACE_VERSION 1
+
+/*
+ * FreeRTOSConfig.h logs the kernel's events by these numbers, as its
+ * traceRECORD_ macros, so they must not change.
+ */
+typedef enum {
+  TRACE_TASK_SWITCHED_IN = 0, // object: task
+  TRACE_TASK_READY = 1,       // object: task
+  TRACE_TASK_DELAY = 2,       // object: task
+  TRACE_ISR_ENTER = 3,        // object: IRQ
+  TRACE_ISR_EXIT = 4,         // object: IRQ
+  TRACE_QUEUE_SEND = 5, // object: queue, value: messages waiting before
+  TRACE_QUEUE_SEND_FROM_ISR = 6,
+  TRACE_QUEUE_SEND_FAILED = 7,
+  TRACE_QUEUE_RECEIVE = 8,
+  TRACE_QUEUE_RECEIVE_FROM_ISR = 9,
+  TRACE_QUEUE_BLOCK_SEND = 10,
+  TRACE_QUEUE_BLOCK_RECEIVE = 11,
+  TRACE_NOTIFY = 12,          // object: task notified
+  TRACE_NOTIFY_FROM_ISR = 13, // object: task notified
+  TRACE_NOTIFY_BLOCK = 14,    // object: task waiting
+  TRACE_NOTIFY_RECEIVE = 15,  // object: task waiting
+  TRACE_TIMER_COMMAND_SEND = 16,     // object: command, value: sent
+  TRACE_TIMER_COMMAND_RECEIVED = 17, // object: command
+  TRACE_TIMER_EXPIRED = 18,
+  TRACE_TRIGGER = 19, // value: the caller's reason
+  TRACE_NUM_EVENTS
+} TraceEvent;
+
+typedef enum {
+  TRACE_FRAME_NAMES, // TraceName entries
+  TRACE_FRAME_RECORDS // TraceRecord entries, oldest first
+} TraceFrameType;
+
+typedef enum { TRACE_NAME_TASK, TRACE_NAME_QUEUE } TraceNameKind;
+
+/*
+ * Wire format, little-endian as both the Nios II and the host are. A dump is
+ * one TRACE_FRAME_NAMES frame followed by TRACE_FRAME_RECORDS frames, each a
+ * TraceFrameHeader followed by count entries. Tasks and queues are numbered
+ * from 1 in the order they were created; 0 is one created before the
+ * recorder numbered it.
+ */
+typedef struct {
+  uint32_t timestamp; // alt_timestamp() when recorded
+  uint8_t event;      // TraceEvent
+  uint8_t object;
+  uint16_t value;
+} TraceRecord;
+
+typedef struct {
+  uint8_t kind;   // TraceNameKind
+  uint8_t number;
+  uint8_t detail; // task priority, or queue type
+  uint8_t reserved;
+  char name[configMAX_TASK_NAME_LEN]; // NUL padded
+} TraceName;
+
+typedef struct {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t type; // TraceFrameType
+  uint16_t count;
+  uint32_t timestampFreq; // alt_timestamp_freq()
+  uint32_t dump;          // dumps written before this one
+} TraceFrameHeader;
+
+/**
+ * Writes one whole frame, or none of it, and returns false if it was not
+ * written. Called from traceRecorderTask() only.
+ */
+typedef bool (*TraceRecorderSink)(const void *frame, size_t size);
+
+/**
+ * Sets the sink frozen rings are written to. A NULL sink discards them. Call
+ * before the scheduler starts; recording starts with the first kernel object
+ * created.
+ */
+void traceRecorderInit(TraceRecorderSink sink);
+
+/**
+ * Names queue in dumps. Queues are otherwise known by number and type.
+ */
+void traceRecorderNameQueue(QueueHandle_t queue, const char *name);
+
+/**
+ * Logs a TRACE_TRIGGER record and freezes the ring
+ * TRACE_RECORDER_POST_TRIGGER records later. Ignored while a trigger is
+ * already pending. Never blocks, safe from an ISR.
+ */
+void traceRecorderTrigger(uint16_t reason);
+
+/**
+ * Writes each frozen ring to the sink and rearms the recorder. Run at a low
+ * priority.
+ */
+void traceRecorderTask(void *pvParameters);
+
+/**
+ * Prints how many records were kept and missed, and the dumps written.
+ */
+void traceRecorderDump(FILE *out);
+
+/*
+ * Kernel hooks, called from the trace macros in FreeRTOSConfig.h, which
+ * declares them again. The created hooks return the number the kernel keeps
+ * for the new object, in the TCB's uxTaskNumber or the queue's uxQueueNumber.
+ */
+uint8_t traceRecorderTaskCreated(const char *name, uint32_t priority);
+uint8_t traceRecorderQueueCreated(uint8_t type);
+void traceRecorderRecord(uint8_t event, uint32_t object, uint32_t value);
+
+/**
+ * Returns the handler alt_irq_register() registers in place of handler, which
+ * records entry to and exit from handler and calls it with context.
+ */
+alt_isr_func traceRecorderWrapIsr(alt_u32 id, void *context,
+                                  alt_isr_func handler);
+
+#endif /* TRACE_RECORDER_H */